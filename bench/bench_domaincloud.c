@@ -0,0 +1,313 @@
+/** \file
+ * Measure the throughput of the lexer, the word tokenizer and the program
+ * on corpus files and write the results as JSON.
+ *
+ * Usage: bench_domaincloud [-o FILE] [-p PROGRAM] FILE...
+ */
+
+#include <errno.h>
+#include <error.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "domaincloud.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+    #define HAVE_TSC 1
+    #include <x86intrin.h>
+#else
+    #define HAVE_TSC 0
+#endif
+
+/** The input is passed in blocks of this size like by
+ *  \ref remove_clutter. */
+#define BLOCK_SIZE (64 * 1024)
+
+/** Repeat each measurement at least this long. */
+#define MIN_SECONDS 0.5
+
+/** Repeat each measurement at least this often. */
+#define MIN_RUNS 3
+
+extern char **environ;
+
+/** \struct bench_clock
+ *  \brief A point in time for the measurements. */
+struct bench_clock
+{
+    struct timespec time;
+    uint64_t cycles;
+};
+
+/** The current time. */
+static struct bench_clock
+bench_now (void)
+{
+    struct bench_clock now;
+    clock_gettime (CLOCK_MONOTONIC, &now.time);
+#if HAVE_TSC
+    now.cycles = __rdtsc ();
+#else
+    now.cycles = 0;
+#endif
+    return now;
+}
+
+/** \struct bench_result
+ *  \brief The total time of \a runs runs over \a bytes bytes each. */
+struct bench_result
+{
+    size_t bytes;
+    unsigned runs;
+    double seconds;
+    uint64_t cycles;
+};
+
+/** Add the duration since \a start as one run to \a result. */
+static void
+bench_add_run (struct bench_result *result, struct bench_clock start)
+{
+    struct bench_clock end = bench_now ();
+    result->seconds += (double) (end.time.tv_sec - start.time.tv_sec)
+        + (double) (end.time.tv_nsec - start.time.tv_nsec) * 1e-9;
+    result->cycles += end.cycles - start.cycles;
+    ++result->runs;
+}
+
+/** Whether \a result needs more runs. */
+static bool
+bench_continue (const struct bench_result *result)
+{
+    return result->runs < MIN_RUNS || result->seconds < MIN_SECONDS;
+}
+
+/** A \ref clutter_sink which only sums up the length of the text. */
+static int
+sum_len (const char *text, size_t len, void *sum)
+{
+    (void) text;
+    *(size_t*) sum += len;
+    return 0;
+}
+
+/** A \ref clutter_sink which appends the text to a memory stream. */
+static int
+collect_text (const char *text, size_t len, void *ostr)
+{
+    return fwrite (text, 1, len, ostr) == len ? 0 : errno;
+}
+
+/** Strip \a len chars of \a content in blocks like \ref remove_clutter. */
+static int
+strip (const char *content, size_t len, clutter_sink *sink, void *sink_data)
+{
+    enum clutter_state state = CLUTTER_CODE;
+    struct clutter_stats stats = {0};
+    int res = 0;
+    for (size_t pos = 0; pos < len && !res; pos += BLOCK_SIZE)
+        res = remove_clutter_buf (
+            content + pos,
+            len - pos < BLOCK_SIZE ? len - pos : BLOCK_SIZE,
+            &state, &stats, sink, sink_data);
+    return res ? res : remove_clutter_end (&state, sink, sink_data);
+}
+
+/** Measure \ref remove_clutter_buf on \a content. */
+static struct bench_result
+bench_strip (const char *content, size_t len)
+{
+    struct bench_result result = {len, 0, 0, 0};
+    size_t sum = 0;
+    while (bench_continue (&result))
+    {
+        struct bench_clock start = bench_now ();
+        strip (content, len, sum_len, &sum);
+        bench_add_run (&result, start);
+    }
+    return result;
+}
+
+/** Measure \ref count_words on the stripped \a content. */
+static struct bench_result
+bench_tokenize (const char *content, size_t len)
+{
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *ostr = open_memstream (&text, &text_len);
+    if (!ostr || strip (content, len, collect_text, ostr) || fclose (ostr))
+        error (EXIT_FAILURE, errno, "can't strip the corpus");
+
+    struct bench_result result = {text_len, 0, 0, 0};
+    while (bench_continue (&result))
+    {
+        struct word_counts *counts = word_counts_new ();
+        if (!counts)
+            error (EXIT_FAILURE, ENOMEM, "can't count words");
+        struct word_tokenizer tokenizer;
+        word_tokenizer_init (&tokenizer, counts);
+
+        struct bench_clock start = bench_now ();
+        for (size_t pos = 0; pos < text_len; pos += BLOCK_SIZE)
+            count_words (
+                text + pos,
+                text_len - pos < BLOCK_SIZE
+                    ? text_len - pos : BLOCK_SIZE,
+                &tokenizer);
+        word_tokenizer_end (&tokenizer);
+        bench_add_run (&result, start);
+
+        word_counts_free (counts);
+    }
+
+    free (text);
+    return result;
+}
+
+/** Measure \a program counting the words of \a file_name of \a len bytes,
+ *  including the start of the process. */
+static struct bench_result
+bench_program (const char *program, const char *file_name, size_t len)
+{
+    char *const args[] = {
+        (char*) program, "--counts", "-o", "/dev/null", (char*) file_name,
+        NULL};
+    struct bench_result result = {len, 0, 0, 0};
+    while (bench_continue (&result))
+    {
+        struct bench_clock start = bench_now ();
+        pid_t pid;
+        int status;
+        int res = posix_spawn (&pid, program, NULL, NULL, args, environ);
+        if (res)
+            error (EXIT_FAILURE, res, "can't run '%s'", program);
+        if (waitpid (pid, &status, 0) < 0 || !WIFEXITED (status)
+            || WEXITSTATUS (status))
+            error (EXIT_FAILURE, 0, "'%s' failed for '%s'", program, file_name);
+        bench_add_run (&result, start);
+    }
+    return result;
+}
+
+/** Write \a result of \a stage for \a file_name as JSON object. */
+static void
+print_result (
+    FILE *ostr, const char *file_name, const char *stage,
+    struct bench_result result, bool first)
+{
+    double total_bytes = (double) result.bytes * result.runs;
+    fprintf (ostr, "%s\n    {\"file\": \"%s\", \"stage\": \"%s\", "
+             "\"bytes\": %zu, \"runs\": %u, \"seconds\": %.6f,\n"
+             "     \"mb_per_s\": %.2f, \"ns_per_byte\": %.4f, "
+             "\"cycles_per_byte\": ",
+             first ? "" : ",", file_name, stage, result.bytes, result.runs,
+             result.seconds, total_bytes / result.seconds / 1e6,
+             result.seconds * 1e9 / total_bytes);
+    if (HAVE_TSC)
+        fprintf (ostr, "%.4f}", (double) result.cycles / total_bytes);
+    else
+        fputs ("null}", ostr);
+}
+
+/** Read all of \a file_name.  Sets \a len to its size. */
+static char *
+read_file (const char *file_name, size_t *len)
+{
+    FILE *istr = fopen (file_name, "r");
+    if (!istr)
+        error (EXIT_FAILURE, errno, "can't open '%s'", file_name);
+
+    char *content = NULL;
+    size_t size = 0;
+    *len = 0;
+    for (;;)
+    {
+        if (*len == size)
+        {
+            size = size ? 2 * size : 1 << 20;
+            content = realloc (content, size);
+            if (!content)
+                error (EXIT_FAILURE, ENOMEM, "can't read '%s'", file_name);
+        }
+        size_t num_read = fread (content + *len, 1, size - *len, istr);
+        *len += num_read;
+        if (num_read == 0)
+            break;
+    }
+    if (ferror (istr))
+        error (EXIT_FAILURE, errno, "can't read '%s'", file_name);
+    fclose (istr);
+    return content;
+}
+
+int
+main (int argc, char **argv)
+{
+    const char *output_file = NULL;
+    const char *program = NULL;
+    int opt;
+    while ((opt = getopt (argc, argv, "o:p:")) != -1)
+    {
+        if (opt == 'o')
+            output_file = optarg;
+        else if (opt == 'p')
+            program = optarg;
+        else
+            exit (EXIT_FAILURE);
+    }
+    if (optind == argc)
+        error (EXIT_FAILURE, 0,
+               "usage: %s [-o FILE] [-p PROGRAM] FILE...", argv[0]);
+
+    FILE *ostr = output_file ? fopen (output_file, "w") : stdout;
+    if (!ostr)
+        error (EXIT_FAILURE, errno, "can't create '%s'", output_file);
+
+    fprintf (ostr, "{\n  \"block_size\": %d,\n  \"cycles\": \"%s\",\n"
+             "  \"results\": [", BLOCK_SIZE,
+             HAVE_TSC ? "tsc" : "none");
+    bool first = true;
+    for (int i = optind; i < argc; ++i)
+    {
+        size_t len;
+        char *content = read_file (argv[i], &len);
+        const char *name = strrchr (argv[i], '/');
+        name = name ? name + 1 : argv[i];
+
+        print_result (ostr, name, "strip", bench_strip (content, len), first);
+        print_result (
+            ostr, name, "tokenize", bench_tokenize (content, len), false);
+        if (program)
+            print_result (
+                ostr, name, "program", bench_program (program, argv[i], len),
+                false);
+        first = false;
+        free (content);
+    }
+    fputs ("\n  ]\n}\n", ostr);
+
+    if (output_file && fclose (ostr))
+        error (EXIT_FAILURE, errno, "can't write '%s'", output_file);
+    return EXIT_SUCCESS;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,272 @@
+/** \file
+ * Generate the synthetic source files for the benchmarks.  The files only
+ * depend on their size, so results of different builds are comparable.
+ *
+ * Usage: gen_corpus DIR [SIZE]
+ */
+
+#include <errno.h>
+#include <error.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Default size of each file in bytes. */
+#define CORPUS_SIZE (8 * 1024 * 1024)
+
+/** State of the xorshift generator.  Fixed seed for reproducible files. */
+static uint64_t rand_state = 0x9e3779b97f4a7c15u;
+
+/** The next pseudo random number below \a limit. */
+static unsigned
+rand_below (unsigned limit)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return (unsigned) (rand_state % limit);
+}
+
+static const char *const words[] = {
+    "buffer", "count", "node", "list", "cur", "pos", "len", "state",
+    "parse", "token", "index", "value", "result", "config", "stream",
+    "file", "error", "size", "next", "prev", "entry", "table", "hash",
+    "word", "line", "input", "output", "handle", "context", "flags",
+    "item", "data", "key", "offset", "limit", "begin", "end", "queue",
+};
+#define NUM_WORDS (sizeof (words) / sizeof (words[0]))
+
+/** A random word of \ref words. */
+static const char *
+word (void)
+{
+    return words[rand_below (NUM_WORDS)];
+}
+
+/** Write a random identifier like \c buffer_count to \a ostr. */
+static void
+put_identifier (FILE *ostr)
+{
+    fputs (word (), ostr);
+    if (rand_below (2))
+        fprintf (ostr, "_%s", word ());
+}
+
+/** Write a sentence of \a num_words words to \a ostr. */
+static void
+put_sentence (FILE *ostr, unsigned num_words)
+{
+    for (unsigned i = 0; i < num_words; ++i)
+        fprintf (ostr, i ? " %s" : "%s", word ());
+}
+
+/** Write a statement of code with \a indent spaces to \a ostr. */
+static void
+put_statement (FILE *ostr, unsigned indent)
+{
+    fprintf (ostr, "%*s", (int) indent, "");
+    switch (rand_below (4))
+    {
+        case 0:
+            put_identifier (ostr);
+            fputs (" = ", ostr);
+            put_identifier (ostr);
+            fprintf (ostr, " + %u;\n", rand_below (1000));
+            break;
+        case 1:
+            fputs ("if (", ostr);
+            put_identifier (ostr);
+            fputs (" < ", ostr);
+            put_identifier (ostr);
+            fputs (")\n", ostr);
+            fprintf (ostr, "%*s    return -1;\n", (int) indent, "");
+            break;
+        case 2:
+            put_identifier (ostr);
+            fputs (" (", ostr);
+            put_identifier (ostr);
+            fputs (", &", ostr);
+            put_identifier (ostr);
+            fputs (");\n", ostr);
+            break;
+        default:
+            fputs ("struct ", ostr);
+            put_identifier (ostr);
+            fputs (" *", ostr);
+            put_identifier (ostr);
+            fputs (" = NULL;\n", ostr);
+    }
+}
+
+/** Write the start of a function to \a ostr. */
+static void
+put_function_start (FILE *ostr)
+{
+    fputs ("int\n", ostr);
+    put_identifier (ostr);
+    fputs (" (const char *", ostr);
+    put_identifier (ostr);
+    fputs (", size_t len)\n{\n", ostr);
+}
+
+/** Mostly line and block comments. */
+static void
+put_comment_heavy (FILE *ostr)
+{
+    fputs ("/** ", ostr);
+    put_sentence (ostr, 8 + rand_below (8));
+    fputs ("\n *  ", ostr);
+    put_sentence (ostr, 8 + rand_below (8));
+    fputs (" * / not the end.\n */\n", ostr);
+    put_function_start (ostr);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        fputs ("    // ", ostr);
+        put_sentence (ostr, 4 + rand_below (10));
+        fputs ("\n", ostr);
+        put_statement (ostr, 4);
+    }
+    fputs ("}\n\n", ostr);
+}
+
+/** Mostly string and char literals with escapes. */
+static void
+put_string_heavy (FILE *ostr)
+{
+    put_function_start (ostr);
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        fputs ("    printf (\"", ostr);
+        put_sentence (ostr, 3 + rand_below (8));
+        fputs (rand_below (2) ? ": %s\\n\", " : " \\\"quoted\\\"\\t\", ",
+               ostr);
+        put_identifier (ostr);
+        fputs (");\n", ostr);
+        fprintf (ostr, "    c = '%s';\n", rand_below (2) ? "\\''" : "x");
+    }
+    fputs ("}\n\n", ostr);
+}
+
+/** Deep indentation, blank lines and trailing spaces. */
+static void
+put_white_space_heavy (FILE *ostr)
+{
+    put_function_start (ostr);
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        put_statement (ostr, 4 * (1 + rand_below (8)));
+        fprintf (ostr, "%*s\n\n\t\t\n", (int) rand_below (24), "");
+    }
+    fputs ("}\n\n", ostr);
+}
+
+/** Initializer lists and macros with lines of several KiB. */
+static void
+put_long_lines (FILE *ostr)
+{
+    fputs ("static const char *", ostr);
+    put_identifier (ostr);
+    fputs ("[] = {", ostr);
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        fputs (" \"", ostr);
+        fputs (word (), ostr);
+        fputs ("\", ", ostr);
+        put_identifier (ostr);
+        fputs (" /* ", ostr);
+        fputs (word (), ostr);
+        fputs (" */,", ostr);
+    }
+    fputs (" };\n", ostr);
+}
+
+/** Code resembling real C sources. */
+static void
+put_mixed (FILE *ostr)
+{
+    fputs ("/** ", ostr);
+    put_sentence (ostr, 6 + rand_below (12));
+    fputs (". */\n", ostr);
+    put_function_start (ostr);
+    unsigned num_statements = 3 + rand_below (12);
+    for (unsigned i = 0; i < num_statements; ++i)
+    {
+        switch (rand_below (8))
+        {
+            case 0:
+                fputs ("    /* ", ostr);
+                put_sentence (ostr, 3 + rand_below (10));
+                fputs (" */\n", ostr);
+                break;
+            case 1:
+                fputs ("    error (0, errno, \"", ostr);
+                put_sentence (ostr, 2 + rand_below (4));
+                fputs (" '%s'\", file_name);\n", ostr);
+                break;
+            default:
+                break;
+        }
+        put_statement (ostr, 4);
+    }
+    fputs ("    return 0;\n}\n\n", ostr);
+}
+
+/** \struct corpus_mix
+ *  \brief A corpus file and the generator of its parts. */
+struct corpus_mix
+{
+    const char *name;
+    void (*put_part) (FILE *ostr);
+};
+
+static const struct corpus_mix mixes[] = {
+    {"comments.c", put_comment_heavy},
+    {"strings.c", put_string_heavy},
+    {"white_space.c", put_white_space_heavy},
+    {"long_lines.c", put_long_lines},
+    {"mixed.c", put_mixed},
+};
+
+int
+main (int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+        error (EXIT_FAILURE, 0, "usage: %s DIR [SIZE]", argv[0]);
+
+    long size = argc > 2 ? atol (argv[2]) : CORPUS_SIZE;
+    if (size <= 0)
+        error (EXIT_FAILURE, 0, "invalid size '%s'", argv[2]);
+
+    for (size_t i = 0; i < sizeof (mixes) / sizeof (mixes[0]); ++i)
+    {
+        char path[4096];
+        snprintf (path, sizeof (path), "%s/%s", argv[1], mixes[i].name);
+        FILE *ostr = fopen (path, "w");
+        if (!ostr)
+            error (EXIT_FAILURE, errno, "can't create '%s'", path);
+
+        while (ftell (ostr) < size)
+            mixes[i].put_part (ostr);
+
+        if (fclose (ostr))
+            error (EXIT_FAILURE, errno, "can't write '%s'", path);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,736 @@
+/** \file
+ * Readers of tar and zip archives in memory, which pass the members on
+ * while going through the archive once. */
+
+#if defined (HAVE_CONFIG_H) && HAVE_CONFIG_H
+    #include "config.h"
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+    #include <zlib.h>
+#endif
+
+#include "archive.h"
+#include "decompress.h"
+
+/** Size of the headers of tar members, whose data is padded to it. */
+#define TAR_BLOCK_SIZE 512
+/** Largest GNU long name or pax header which is read. */
+#define TAR_MAX_META_SIZE (1024 * 1024)
+/** Size of the blocks of text inflated from a zip member. */
+#define ZIP_BLOCK_SIZE (64 * 1024)
+/** Compression methods of zip members. */
+#define ZIP_STORED 0
+#define ZIP_DEFLATED 8
+
+/** Suffixes of the names of archives.  Tar archives may be compressed
+ *  by any format of \ref decompressor. */
+static const struct
+{
+    const char *suffix;
+    enum archive_format format;
+} archive_suffixes[] = {
+    {".tar", ARCHIVE_TAR}, {".tar.gz", ARCHIVE_TAR}, {".tgz", ARCHIVE_TAR},
+    {".tar.xz", ARCHIVE_TAR}, {".txz", ARCHIVE_TAR},
+    {".tar.zst", ARCHIVE_TAR}, {".zip", ARCHIVE_ZIP}};
+
+/** States of a \ref tar_reader. */
+enum tar_state
+{
+    TAR_HEADER,     /**< Collecting the header of the next member. */
+    TAR_DATA,       /**< In the data of a member or its padding. */
+    TAR_META,       /**< In a GNU long name or a pax header. */
+    TAR_END         /**< After the block ending the archive. */
+};
+
+/** \struct tar_reader
+ *  \brief A tar archive fed to \ref tar_feed in blocks of any size.
+ *
+ *  \var size_t tar_reader::header_len
+ *      Number of chars collected in \a header.
+ *  \var unsigned long long tar_reader::left
+ *      Number of chars of the data of the member which are still to come.
+ *  \var size_t tar_reader::padding
+ *      Number of chars between the data and the next header.
+ *  \var bool tar_reader::selected
+ *      Whether the data is passed to \a visitor.
+ *  \var char tar_reader::meta_type
+ *      \c L for a GNU long name, \c x for a pax header in \a meta.
+ *  \var char *tar_reader::next_name
+ *      The name of the next member given by a GNU long name or pax
+ *      header or \c NULL.
+ */
+struct tar_reader
+{
+    const struct archive_visitor *visitor;
+    enum tar_state state;
+    size_t header_len;
+    unsigned long long left;
+    size_t padding;
+    bool selected;
+    char meta_type;
+    char *meta;
+    size_t meta_len;
+    char *next_name;
+    char header[TAR_BLOCK_SIZE];
+};
+
+/** \struct zip_reader
+ *  \brief The buffers reused for the members of a zip archive.
+ *
+ *  \var char *zip_reader::name
+ *      The zero terminated name of the member of \a name_size chars.
+ *  \var bool zip_reader::inflating
+ *      Whether \a inflater is set up.
+ *  \var char *zip_reader::out
+ *      \ref ZIP_BLOCK_SIZE chars for the inflated text.
+ */
+struct zip_reader
+{
+    const struct archive_visitor *visitor;
+    char *name;
+    size_t name_size;
+#ifdef HAVE_ZLIB
+    z_stream inflater;
+    bool inflating;
+    char *out;
+#endif
+};
+
+/** The format of the archive \a file_name by its suffix. */
+enum archive_format
+archive_format_for_file (const char *file_name)
+{
+    size_t len = strlen (file_name);
+    size_t num_suffixes =
+        sizeof (archive_suffixes) / sizeof (*archive_suffixes);
+    for (size_t suffix = 0; suffix < num_suffixes; ++suffix)
+    {
+        size_t suffix_len = strlen (archive_suffixes[suffix].suffix);
+        if (len > suffix_len && !strcmp (
+                file_name + len - suffix_len, archive_suffixes[suffix].suffix))
+            return archive_suffixes[suffix].format;
+    }
+
+    return ARCHIVE_NONE;
+}
+
+/** \a name without leading <tt>./</tt>. */
+static const char *
+skip_dot_slash (const char *name)
+{
+    while (name[0] == '.' && name[1] == '/')
+        name += 2;
+    return name;
+}
+
+/** Whether the member \a name is a regular file selected by \a visitor. */
+static bool
+select_member (const struct archive_visitor *visitor, const char *name)
+{
+    size_t len = strlen (name);
+    return len && name[len - 1] != '/' && visitor->select (name, visitor->data);
+}
+
+/** Parse the numeric tar header field of \a size chars at \a field, which
+ *  is either octal or, if its first bit is set, GNU base-256.
+ *
+ *  \returns Whether the field is valid.
+ */
+static bool
+parse_tar_number (const char *field, size_t size, unsigned long long *value)
+{
+    const unsigned char *pos = (const unsigned char *) field;
+    const unsigned char *end = pos + size;
+    *value = 0;
+
+    if (*pos & 0x80)
+    {
+        *value = *pos++ & 0x7F;
+        for (; pos < end; ++pos)
+        {
+            if (*value >> 56)
+                return false;
+            *value = *value << 8 | *pos;
+        }
+        return true;
+    }
+
+    while (pos < end && *pos == ' ')
+        ++pos;
+    for (; pos < end && *pos >= '0' && *pos <= '7'; ++pos)
+    {
+        if (*value >> 61)
+            return false;
+        *value = *value * 8 + (unsigned) (*pos - '0');
+    }
+
+    return pos == end || *pos == ' ' || *pos == '\0';
+}
+
+/** Whether the checksum of the tar \a header is right.  The sum is taken
+ *  with spaces in place of the checksum field. */
+static bool
+tar_checksum_ok (const char *header)
+{
+    unsigned long long expected;
+    if (!parse_tar_number (header + 148, 8, &expected))
+        return false;
+
+    unsigned long long sum = 0;
+    for (int pos = 0; pos < TAR_BLOCK_SIZE; ++pos)
+        sum += pos >= 148 && pos < 156 ? ' ' : (unsigned char) header[pos];
+
+    return sum == expected;
+}
+
+/** Copy the name of the member of the tar \a header with its ustar prefix
+ *  to \a name, which has room for 257 chars. */
+static void
+tar_header_name (const char *header, char *name)
+{
+    size_t len = 0;
+    if (!memcmp (header + 257, "ustar", 6) && header[345])
+    {
+        len = strnlen (header + 345, 155);
+        memcpy (name, header + 345, len);
+        name[len++] = '/';
+    }
+
+    size_t name_len = strnlen (header, 100);
+    memcpy (name + len, header, name_len);
+    name[len + name_len] = '\0';
+}
+
+/** The value of the \c path record of the pax header of \a len chars at
+ *  \a meta, which is followed by a \c NUL.
+ *
+ *  \returns A copy of the path or \c NULL if there is none or if out of
+ *      memory.
+ */
+static char *
+pax_path (const char *meta, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        char *key;
+        unsigned long record_len = strtoul (meta + pos, &key, 10);
+        size_t key_pos = (size_t) (key - meta);
+        if (*key != ' ' || record_len > len - pos
+            || pos + record_len < key_pos + 2)
+            return NULL;
+
+        ++key;
+        size_t value_len = pos + record_len - key_pos - 2;
+        if (value_len >= 5 && !memcmp (key, "path=", 5))
+            return strndup (key + 5, value_len - 5);
+        pos += record_len;
+    }
+
+    return NULL;
+}
+
+/** Start the member whose header \a reader has collected.
+ *
+ *  \returns The value returned by the \a begin function of the visitor,
+ *      \c EINVAL if the header is corrupt, \c ENOMEM if out of memory or 0.
+ */
+static int
+tar_header (struct tar_reader *reader)
+{
+    const char *header = reader->header;
+    reader->header_len = 0;
+
+    bool zero = true;
+    for (int pos = 0; pos < TAR_BLOCK_SIZE && zero; ++pos)
+        zero = !header[pos];
+    if (zero)
+    {
+        reader->state = TAR_END;
+        return 0;
+    }
+
+    unsigned long long size;
+    if (!tar_checksum_ok (header)
+        || !parse_tar_number (header + 124, 12, &size))
+        return EINVAL;
+    reader->left = size;
+    reader->padding = (size_t)
+        ((TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE);
+    reader->selected = false;
+
+    char type = header[156];
+    if (type == 'L' || type == 'x')
+    {
+        free (reader->meta);
+        reader->meta = NULL;
+        if (size > TAR_MAX_META_SIZE)
+            return EINVAL;
+        if (!(reader->meta = malloc ((size_t) size + 1)))
+            return ENOMEM;
+        reader->meta_type = type;
+        reader->meta_len = 0;
+        reader->state = TAR_META;
+        return 0;
+    }
+
+    reader->state = TAR_DATA;
+    char header_name[257];
+    const char *name = reader->next_name;
+    if (!name)
+    {
+        tar_header_name (header, header_name);
+        name = header_name;
+    }
+    name = skip_dot_slash (name);
+
+    int res = 0;
+    if ((type == '0' || type == '\0' || type == '7')
+        && select_member (reader->visitor, name))
+    {
+        reader->selected = true;
+        res = reader->visitor->begin (name, reader->visitor->data);
+    }
+    free (reader->next_name);
+    reader->next_name = NULL;
+
+    return res;
+}
+
+/** Take the name of the next member from the GNU long name or pax header
+ *  \a reader has collected.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+tar_meta_end (struct tar_reader *reader)
+{
+    reader->meta[reader->meta_len] = '\0';
+    reader->state = TAR_DATA;
+
+    free (reader->next_name);
+    if (reader->meta_type == 'L')
+        reader->next_name = strdup (reader->meta);
+    else
+        reader->next_name = pax_path (reader->meta, reader->meta_len);
+
+    return reader->meta_type == 'L' && !reader->next_name ? ENOMEM : 0;
+}
+
+/** Pass the members in the next \a len chars of the tar archive of
+ *  \a reader to its visitor.  Members not selected are skipped.
+ *
+ *  \returns The first nonzero value returned by the visitor, \c EINVAL if
+ *      a header is corrupt, \c ENOMEM if out of memory or 0.
+ */
+static int
+tar_feed (struct tar_reader *reader, const char *in, size_t len)
+{
+    const struct archive_visitor *visitor = reader->visitor;
+    int res = 0;
+
+    while (!res && reader->state != TAR_END)
+    {
+        if (reader->state != TAR_HEADER && !reader->left)
+        {
+            if (reader->state == TAR_META)
+                res = tar_meta_end (reader);
+            else if (reader->selected)
+            {
+                reader->selected = false;
+                res = visitor->end (visitor->data);
+            }
+            else if (!reader->padding)
+                reader->state = TAR_HEADER;
+            else if (!len)
+                break;
+            else
+            {
+                size_t skip = reader->padding < len ? reader->padding : len;
+                reader->padding -= skip;
+                in += skip;
+                len -= skip;
+            }
+            continue;
+        }
+
+        if (!len)
+            break;
+        if (reader->state == TAR_HEADER)
+        {
+            size_t chunk = TAR_BLOCK_SIZE - reader->header_len;
+            if (chunk > len)
+                chunk = len;
+            memcpy (reader->header + reader->header_len, in, chunk);
+            reader->header_len += chunk;
+            in += chunk;
+            len -= chunk;
+            if (reader->header_len == TAR_BLOCK_SIZE)
+                res = tar_header (reader);
+            continue;
+        }
+
+        size_t chunk = reader->left < len ? (size_t) reader->left : len;
+        if (reader->state == TAR_META)
+        {
+            memcpy (reader->meta + reader->meta_len, in, chunk);
+            reader->meta_len += chunk;
+        }
+        else if (reader->selected)
+            res = visitor->text (in, chunk, visitor->data);
+        reader->left -= chunk;
+        in += chunk;
+        len -= chunk;
+    }
+
+    return res;
+}
+
+/** Read the tar archive of \a len chars at \a in, which is decompressed
+ *  first if it is compressed.  The archive may end without end blocks
+ *  but not inside a member. */
+static int
+read_tar (const char *in, size_t len, const struct archive_visitor *visitor)
+{
+    struct tar_reader reader;
+    memset (&reader, 0, sizeof (reader));
+    reader.visitor = visitor;
+    reader.state = TAR_HEADER;
+
+    enum compression compression = input_compression (in, len);
+    int res;
+    if (compression == COMPRESSION_NONE)
+        res = tar_feed (&reader, in, len);
+    else
+    {
+        struct decompressor *decompressor = NULL;
+        res = decompressor_start (compression, in, len, &decompressor);
+
+        const char *block;
+        size_t block_len;
+        while (!res && reader.state != TAR_END
+               && !(res = decompressor_next (decompressor, &block, &block_len))
+               && block_len)
+            res = tar_feed (&reader, block, block_len);
+        decompressor_free (decompressor);
+    }
+
+    if (!res && reader.state != TAR_END
+        && (reader.state != TAR_HEADER || reader.header_len))
+        res = EINVAL;
+
+    free (reader.meta);
+    free (reader.next_name);
+    return res;
+}
+
+/** The little endian number of 2 chars at \a pos. */
+static unsigned
+get_u16 (const char *pos)
+{
+    const unsigned char *bytes = (const unsigned char *) pos;
+    return bytes[0] | (unsigned) bytes[1] << 8;
+}
+
+/** The little endian number of 4 chars at \a pos. */
+static unsigned long long
+get_u32 (const char *pos)
+{
+    return get_u16 (pos) | (unsigned long long) get_u16 (pos + 2) << 16;
+}
+
+/** The little endian number of 8 chars at \a pos. */
+static unsigned long long
+get_u64 (const char *pos)
+{
+    return get_u32 (pos) | get_u32 (pos + 4) << 32;
+}
+
+/** Find the central directory of the zip archive of \a len chars at
+ *  \a in by the end record after it, in zip64 format if there is one.
+ *
+ *  \param num_entries Set to the number of members.
+ *  \param offset Set to the offset of the central directory.
+ *  \returns \c EINVAL if there is no valid end record else 0.
+ */
+static int
+find_zip_directory (
+    const char *in, size_t len, unsigned long long *num_entries,
+    unsigned long long *offset)
+{
+    /* The end record of 22 chars is followed by a comment of up to 64 KiB. */
+    if (len < 22)
+        return EINVAL;
+    size_t min_pos = len - 22 > 0xFFFF ? len - 22 - 0xFFFF : 0;
+    for (size_t pos = len - 22 + 1; pos-- > min_pos;)
+    {
+        if (memcmp (in + pos, "PK\5\6", 4))
+            continue;
+
+        *num_entries = get_u16 (in + pos + 10);
+        *offset = get_u32 (in + pos + 16);
+        /* The zip64 end record is found by the locator before the end
+         * record. */
+        if (pos >= 20 && !memcmp (in + pos - 20, "PK\6\7", 4))
+        {
+            unsigned long long end64 = get_u64 (in + pos - 20 + 8);
+            if (len < 56 || end64 > len - 56
+                || memcmp (in + end64, "PK\6\6", 4))
+                return EINVAL;
+            *num_entries = get_u64 (in + end64 + 32);
+            *offset = get_u64 (in + end64 + 48);
+        }
+        return *offset <= len ? 0 : EINVAL;
+    }
+
+    return EINVAL;
+}
+
+/** Replace the sizes and the offset of a central directory entry which
+ *  don't fit in 32 bits by those of the zip64 field among the
+ *  \a extra_len chars of extra fields at \a extra. */
+static void
+read_zip64_extra (
+    const char *extra, size_t extra_len, unsigned long long *size,
+    unsigned long long *packed_size, unsigned long long *offset)
+{
+    size_t pos = 0;
+    while (pos + 4 <= extra_len)
+    {
+        unsigned id = get_u16 (extra + pos);
+        size_t field_len = get_u16 (extra + pos + 2);
+        const char *field = extra + pos + 4;
+        pos += 4 + field_len;
+        if (pos > extra_len)
+            return;
+        if (id != 1)
+            continue;
+
+        unsigned long long *values[] = {size, packed_size, offset};
+        size_t field_pos = 0;
+        for (int value = 0; value < 3; ++value)
+            if (*values[value] == 0xFFFFFFFF && field_pos + 8 <= field_len)
+            {
+                *values[value] = get_u64 (field + field_pos);
+                field_pos += 8;
+            }
+        return;
+    }
+}
+
+/** Whether zip members compressed with \a method can be read. */
+static bool
+zip_method_supported (unsigned method)
+{
+#ifdef HAVE_ZLIB
+    if (method == ZIP_DEFLATED)
+        return true;
+#endif
+    return method == ZIP_STORED;
+}
+
+#ifdef HAVE_ZLIB
+/** Inflate the deflated \a len chars at \a in and pass the text to the
+ *  visitor of \a reader.
+ *
+ *  \returns The first nonzero value returned by the visitor, \c EINVAL if
+ *      the member is corrupt, \c ENOMEM if out of memory or 0.
+ */
+static int
+zip_inflate (struct zip_reader *reader, const char *in, unsigned long long len)
+{
+    z_stream *inflater = &reader->inflater;
+    if (reader->inflating)
+        inflateReset (inflater);
+    else
+    {
+        if (!reader->out && !(reader->out = malloc (ZIP_BLOCK_SIZE)))
+            return ENOMEM;
+        memset (inflater, 0, sizeof (*inflater));
+        /* Raw deflate without zlib header. */
+        if (inflateInit2 (inflater, -15) != Z_OK)
+            return ENOMEM;
+        reader->inflating = true;
+    }
+    inflater->avail_in = 0;
+
+    const struct archive_visitor *visitor = reader->visitor;
+    int status = Z_OK;
+    int res = 0;
+    while (!res && status == Z_OK)
+    {
+        if (!inflater->avail_in && len)
+        {
+            uInt chunk = len > UINT_MAX ? UINT_MAX : (uInt) len;
+            inflater->next_in = (Bytef *) in;
+            inflater->avail_in = chunk;
+            in += chunk;
+            len -= chunk;
+        }
+        inflater->next_out = (Bytef *) reader->out;
+        inflater->avail_out = ZIP_BLOCK_SIZE;
+
+        status = inflate (inflater, Z_NO_FLUSH);
+        size_t out_len = ZIP_BLOCK_SIZE - inflater->avail_out;
+        if (out_len)
+            res = visitor->text (reader->out, out_len, visitor->data);
+    }
+
+    if (!res && status != Z_STREAM_END)
+        res = status == Z_MEM_ERROR ? ENOMEM : EINVAL;
+    return res;
+}
+#endif
+
+/** Pass the member \a name of the zip archive of \a len chars at \a in
+ *  to the visitor of \a reader if it is selected.  Encrypted members and
+ *  those with unsupported compression methods are skipped.
+ *
+ *  \param flags The general purpose flags of the member.
+ *  \param packed_size The size of the member in the archive.
+ *  \param offset The offset of the local header of the member.
+ *  \returns The first nonzero value returned by the visitor, \c EINVAL if
+ *      the member is corrupt, \c ENOMEM if out of memory or 0.
+ */
+static int
+read_zip_member (
+    struct zip_reader *reader, const char *in, size_t len, const char *name,
+    unsigned flags, unsigned method, unsigned long long packed_size,
+    unsigned long long offset)
+{
+    const struct archive_visitor *visitor = reader->visitor;
+    name = skip_dot_slash (name);
+    if ((flags & 1) || !zip_method_supported (method)
+        || !select_member (visitor, name))
+        return 0;
+
+    if (offset > len || len - offset < 30 || memcmp (in + offset, "PK\3\4", 4))
+        return EINVAL;
+    unsigned long long data = offset + 30
+        + get_u16 (in + offset + 26) + get_u16 (in + offset + 28);
+    if (data > len || len - data < packed_size)
+        return EINVAL;
+
+    int res = visitor->begin (name, visitor->data);
+    if (!res && method == ZIP_STORED && packed_size)
+        res = visitor->text (in + data, (size_t) packed_size, visitor->data);
+#ifdef HAVE_ZLIB
+    else if (!res && method == ZIP_DEFLATED)
+        res = zip_inflate (reader, in + data, packed_size);
+#endif
+    if (!res)
+        res = visitor->end (visitor->data);
+
+    return res;
+}
+
+/** Read the zip archive of \a len chars at \a in.  The members are found
+ *  by the central directory at its end and read in its order. */
+static int
+read_zip (const char *in, size_t len, const struct archive_visitor *visitor)
+{
+    unsigned long long num_entries;
+    unsigned long long pos;
+    int res = find_zip_directory (in, len, &num_entries, &pos);
+
+    struct zip_reader reader;
+    memset (&reader, 0, sizeof (reader));
+    reader.visitor = visitor;
+
+    for (unsigned long long entry = 0; !res && entry < num_entries; ++entry)
+    {
+        const char *header = in + pos;
+        if (len - pos < 46 || memcmp (header, "PK\1\2", 4))
+        {
+            res = EINVAL;
+            break;
+        }
+
+        unsigned long long packed_size = get_u32 (header + 20);
+        unsigned long long size = get_u32 (header + 24);
+        unsigned long long offset = get_u32 (header + 42);
+        size_t name_len = get_u16 (header + 28);
+        size_t extra_len = get_u16 (header + 30);
+        size_t comment_len = get_u16 (header + 32);
+        if (len - pos - 46 < name_len + extra_len + comment_len)
+        {
+            res = EINVAL;
+            break;
+        }
+        read_zip64_extra (
+            header + 46 + name_len, extra_len, &size, &packed_size, &offset);
+        pos += 46 + name_len + extra_len + comment_len;
+
+        if (name_len >= reader.name_size)
+        {
+            char *name = realloc (reader.name, name_len + 1);
+            if (!name)
+            {
+                res = ENOMEM;
+                break;
+            }
+            reader.name = name;
+            reader.name_size = name_len + 1;
+        }
+        memcpy (reader.name, header + 46, name_len);
+        reader.name[name_len] = '\0';
+
+        res = read_zip_member (
+            &reader, in, len, reader.name, get_u16 (header + 8),
+            get_u16 (header + 10), packed_size, offset);
+    }
+
+#ifdef HAVE_ZLIB
+    if (reader.inflating)
+        inflateEnd (&reader.inflater);
+    free (reader.out);
+#endif
+    free (reader.name);
+    return res;
+}
+
+/** Pass the members of the archive of \a len chars at \a in in
+ *  \a format to \a visitor.
+ *
+ *  \returns The first nonzero value returned by \a visitor, \c EINVAL if
+ *      the archive is corrupt or truncated, \c ENOTSUP if a compressed
+ *      tar archive can't be decompressed, \c ENOMEM if out of memory or
+ *      0.
+ */
+int
+archive_read (
+    enum archive_format format, const char *in, size_t len,
+    const struct archive_visitor *visitor)
+{
+    switch (format)
+    {
+    case ARCHIVE_TAR:
+        return read_tar (in, len, visitor);
+    case ARCHIVE_ZIP:
+        return read_zip (in, len, visitor);
+    default:
+        return EINVAL;
+    }
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,72 @@
+/** \file
+ * Read the members of tar and zip archives in one pass without
+ * extracting them.
+ *
+ * Tar archives may be compressed by any format of \ref decompressor.
+ * Members which aren't selected are skipped without being copied, and
+ * those of zip archives without being inflated.
+ */
+
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Formats of archives whose members are read one after another. */
+enum archive_format
+{
+    ARCHIVE_NONE,   /**< The input is no archive. */
+    ARCHIVE_TAR,    /**< A tar archive, which may be compressed. */
+    ARCHIVE_ZIP     /**< A zip archive of stored or deflated members. */
+};
+
+/** \struct archive_visitor
+ *  \brief Receives the members of an archive from \ref archive_read.
+ *
+ *  The functions return 0 to continue or an \a errno value to stop the
+ *  reading.  Member names are relative paths without a leading
+ *  <tt>./</tt>.
+ *
+ *  \var archive_visitor::select
+ *      Whether the regular file \a name is read.
+ *  \var archive_visitor::begin
+ *      Called before the text of the selected member \a name.
+ *  \var archive_visitor::text
+ *      Receives the text of the member in one or more pieces.
+ *  \var archive_visitor::end
+ *      Called after the last piece of the member.
+ *  \var void *archive_visitor::data
+ *      Passed through to the functions.
+ */
+struct archive_visitor
+{
+    bool (*select) (const char *name, void *data);
+    int (*begin) (const char *name, void *data);
+    int (*text) (const char *text, size_t len, void *data);
+    int (*end) (void *data);
+    void *data;
+};
+
+enum archive_format archive_format_for_file (const char *file_name);
+int archive_read (
+    enum archive_format format, const char *in, size_t len,
+    const struct archive_visitor *visitor);
+
+#endif /* not ARCHIVE_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,492 @@
+/** \file
+ * An on-disk cache of the stripped text of input files.
+ *
+ * The cache directory holds two kinds of entries:
+ *  - content entries named after the hash of the content of an input file,
+ *    which store the stripped text, and
+ *  - stat entries named after the device and inode of an input file, which
+ *    store its size, modification and change time and the hash of its
+ *    content.
+ *
+ * A file whose \c stat data still matches its stat entry is found without
+ * reading it.  Otherwise it is read and hashed, which still finds the text
+ * of files which were only touched or copied, e.g. by a fresh checkout.
+ *
+ * Entries are written to a temporary file which is renamed into place, so
+ * several processes may share one cache directory.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "trace.h"
+
+/** First bytes of each entry. */
+#define CACHE_MAGIC 0x48434344 /* "DCCH" */
+/** Version of the entries.  Has to be increased whenever the stripped
+ *  text of the same input changes. */
+#define CACHE_VERSION 2
+/** Size of the names of entries including the terminating \c NUL. */
+#define CACHE_NAME_SIZE 32
+
+/** \struct file_cache
+ *  \brief An opened cache directory.
+ *
+ *  \var int file_cache::dir_fd
+ *      File descriptor of the directory.
+ *  \var unsigned long file_cache::num_temps
+ *      Number of temporary files created so far.  Makes their names unique
+ *      between threads.
+ */
+struct file_cache
+{
+    int dir_fd;
+    unsigned long num_temps;
+};
+
+/** \struct stat_entry
+ *  \brief The content of a stat entry.
+ */
+struct stat_entry
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    uint64_t content_hash;
+};
+
+/** \struct content_entry
+ *  \brief The header of a content entry, followed by \a text_len chars
+ *      of stripped text.
+ */
+struct content_entry
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t len;
+    uint64_t text_len;
+};
+
+#define PRIME64_1 UINT64_C (0x9E3779B185EBCA87)
+#define PRIME64_2 UINT64_C (0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 UINT64_C (0x165667B19E3779F9)
+#define PRIME64_4 UINT64_C (0x85EBCA77C2B2AE63)
+#define PRIME64_5 UINT64_C (0x27D4EB2F165667C5)
+
+static uint64_t
+rotate_left (uint64_t value, int bits)
+{
+    return value << bits | value >> (64 - bits);
+}
+
+static uint64_t
+read_u64 (const unsigned char *pos)
+{
+    uint64_t value;
+    memcpy (&value, pos, sizeof (value));
+    return value;
+}
+
+static uint64_t
+hash_round (uint64_t acc, uint64_t input)
+{
+    return rotate_left (acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+/** The 64 bit hash of the \a len bytes at \a data.  The algorithm is
+ *  XXH64 with seed 0, which hashes four 64 bit lanes at once. */
+uint64_t
+hash_bytes (const void *data, size_t len)
+{
+    const unsigned char *pos = data;
+    const unsigned char *end = pos + len;
+    uint64_t hash;
+
+    if (len >= 32)
+    {
+        uint64_t lanes[4] = {
+            PRIME64_1 + PRIME64_2, PRIME64_2, 0, 0 - PRIME64_1};
+        for (; end - pos >= 32; pos += 32)
+            for (int lane = 0; lane < 4; ++lane)
+                lanes[lane] = hash_round (lanes[lane], read_u64 (pos + 8 * lane));
+
+        hash = rotate_left (lanes[0], 1) + rotate_left (lanes[1], 7)
+            + rotate_left (lanes[2], 12) + rotate_left (lanes[3], 18);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            hash ^= hash_round (0, lanes[lane]);
+            hash = hash * PRIME64_1 + PRIME64_4;
+        }
+    }
+    else
+        hash = PRIME64_5;
+
+    hash += len;
+    for (; end - pos >= 8; pos += 8)
+    {
+        hash ^= hash_round (0, read_u64 (pos));
+        hash = rotate_left (hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (end - pos >= 4)
+    {
+        uint32_t value;
+        memcpy (&value, pos, sizeof (value));
+        hash ^= value * PRIME64_1;
+        hash = rotate_left (hash, 23) * PRIME64_2 + PRIME64_3;
+        pos += 4;
+    }
+    for (; pos < end; ++pos)
+    {
+        hash ^= *pos * PRIME64_5;
+        hash = rotate_left (hash, 11) * PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+/** Fill \a entry with the data of \a file_stat and \a content_hash. */
+static void
+make_stat_entry (
+    struct stat_entry *entry, const struct stat *file_stat,
+    uint64_t content_hash)
+{
+    memset (entry, 0, sizeof (*entry));
+    entry->magic = CACHE_MAGIC;
+    entry->version = CACHE_VERSION;
+    entry->dev = (uint64_t) file_stat->st_dev;
+    entry->ino = (uint64_t) file_stat->st_ino;
+    entry->size = (uint64_t) file_stat->st_size;
+    entry->mtime_sec = file_stat->st_mtim.tv_sec;
+    entry->mtime_nsec = file_stat->st_mtim.tv_nsec;
+    entry->ctime_sec = file_stat->st_ctim.tv_sec;
+    entry->ctime_nsec = file_stat->st_ctim.tv_nsec;
+    entry->content_hash = content_hash;
+}
+
+/** The hash of the \a len bytes of \a content stripped as \a lang.  The
+ *  texts of the same content in different languages differ. */
+static uint64_t
+content_key (const char *content, size_t len, const char *lang)
+{
+    return hash_round (
+        hash_bytes (content, len), hash_bytes (lang, strlen (lang)));
+}
+
+/** Put the name of the stat entry of \a file_stat stripped as \a lang
+ *  into \a name. */
+static void
+stat_entry_name (
+    char name[CACHE_NAME_SIZE], const struct stat *file_stat, const char *lang)
+{
+    uint64_t key[3] = {
+        (uint64_t) file_stat->st_dev, (uint64_t) file_stat->st_ino,
+        hash_bytes (lang, strlen (lang))};
+    snprintf (
+        name, CACHE_NAME_SIZE, "s%016" PRIx64, hash_bytes (key, sizeof (key)));
+}
+
+/** Put the name of the content entry with \a content_hash into \a name. */
+static void
+content_entry_name (char name[CACHE_NAME_SIZE], uint64_t content_hash)
+{
+    snprintf (name, CACHE_NAME_SIZE, "c%016" PRIx64, content_hash);
+}
+
+/** Read \a len bytes from \a fd into \a buf.
+ *
+ *  \returns \c ENOENT if the file ended before, \a errno if reading
+ *      failed else 0.
+ */
+static int
+read_all (int fd, void *buf, size_t len)
+{
+    for (char *pos = buf; len > 0; )
+    {
+        ssize_t num_read = read (fd, pos, len);
+        if (num_read < 0 && errno != EINTR)
+            return errno;
+        if (num_read == 0)
+            return ENOENT;
+        if (num_read > 0)
+        {
+            pos += num_read;
+            len -= (size_t) num_read;
+        }
+    }
+
+    return 0;
+}
+
+/** Write the \a len bytes at \a buf to \a fd.
+ *
+ *  \returns \a errno if writing failed else 0.
+ */
+static int
+write_all (int fd, const void *buf, size_t len)
+{
+    for (const char *pos = buf; len > 0; )
+    {
+        ssize_t written = write (fd, pos, len);
+        if (written < 0 && errno != EINTR)
+            return errno;
+        if (written > 0)
+        {
+            pos += written;
+            len -= (size_t) written;
+        }
+    }
+
+    return 0;
+}
+
+/** Read the content entry with \a content_hash for a file of \a len
+ *  bytes.
+ *
+ *  \returns 0 if the entry was found and its malloc'd text was put into
+ *      \a text and \a text_len, \c ENOENT if there is no valid entry or
+ *      \a errno.
+ */
+static int
+read_content_entry (
+    struct file_cache *cache, uint64_t content_hash, size_t len,
+    char **text, size_t *text_len)
+{
+    char name[CACHE_NAME_SIZE];
+    content_entry_name (name, content_hash);
+
+    int fd = openat (cache->dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    struct content_entry entry;
+    int res = read_all (fd, &entry, sizeof (entry));
+    if (!res && (entry.magic != CACHE_MAGIC || entry.version != CACHE_VERSION
+                 || entry.len != len || entry.text_len > SIZE_MAX))
+        res = ENOENT;
+
+    if (!res)
+    {
+        *text_len = (size_t) entry.text_len;
+        *text = malloc (*text_len ? *text_len : 1);
+        if (!*text)
+            res = ENOMEM;
+        else if ((res = read_all (fd, *text, *text_len)))
+            free (*text);
+    }
+
+    close (fd);
+    return res;
+}
+
+/** Write an entry named \a name with the \a header_len bytes of \a header
+ *  followed by the \a text_len chars of \a text.
+ *
+ *  \returns \a errno if some I/O error occurred else 0.
+ */
+static int
+write_entry (
+    struct file_cache *cache, const char *name,
+    const void *header, size_t header_len, const char *text, size_t text_len)
+{
+    uint64_t start = trace_begin ();
+    char temp_name[CACHE_NAME_SIZE + 32];
+    snprintf (
+        temp_name, sizeof (temp_name), "tmp.%ld.%lu.%s", (long) getpid (),
+        __atomic_fetch_add (&cache->num_temps, 1, __ATOMIC_RELAXED), name);
+
+    int fd = openat (
+        cache->dir_fd, temp_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+        0666);
+    if (fd < 0)
+        return errno;
+
+    int res = write_all (fd, header, header_len);
+    if (!res)
+        res = write_all (fd, text, text_len);
+    if (close (fd) && !res)
+        res = errno;
+    if (!res && renameat (cache->dir_fd, temp_name, cache->dir_fd, name))
+        res = errno;
+
+    if (res)
+        unlinkat (cache->dir_fd, temp_name, 0);
+    trace_end ("write_cache_entry", start, header_len + text_len, NULL);
+    return res;
+}
+
+/** Write the stat entry for \a file_stat pointing to \a content_hash.
+ *
+ *  \returns \a errno if some I/O error occurred else 0.
+ */
+static int
+write_stat_entry (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    uint64_t content_hash)
+{
+    char name[CACHE_NAME_SIZE];
+    struct stat_entry entry;
+
+    stat_entry_name (name, file_stat, lang);
+    make_stat_entry (&entry, file_stat, content_hash);
+
+    return write_entry (cache, name, &entry, sizeof (entry), NULL, 0);
+}
+
+/** Open the cache in the directory \a dir.  Create \a dir if it doesn't
+ *  exist.
+ *
+ *  \returns The cache or \c NULL with \a errno set on error.  Release with
+ *      \ref file_cache_close.
+ */
+struct file_cache *
+file_cache_open (const char *dir)
+{
+    if (mkdir (dir, 0777) && errno != EEXIST)
+        return NULL;
+
+    struct file_cache *cache = malloc (sizeof (*cache));
+    if (!cache)
+        return NULL;
+
+    cache->dir_fd = open (dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    cache->num_temps = 0;
+    if (cache->dir_fd < 0)
+    {
+        int res = errno;
+        free (cache);
+        errno = res;
+        return NULL;
+    }
+
+    return cache;
+}
+
+/** Release \a cache. */
+void
+file_cache_close (struct file_cache *cache)
+{
+    if (cache)
+    {
+        close (cache->dir_fd);
+        free (cache);
+    }
+}
+
+/** Look up the stripped text of the file with \a file_stat by its device,
+ *  inode, size and times alone.
+ *
+ *  \param lang The name of the language the text was stripped as.
+ *
+ *  \returns 0 if the text was found and put into \a text and \a text_len,
+ *      which has to be freed, \c ENOENT if it wasn't found or \a errno if
+ *      some I/O error occurred.
+ */
+int
+file_cache_find_stat (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    char **text, size_t *text_len)
+{
+    char name[CACHE_NAME_SIZE];
+    stat_entry_name (name, file_stat, lang);
+
+    int fd = openat (cache->dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    struct stat_entry entry, expected;
+    int res = read_all (fd, &entry, sizeof (entry));
+    close (fd);
+    if (res)
+        return res;
+
+    make_stat_entry (&expected, file_stat, entry.content_hash);
+    if (memcmp (&entry, &expected, sizeof (entry)))
+        return ENOENT;
+
+    return read_content_entry (
+        cache, entry.content_hash, (size_t) file_stat->st_size,
+        text, text_len);
+}
+
+/** Look up the stripped text of the \a len bytes of \a content of the file
+ *  with \a file_stat as \a lang by a hash of \a content.  If it is found, the stat
+ *  entry of the file is renewed.
+ *
+ *  \returns 0 if the text was found and put into \a text and \a text_len,
+ *      which has to be freed, \c ENOENT if it wasn't found or \a errno if
+ *      some I/O error occurred.
+ */
+int
+file_cache_find_content (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    const char *content, size_t len, char **text, size_t *text_len)
+{
+    uint64_t content_hash = content_key (content, len, lang);
+    int res = read_content_entry (cache, content_hash, len, text, text_len);
+
+    /* A missing stat entry only costs hashing the file again. */
+    if (!res)
+        write_stat_entry (cache, file_stat, lang, content_hash);
+
+    return res;
+}
+
+/** Store the \a text_len chars of \a text as the \a len bytes of
+ *  \a content of the file with \a file_stat stripped as \a lang.
+ *
+ *  \returns \a errno if some I/O error occurred else 0.
+ */
+int
+file_cache_add (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    const char *content, size_t len, const char *text, size_t text_len)
+{
+    uint64_t content_hash = content_key (content, len, lang);
+    char name[CACHE_NAME_SIZE];
+    struct content_entry entry = {
+        CACHE_MAGIC, CACHE_VERSION, (uint64_t) len, (uint64_t) text_len};
+
+    content_entry_name (name, content_hash);
+    int res = write_entry (cache, name, &entry, sizeof (entry), text, text_len);
+    if (!res)
+        res = write_stat_entry (cache, file_stat, lang, content_hash);
+
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,44 @@
+/** \file
+ * An on-disk cache of the stripped text of input files.
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+struct file_cache;
+
+uint64_t hash_bytes (const void *data, size_t len);
+
+struct file_cache *file_cache_open (const char *dir);
+void file_cache_close (struct file_cache *cache);
+int file_cache_find_stat (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    char **text, size_t *text_len);
+int file_cache_find_content (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    const char *content, size_t len, char **text, size_t *text_len);
+int file_cache_add (
+    struct file_cache *cache, const struct stat *file_stat, const char *lang,
+    const char *content, size_t len, const char *text, size_t text_len);
+
+#endif /* not CACHE_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,54 @@
+/** \file
+ * The table of the classes of all bytes. */
+
+#include "char_class.h"
+
+/* Abbreviations for the table below. */
+#define S_ CHAR_SPACE
+#define L_ (CHAR_IDENT_START | CHAR_IDENT)
+#define C_ (L_ | CHAR_UPPER)
+#define D_ CHAR_IDENT
+#define Q_ CHAR_QUOTE
+#define SL CHAR_SLASH
+#define ST CHAR_STAR
+#define BS CHAR_BACKSLASH
+#define U_ L_   /* Bytes of multibyte UTF-8 sequences count as letters. */
+
+/** The \ref char_class flags of each byte. */
+const unsigned char char_classes[256] = {
+/*        0   1   2   3   4   5   6   7   8   9   a   b   c   d   e   f */
+/* 0x */  0,  0,  0,  0,  0,  0,  0,  0,  0, S_, S_, S_, S_, S_,  0,  0,
+/* 1x */  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+/*    ' '  !   "   #   $   %   &   '   (   )   *   +   ,   -   .   /  */
+/* 2x */ S_,  0, Q_,  0,  0,  0,  0, Q_,  0,  0, ST,  0,  0,  0,  0, SL,
+/* 3x */ D_, D_, D_, D_, D_, D_, D_, D_, D_, D_,  0,  0,  0,  0,  0,  0,
+/* 4x */  0, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_,
+/*        P   Q   R   S   T   U   V   W   X   Y   Z   [   \   ]   ^   _  */
+/* 5x */ C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_,  0, BS,  0,  0, L_,
+/* 6x */  0, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_,
+/* 7x */ L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_,  0,  0,  0,  0,  0,
+/* 8x */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* 9x */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* ax */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* bx */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* cx */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* dx */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* ex */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+/* fx */ U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_,
+};
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,55 @@
+/** \file
+ * Locale independent classes of the bytes of source files.
+ *
+ * Each byte has a set of \ref char_class flags in \ref char_classes, so
+ * the lexer and the word tokenizer classify a byte with one table lookup
+ * and behave the same whatever \c LC_CTYPE is.
+ */
+
+#ifndef CHAR_CLASS_H_
+#define CHAR_CLASS_H_
+
+#include <stdbool.h>
+
+/** Flags of \ref char_classes.  A byte may have several. */
+enum char_class
+{
+    CHAR_SPACE = 0x01,          /**< White space of the "C" locale. */
+    CHAR_IDENT_START = 0x02,    /**< Letters, \c _ and non-ASCII bytes. */
+    CHAR_IDENT = 0x04,          /**< Identifier starts and digits. */
+    CHAR_QUOTE = 0x08,          /**< \c " and \c '. */
+    CHAR_SLASH = 0x10,          /**< \c / */
+    CHAR_STAR = 0x20,           /**< \c * */
+    CHAR_BACKSLASH = 0x40,      /**< \c \\ */
+    CHAR_UPPER = 0x80,          /**< ASCII capital letters. */
+
+    /** Bytes which end a run of code copied verbatim. */
+    CHAR_CLUTTER_START = CHAR_SPACE | CHAR_QUOTE | CHAR_SLASH
+};
+
+extern const unsigned char char_classes[256];
+
+/** Whether \a cur has one of the \ref char_class flags in \a classes. */
+static inline bool
+char_is (char cur, unsigned classes)
+{
+    return char_classes[(unsigned char) cur] & classes;
+}
+
+#endif /* not CHAR_CLASS_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,308 @@
+/** \file
+ * Strip a single large input on several threads.
+ *
+ * The input is split into chunks.  Because the lexer state at the start of
+ * a chunk is unknown, each chunk is first scanned speculatively from every
+ * possible state to learn the state at its end.  A prefix pass over the
+ * chunks then resolves the real state at the start of each chunk and the
+ * chunks are stripped in parallel from these states.  If the scans of a
+ * chunk don't converge, e.g. inside of a comment spanning the chunks, the
+ * input is stripped sequentially instead.  The output is the same as for
+ * \ref remove_clutter_buf on the whole input. */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "trace.h"
+
+/** Chunks are not made smaller than this. */
+#define MIN_CHUNK_SIZE (1024 * 1024)
+
+/** Size of the steps of the speculative scan after which tracks which
+ *  reached the same state are merged. */
+#define SPECULATION_STEP (4 * 1024)
+
+/** The speculative scans of a chunk are given up if they haven't merged
+ *  into one after this many bytes. */
+#define SPECULATION_LIMIT (64 * 1024)
+
+/** \struct chunk
+ *  \brief A part of the input processed by one thread.
+ *
+ *  \var enum clutter_state chunk::end_state
+ *      For each start state the state after the chunk.
+ *  \var enum clutter_state chunk::start_state
+ *      The real state at the start of the chunk.
+ *  \var bool chunk::speculate
+ *      Whether \a end_state is needed for all start states or only for
+ *      \a start_state.
+ *  \var bool chunk::converged
+ *      Whether \a end_state is known, i.e. the speculative scans weren't
+ *      given up.
+ *  \var char *chunk::text
+ *      The output for the chunk.
+ *  \var struct clutter_stats chunk::stats
+ *      What was removed from the chunk.
+ *  \var bool chunk::threaded
+ *      Whether \a thread was started for the chunk.
+ */
+struct chunk
+{
+    const char *in;
+    size_t len;
+    enum clutter_state end_state[CLUTTER_NUM_STATES];
+    enum clutter_state start_state;
+    bool speculate;
+    bool converged;
+    char *text;
+    size_t text_len;
+    size_t text_size;
+    struct clutter_stats stats;
+    int res;
+    pthread_t thread;
+    bool threaded;
+};
+
+/** A \ref clutter_sink which discards the text. */
+static int
+discard_text (const char *text, size_t len, void *sink_data)
+{
+    (void) text;
+    (void) len;
+    (void) sink_data;
+    return 0;
+}
+
+/** A \ref clutter_sink which appends the text to the \ref chunk passed as
+ *  \a sink_data. */
+static int
+append_chunk_text (const char *text, size_t len, void *sink_data)
+{
+    struct chunk *chunk = sink_data;
+
+    if (chunk->text_len + len > chunk->text_size)
+    {
+        size_t size = chunk->text_size ? chunk->text_size : 4096;
+        while (size < chunk->text_len + len)
+            size *= 2;
+        char *grown = realloc (chunk->text, size);
+        if (!grown)
+            return ENOMEM;
+        chunk->text = grown;
+        chunk->text_size = size;
+    }
+
+    memcpy (chunk->text + chunk->text_len, text, len);
+    chunk->text_len += len;
+    return 0;
+}
+
+/** Compute \a end_state of \a chunk for all start states.
+ *
+ *  All states are scanned in lockstep.  Start states whose scans reach the
+ *  same state share a single scan from then on: in C sources most of them
+ *  converge after a few lines.  If more than one scan is left after
+ *  \ref SPECULATION_LIMIT bytes, the rest of the chunk isn't scanned and
+ *  \a converged stays false.
+ */
+static void
+speculate_chunk (struct chunk *chunk)
+{
+    enum clutter_state track_state[CLUTTER_NUM_STATES];
+    uint32_t track_starts[CLUTTER_NUM_STATES];
+    int num_tracks = 0;
+
+    if (!chunk->speculate)
+    {
+        track_state[0] = chunk->start_state;
+        track_starts[0] = 1u << chunk->start_state;
+        num_tracks = 1;
+    }
+    else
+        for (; num_tracks < CLUTTER_NUM_STATES; ++num_tracks)
+        {
+            track_state[num_tracks] = num_tracks;
+            track_starts[num_tracks] = 1u << num_tracks;
+        }
+
+    size_t pos = 0;
+    while (pos < chunk->len)
+    {
+        size_t step = chunk->len - pos;
+        if (num_tracks > 1 && step > SPECULATION_STEP)
+            step = SPECULATION_STEP;
+
+        for (int track = 0; track < num_tracks; ++track)
+            remove_clutter_buf (
+                chunk->in + pos, step, &track_state[track], NULL,
+                discard_text, NULL);
+
+        for (int track = 0; track < num_tracks; ++track)
+            for (int other = track + 1; other < num_tracks; ++other)
+                if (track_state[other] == track_state[track])
+                {
+                    track_starts[track] |= track_starts[other];
+                    track_state[other] = track_state[--num_tracks];
+                    track_starts[other] = track_starts[num_tracks];
+                    --other;
+                }
+
+        pos += step;
+        if (num_tracks > 1 && pos >= SPECULATION_LIMIT)
+            return;
+    }
+
+    chunk->converged = true;
+    for (int track = 0; track < num_tracks; ++track)
+        for (int state = 0; state < CLUTTER_NUM_STATES; ++state)
+            if (track_starts[track] & (1u << state))
+                chunk->end_state[state] = track_state[track];
+}
+
+/** Thread function: \ref speculate_chunk for the chunk argument. */
+static void *
+speculate_chunk_worker (void *chunk_arg)
+{
+    struct chunk *chunk = chunk_arg;
+    uint64_t start = trace_begin ();
+    speculate_chunk (chunk);
+    trace_end ("speculate_chunk", start, chunk->len, NULL);
+    return NULL;
+}
+
+/** Thread function: strip the chunk argument from its start state. */
+static void *
+strip_chunk_worker (void *chunk_arg)
+{
+    struct chunk *chunk = chunk_arg;
+    enum clutter_state state = chunk->start_state;
+    uint64_t start = trace_begin ();
+
+    chunk->res = remove_clutter_buf (
+        chunk->in, chunk->len, &state, &chunk->stats, append_chunk_text,
+        chunk);
+    trace_end ("strip_chunk", start, chunk->len, NULL);
+    return NULL;
+}
+
+/** Run \a worker for all \a num_chunks \a chunks on a thread each.  A chunk
+ *  is processed by the calling thread if no thread can be created. */
+static void
+run_chunk_workers (
+    struct chunk *chunks, int num_chunks, void *(*worker) (void *))
+{
+    for (int chunk = 0; chunk < num_chunks; ++chunk)
+    {
+        chunks[chunk].threaded = !pthread_create (
+            &chunks[chunk].thread, NULL, worker, &chunks[chunk]);
+        if (!chunks[chunk].threaded)
+            worker (&chunks[chunk]);
+    }
+
+    for (int chunk = 0; chunk < num_chunks; ++chunk)
+        if (chunks[chunk].threaded)
+            pthread_join (chunks[chunk].thread, NULL);
+}
+
+/** Like \ref remove_clutter_buf followed by \ref remove_clutter_end but
+ *  split \a in into up to \a num_jobs chunks which are stripped on
+ *  separate threads.  The text is passed to \a sink in order after all
+ *  chunks are processed.
+ *
+ *  \param in The complete input text.
+ *  \param len The length of \a in.
+ *  \param num_jobs The maximal number of threads.  Inputs shorter than
+ *      two chunks of 1 MiB are processed on the calling thread.
+ *  \param stats If not \c NULL, the chars of \a in and the removed chars
+ *      are added to it.
+ *  \param sink Receives the non-skipped text.
+ *  \param sink_data Passed through to \a sink.
+ *  \returns The first nonzero value returned by \a sink, \c ENOMEM if
+ *      the output couldn't be buffered or 0.
+ */
+int
+remove_clutter_parallel (
+    const char *in, size_t len, int num_jobs, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    enum clutter_state state = CLUTTER_CODE;
+    size_t max_chunks = len / MIN_CHUNK_SIZE;
+    int num_chunks = max_chunks < (size_t) num_jobs ? (int) max_chunks : num_jobs;
+
+    if (num_chunks < 2)
+    {
+        int res = remove_clutter_buf (in, len, &state, stats, sink, sink_data);
+        return res ? res : remove_clutter_end (&state, sink, sink_data);
+    }
+
+    struct chunk *chunks = calloc ((size_t) num_chunks, sizeof (*chunks));
+    if (!chunks)
+        return ENOMEM;
+
+    size_t chunk_len = len / (size_t) num_chunks;
+    for (int chunk = 0; chunk < num_chunks; ++chunk)
+    {
+        chunks[chunk].in = in + (size_t) chunk * chunk_len;
+        chunks[chunk].len =
+            chunk == num_chunks - 1 ? len - (size_t) chunk * chunk_len : chunk_len;
+        chunks[chunk].start_state = CLUTTER_CODE;
+        chunks[chunk].speculate = chunk > 0;
+    }
+
+    run_chunk_workers (chunks, num_chunks, speculate_chunk_worker);
+
+    /* Scanning all states of a chunk to its end would cost more than
+     * stripping the input on a single thread. */
+    bool converged = true;
+    for (int chunk = 0; chunk < num_chunks; ++chunk)
+        converged = converged && chunks[chunk].converged;
+    if (!converged)
+    {
+        free (chunks);
+        int res = remove_clutter_buf (in, len, &state, stats, sink, sink_data);
+        return res ? res : remove_clutter_end (&state, sink, sink_data);
+    }
+
+    for (int chunk = 1; chunk < num_chunks; ++chunk)
+        chunks[chunk].start_state =
+            chunks[chunk - 1].end_state[chunks[chunk - 1].start_state];
+    state = chunks[num_chunks - 1].end_state[chunks[num_chunks - 1].start_state];
+
+    run_chunk_workers (chunks, num_chunks, strip_chunk_worker);
+
+    int res = 0;
+    for (int chunk = 0; chunk < num_chunks; ++chunk)
+    {
+        if (!res)
+            res = chunks[chunk].res;
+        if (!res && chunks[chunk].text_len)
+            res = sink (chunks[chunk].text, chunks[chunk].text_len, sink_data);
+        if (stats)
+            clutter_stats_add (stats, &chunks[chunk].stats);
+        free (chunks[chunk].text);
+    }
+    free (chunks);
+
+    return res ? res : remove_clutter_end (&state, sink, sink_data);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,170 @@
+/** \file
+ * A push interface to the lexer for programs which receive their input in
+ * buffers instead of files. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+
+/** \struct dc_ctx
+ *  \brief The state of one input pushed by \ref dc_feed.
+ *
+ *  \var const struct clutter_lang *dc_ctx::lang
+ *      The language of the input.  \c NULL for C.
+ *  \var unsigned dc_ctx::state
+ *      The lexer state of \a lang after the last buffer.
+ *  \var struct word_tokenizer dc_ctx::tokenizer
+ *      The word split between buffers for \ref DC_OUTPUT_WORDS.
+ *  \var struct clutter_stats dc_ctx::stats
+ *      What was removed from all input since the creation.
+ *  \var int dc_ctx::error
+ *      The first error of the callback since the input started.
+ */
+struct dc_ctx
+{
+    enum dc_output output;
+    clutter_sink *callback;
+    void *user_data;
+    const struct clutter_lang *lang;
+    unsigned state;
+    struct word_tokenizer tokenizer;
+    struct clutter_stats stats;
+    int error;
+};
+
+/** Create a context which passes the stripped text or its words, as
+ *  selected by \a output, to \a callback with \a user_data.
+ *
+ *  A context keeps all state of the input between the calls of
+ *  \ref dc_feed, which don't allocate memory.  Different contexts may be
+ *  used by different threads at the same time.
+ *
+ *  \returns The new context or \c NULL if out of memory.
+ */
+struct dc_ctx *
+dc_ctx_new (enum dc_output output, clutter_sink *callback, void *user_data)
+{
+    struct dc_ctx *ctx = malloc (sizeof (*ctx));
+    if (!ctx)
+        return NULL;
+
+    ctx->output = output;
+    ctx->callback = callback;
+    ctx->user_data = user_data;
+    ctx->lang = NULL;
+    ctx->state = 0;
+    word_tokenizer_init_sink (&ctx->tokenizer, callback, user_data);
+    memset (&ctx->stats, 0, sizeof (ctx->stats));
+    ctx->error = 0;
+    return ctx;
+}
+
+/** Free \a ctx.  Output pending since the last \ref dc_finish is dropped. */
+void
+dc_ctx_free (struct dc_ctx *ctx)
+{
+    free (ctx);
+}
+
+/** Strip the following inputs of \a ctx as \a lang, C if \c NULL.  Has
+ *  to be called before the first or right after \ref dc_finish. */
+void
+dc_ctx_set_lang (struct dc_ctx *ctx, const struct clutter_lang *lang)
+{
+    ctx->lang = lang;
+    ctx->state = 0;
+}
+
+/** Drop the words of \a keywords and \a stopwords from the words passed
+ *  to the callback of \ref DC_OUTPUT_WORDS, see
+ *  \ref clutter_lang_keywords.  Either may be \c NULL. */
+void
+dc_ctx_set_filters (
+    struct dc_ctx *ctx, const struct word_filter *keywords,
+    const struct word_filter *stopwords)
+{
+    word_tokenizer_set_filters (&ctx->tokenizer, keywords, stopwords);
+}
+
+/** Process the next \a len chars \a buf of the input of \a ctx.  The input
+ *  may be split anywhere, even inside comments, literals and words.
+ *
+ *  The callback receives pointers into \a buf where possible, so the text
+ *  passed to it is only valid during the call.
+ *
+ *  \returns The first error returned by the callback for this input, which
+ *      stops the processing until \ref dc_finish, else 0.
+ */
+int
+dc_feed (struct dc_ctx *ctx, const char *buf, size_t len)
+{
+    if (ctx->error)
+        return ctx->error;
+
+    if (ctx->output == DC_OUTPUT_WORDS)
+        ctx->error = remove_clutter_lang_buf (
+            ctx->lang, buf, len, &ctx->state, &ctx->stats,
+            count_words, &ctx->tokenizer);
+    else
+        ctx->error = remove_clutter_lang_buf (
+            ctx->lang, buf, len, &ctx->state, &ctx->stats,
+            ctx->callback, ctx->user_data);
+
+    return ctx->error;
+}
+
+/** Pass the output still pending at the end of the input of \a ctx to the
+ *  callback.  Afterwards \a ctx is ready for the next input.
+ *
+ *  \returns The first error returned by the callback for this input, else
+ *      0.
+ */
+int
+dc_finish (struct dc_ctx *ctx)
+{
+    int res = ctx->error;
+
+    if (ctx->output == DC_OUTPUT_WORDS)
+    {
+        if (!res)
+            res = remove_clutter_lang_end (
+                ctx->lang, &ctx->state, &ctx->stats,
+                count_words, &ctx->tokenizer);
+        if (!res)
+            res = word_tokenizer_end (&ctx->tokenizer);
+    }
+    else if (!res)
+        res = remove_clutter_lang_end (
+            ctx->lang, &ctx->state, &ctx->stats,
+            ctx->callback, ctx->user_data);
+
+    ctx->state = 0;
+    ctx->tokenizer.len = 0;
+    ctx->tokenizer.in_word = false;
+    ctx->error = 0;
+    return res;
+}
+
+/** What was removed from all input fed to \a ctx since its creation. */
+const struct clutter_stats *
+dc_ctx_stats (const struct dc_ctx *ctx)
+{
+    return &ctx->stats;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
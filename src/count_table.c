@@ -0,0 +1,434 @@
+/** \file
+ * A binary file format for word counts which can be merged without
+ * building a hash table.
+ *
+ * A table starts with the 8 byte signature \ref table_signature followed
+ * by the format version and reserved flags as 32 bit little endian
+ * numbers.  Then come the words in ascending byte order, each as
+ *  - the number of leading chars shared with the word before,
+ *  - the number of the remaining chars,
+ *  - the remaining chars and
+ *  - the count,
+ * where the numbers are unsigned LEB128 varints.  A record with two zeros
+ * ends the table; real words always have remaining chars.
+ *
+ * Tables are read sequentially from a memory mapping, so merging \a k
+ * tables of \a n words takes \a O(n log k) time and constant memory per
+ * table.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "domaincloud.h"
+
+/** Format version written to new tables. */
+#define TABLE_VERSION 1
+
+/** The first bytes of a table.  Like for PNG the non ASCII and line end
+ *  bytes reveal mangled transfers. */
+static const unsigned char table_signature[8] = {
+    0x89, 'D', 'C', 'T', '\r', '\n', 0x1a, '\n'};
+
+/** \struct table_reader
+ *  \brief The current word of a table which is read.
+ *
+ *  \var const unsigned char *table_reader::pos
+ *      Start of the next record.
+ *  \var void *table_reader::map
+ *      The memory mapping of the table.
+ *  \var char table_reader::word[]
+ *      The current word, zero terminated.
+ */
+struct table_reader
+{
+    const unsigned char *pos;
+    const unsigned char *end;
+    void *map;
+    size_t map_len;
+    bool mapped;
+    char word[WORD_MAX_LEN + 1];
+    size_t len;
+    unsigned long count;
+};
+
+/** Order of two words: by bytes and shorter first if one is the start of
+ *  the other. */
+static int
+compare_words (const char *lhs, size_t lhs_len, const char *rhs, size_t rhs_len)
+{
+    int res = memcmp (lhs, rhs, lhs_len < rhs_len ? lhs_len : rhs_len);
+    if (res)
+        return res;
+    return (lhs_len > rhs_len) - (lhs_len < rhs_len);
+}
+
+/** \c qsort comparison of two \ref word_count by their words. */
+static int
+compare_word_count_words (const void *lhs_arg, const void *rhs_arg)
+{
+    const struct word_count *lhs = lhs_arg, *rhs = rhs_arg;
+    return compare_words (lhs->word, lhs->len, rhs->word, rhs->len);
+}
+
+/** Write \a value as LEB128 varint to \a ostr. */
+static void
+put_varint (uint64_t value, FILE *ostr)
+{
+    while (value >= 0x80)
+    {
+        putc ((int) (value & 0x7f) | 0x80, ostr);
+        value >>= 7;
+    }
+    putc ((int) value, ostr);
+}
+
+/** Write the header of a table to \a ostr. */
+static void
+put_header (FILE *ostr)
+{
+    const unsigned char version_and_flags[8] = {TABLE_VERSION, 0, 0, 0};
+
+    fwrite (table_signature, 1, sizeof (table_signature), ostr);
+    fwrite (version_and_flags, 1, sizeof (version_and_flags), ostr);
+}
+
+/** Write the record for the \a len chars of \a word with \a count to
+ *  \a ostr.  \a prev and \a prev_len are the word written before. */
+static void
+put_record (
+    const char *prev, size_t prev_len, const char *word, size_t len,
+    unsigned long count, FILE *ostr)
+{
+    size_t shared = 0;
+    while (shared < prev_len && shared < len && prev[shared] == word[shared])
+        ++shared;
+
+    put_varint (shared, ostr);
+    put_varint (len - shared, ostr);
+    fwrite (word + shared, 1, len - shared, ostr);
+    put_varint (count, ostr);
+}
+
+/** Write the end of a table to \a ostr.
+ *
+ *  \returns \a errno if writing to \a ostr failed else 0.
+ */
+static int
+put_end (FILE *ostr)
+{
+    put_varint (0, ostr);
+    put_varint (0, ostr);
+
+    if (fflush (ostr) || ferror (ostr))
+        return errno ? errno : EIO;
+    return 0;
+}
+
+/** Write \a counts as binary table to \a ostr.  Tables are read by
+ *  \ref word_counts_read_table and merged by \ref merge_count_tables.
+ *
+ *  \returns \c ENOMEM if out of memory, \a errno if writing to \a ostr
+ *      failed else 0.
+ */
+int
+word_counts_write_table (const struct word_counts *counts, FILE *ostr)
+{
+    struct word_count *words = word_counts_sorted (counts);
+    if (!words)
+        return ENOMEM;
+
+    size_t num_words = word_counts_size (counts);
+    qsort (words, num_words, sizeof (*words), compare_word_count_words);
+
+    put_header (ostr);
+    for (size_t word = 0; word < num_words; ++word)
+        put_record (
+            word ? words[word - 1].word : "", word ? words[word - 1].len : 0,
+            words[word].word, words[word].len, words[word].count, ostr);
+    free (words);
+
+    return put_end (ostr);
+}
+
+/** Read a LEB128 varint at the position of \a reader into \a value.
+ *
+ *  \returns Whether the varint was complete.
+ */
+static bool
+get_varint (struct table_reader *reader, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; reader->pos < reader->end && shift < 64; shift += 7)
+    {
+        unsigned char byte = *reader->pos++;
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+/** Advance \a reader to the next word.
+ *
+ *  \returns 1 if there is a next word, 0 at the end of the table and
+ *      \c -1 if the table is corrupted.
+ */
+static int
+next_word (struct table_reader *reader)
+{
+    uint64_t shared, rest, count;
+    if (!get_varint (reader, &shared) || !get_varint (reader, &rest))
+        return -1;
+    if (!shared && !rest)
+        return 0;
+
+    if (shared > reader->len || !rest || rest > WORD_MAX_LEN - shared
+        || rest > (uint64_t) (reader->end - reader->pos))
+        return -1;
+
+    char prev_char = shared < reader->len ? reader->word[shared] : '\0';
+    memcpy (reader->word + shared, reader->pos, rest);
+    reader->pos += rest;
+    size_t prev_len = reader->len;
+    reader->len = (size_t) (shared + rest);
+    reader->word[reader->len] = '\0';
+
+    /* The words have to ascend for merging. */
+    if (shared < prev_len
+        && (unsigned char) reader->word[shared] <= (unsigned char) prev_char)
+        return -1;
+
+    if (!get_varint (reader, &count))
+        return -1;
+    reader->count = (unsigned long) count;
+
+    return 1;
+}
+
+/** Map the table \a file_name for \a reader and check its header.
+ *
+ *  \returns 0 on success, \c EINVAL if \a file_name is no table or
+ *      \a errno.
+ */
+static int
+open_table (struct table_reader *reader, const char *file_name)
+{
+    memset (reader, 0, sizeof (*reader));
+
+    int fd = open (file_name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+
+    struct stat table_stat;
+    int res = fstat (fd, &table_stat) ? errno : 0;
+    if (!res && table_stat.st_size < 16)
+        res = EINVAL;
+    if (!res)
+    {
+        reader->map_len = (size_t) table_stat.st_size;
+        reader->map = mmap (
+            NULL, reader->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (reader->map == MAP_FAILED)
+            res = errno;
+        else
+        {
+            reader->mapped = true;
+            madvise (reader->map, reader->map_len, MADV_SEQUENTIAL);
+        }
+    }
+    close (fd);
+    if (res)
+        return res;
+
+    const unsigned char *header = reader->map;
+    uint32_t version = header[8] | (uint32_t) header[9] << 8
+        | (uint32_t) header[10] << 16 | (uint32_t) header[11] << 24;
+    if (memcmp (header, table_signature, sizeof (table_signature))
+        || version != TABLE_VERSION)
+    {
+        munmap (reader->map, reader->map_len);
+        return EINVAL;
+    }
+
+    reader->pos = header + 16;
+    reader->end = header + reader->map_len;
+
+    return 0;
+}
+
+/** Release the mapping of \a reader. */
+static void
+close_table (struct table_reader *reader)
+{
+    if (reader->mapped)
+        munmap (reader->map, reader->map_len);
+    reader->mapped = false;
+}
+
+/** Add the words of the table \a file_name to \a counts.
+ *
+ *  \returns 0 on success, \c EINVAL if \a file_name is no valid table,
+ *      \c ENOMEM if out of memory or \a errno if it can't be read.
+ */
+int
+word_counts_read_table (struct word_counts *counts, const char *file_name)
+{
+    struct table_reader reader;
+    int res = open_table (&reader, file_name);
+    if (res)
+        return res;
+
+    int more = 0;
+    while (!res && (more = next_word (&reader)) > 0)
+        res = word_counts_add (counts, reader.word, reader.len, reader.count);
+    if (!res && more < 0)
+        res = EINVAL;
+
+    close_table (&reader);
+    return res;
+}
+
+/** Whether the current word of \a lhs comes after the one of \a rhs. */
+static bool
+reader_after (const struct table_reader *lhs, const struct table_reader *rhs)
+{
+    return compare_words (lhs->word, lhs->len, rhs->word, rhs->len) > 0;
+}
+
+/** Restore the order of the binary min heap \a heap of \a size readers
+ *  below \a node after the element at \a node changed. */
+static void
+sift_down (struct table_reader **heap, size_t size, size_t node)
+{
+    size_t parent = node;
+    while (true)
+    {
+        size_t child = 2 * parent + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && reader_after (heap[child], heap[child + 1]))
+            ++child;
+        if (!reader_after (heap[parent], heap[child]))
+            break;
+
+        struct table_reader *tmp = heap[parent];
+        heap[parent] = heap[child];
+        heap[child] = tmp;
+        parent = child;
+    }
+}
+
+/** Merge the \a num_tables tables \a table_files into one table with the
+ *  summed counts and write it to \a ostr.  The tables are read in a single
+ *  pass like in a merge sort.
+ *
+ *  \param bad_table Set to the index of the table which couldn't be read,
+ *      if any.
+ *  \returns 0 on success, \c EINVAL if a table is invalid, \c ENOMEM if
+ *      out of memory or \a errno if a table can't be read or \a ostr can't
+ *      be written.
+ */
+int
+merge_count_tables (
+    char **table_files, int num_tables, FILE *ostr, int *bad_table)
+{
+    struct table_reader *readers = calloc (
+        num_tables ? (size_t) num_tables : 1, sizeof (*readers));
+    struct table_reader **heap = calloc (
+        num_tables ? (size_t) num_tables : 1, sizeof (*heap));
+    if (!readers || !heap)
+    {
+        free (readers);
+        free (heap);
+        return ENOMEM;
+    }
+
+    int res = 0;
+    size_t heap_size = 0;
+    int opened = 0;
+    for (; !res && opened < num_tables; ++opened)
+    {
+        res = open_table (&readers[opened], table_files[opened]);
+        int more = res ? 0 : next_word (&readers[opened]);
+        if (more < 0)
+            res = EINVAL;
+        if (res)
+            *bad_table = opened;
+        else if (more)
+            heap[heap_size++] = &readers[opened];
+    }
+
+    /* Heapify by sifting down all inner nodes from the last one. */
+    for (size_t node = heap_size / 2; node-- > 0; )
+        sift_down (heap, heap_size, node);
+
+    char prev[WORD_MAX_LEN];
+    size_t prev_len = 0;
+    if (!res)
+        put_header (ostr);
+    while (!res && heap_size > 0)
+    {
+        struct table_reader *top = heap[0];
+        char word[WORD_MAX_LEN];
+        size_t len = top->len;
+        unsigned long count = 0;
+        memcpy (word, top->word, len);
+
+        /* Take the word from all tables which have it. */
+        while (heap_size > 0 && !compare_words (
+                   heap[0]->word, heap[0]->len, word, len))
+        {
+            struct table_reader *reader = heap[0];
+            count += reader->count;
+
+            int more = next_word (reader);
+            if (more < 0)
+            {
+                res = EINVAL;
+                *bad_table = (int) (reader - readers);
+                break;
+            }
+            if (!more)
+                heap[0] = heap[--heap_size];
+            sift_down (heap, heap_size, 0);
+        }
+
+        put_record (prev, prev_len, word, len, count, ostr);
+        memcpy (prev, word, len);
+        prev_len = len;
+    }
+    if (!res)
+        res = put_end (ostr);
+
+    for (int reader = 0; reader < opened; ++reader)
+        close_table (&readers[reader]);
+    free (heap);
+    free (readers);
+
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,490 @@
+/** \file
+ * Streaming decompression of a compressed input in memory into a ring
+ * of blocks. */
+
+#if defined (HAVE_CONFIG_H) && HAVE_CONFIG_H
+    #include "config.h"
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+    #include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+    #include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+    #include <zstd.h>
+#endif
+
+#include "decompress.h"
+
+/** Size of the blocks of decompressed text. */
+#define BLOCK_SIZE (256 * 1024)
+/** Number of blocks the decompressing thread may be ahead of the
+ *  reader, including the one the reader holds. */
+#define NUM_BLOCKS 4
+
+/** \struct decompressor
+ *  \brief The state of a decompression.  All members after \a lock are
+ *      protected by it.
+ *
+ *  \var size_t decompressor::in_pos
+ *      Number of chars of \a in passed to the codec.
+ *  \var char *decompressor::blocks
+ *      \ref NUM_BLOCKS blocks of \ref BLOCK_SIZE chars each.
+ *  \var bool decompressor::threaded
+ *      Whether \a thread fills the blocks, else the reader does.
+ *  \var unsigned long decompressor::filled
+ *      Number of blocks filled so far.  Block \c i is at
+ *      <tt>blocks + i % NUM_BLOCKS * BLOCK_SIZE</tt>.
+ *  \var unsigned long decompressor::taken
+ *      Number of blocks the reader is done with.
+ *  \var bool decompressor::holding
+ *      Whether the reader holds the block after the \a taken ones.
+ *  \var bool decompressor::finished
+ *      Whether the end of the input or an error was reached.
+ */
+struct decompressor
+{
+    enum compression compression;
+    const char *in;
+    size_t in_len;
+    size_t in_pos;
+    union
+    {
+        int none;
+#ifdef HAVE_ZLIB
+        z_stream gzip;
+#endif
+#ifdef HAVE_LZMA
+        lzma_stream xz;
+#endif
+#ifdef HAVE_ZSTD
+        ZSTD_DStream *zstd;
+#endif
+    } codec;
+    char *blocks;
+    size_t lens[NUM_BLOCKS];
+    bool threaded;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    unsigned long filled;
+    unsigned long taken;
+    bool holding;
+    bool finished;
+    bool stopping;
+    int error;
+};
+
+/** The compression of the \a len chars at \a data by their magic bytes.
+ *  Formats whose library is missing are detected as well. */
+enum compression
+input_compression (const char *data, size_t len)
+{
+    static const unsigned char gzip_magic[] = {0x1F, 0x8B};
+    static const unsigned char zstd_magic[] = {0x28, 0xB5, 0x2F, 0xFD};
+    static const unsigned char xz_magic[] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+
+    if (len >= sizeof (gzip_magic)
+        && !memcmp (data, gzip_magic, sizeof (gzip_magic)))
+        return COMPRESSION_GZIP;
+    if (len >= sizeof (zstd_magic)
+        && !memcmp (data, zstd_magic, sizeof (zstd_magic)))
+        return COMPRESSION_ZSTD;
+    if (len >= sizeof (xz_magic)
+        && !memcmp (data, xz_magic, sizeof (xz_magic)))
+        return COMPRESSION_XZ;
+    return COMPRESSION_NONE;
+}
+
+#ifdef HAVE_ZLIB
+/** Inflate the next chars of the gzip input of \a dec into \a out.
+ *  Members following each other are read as one input, like \c gunzip
+ *  does, and trailing bytes which start no member are ignored. */
+static int
+fill_gzip (struct decompressor *dec, char *out, size_t *len, bool *end)
+{
+    z_stream *gzip = &dec->codec.gzip;
+    gzip->next_out = (Bytef *) out;
+    gzip->avail_out = BLOCK_SIZE;
+    int err = 0;
+
+    while (gzip->avail_out && !err)
+    {
+        if (!gzip->avail_in && dec->in_pos < dec->in_len)
+        {
+            size_t chunk = dec->in_len - dec->in_pos;
+            if (chunk > UINT_MAX)
+                chunk = UINT_MAX;
+            gzip->next_in = (Bytef *) dec->in + dec->in_pos;
+            gzip->avail_in = (uInt) chunk;
+            dec->in_pos += chunk;
+        }
+
+        int res = inflate (gzip, Z_NO_FLUSH);
+        if (res == Z_STREAM_END)
+        {
+            if (gzip->avail_in < 2 || gzip->next_in[0] != 0x1F
+                || gzip->next_in[1] != 0x8B)
+            {
+                *end = true;
+                break;
+            }
+            inflateReset (gzip);
+        }
+        else if (res == Z_MEM_ERROR)
+            err = ENOMEM;
+        else if (res != Z_OK)
+            err = EINVAL;
+    }
+
+    *len = BLOCK_SIZE - gzip->avail_out;
+    return err;
+}
+#endif
+
+#ifdef HAVE_LZMA
+/** Decode the next chars of the xz input of \a dec into \a out. */
+static int
+fill_xz (struct decompressor *dec, char *out, size_t *len, bool *end)
+{
+    lzma_stream *xz = &dec->codec.xz;
+    xz->next_out = (uint8_t *) out;
+    xz->avail_out = BLOCK_SIZE;
+    int err = 0;
+
+    while (xz->avail_out && !err)
+    {
+        lzma_ret res = lzma_code (xz, xz->avail_in ? LZMA_RUN : LZMA_FINISH);
+        if (res == LZMA_STREAM_END)
+        {
+            *end = true;
+            break;
+        }
+        else if (res == LZMA_MEM_ERROR)
+            err = ENOMEM;
+        else if (res != LZMA_OK)
+            err = EINVAL;
+    }
+
+    *len = BLOCK_SIZE - xz->avail_out;
+    return err;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/** Decompress the next chars of the zstd input of \a dec into \a out. */
+static int
+fill_zstd (struct decompressor *dec, char *out, size_t *len, bool *end)
+{
+    ZSTD_outBuffer output = {out, BLOCK_SIZE, 0};
+    int err = 0;
+
+    while (output.pos < output.size && !err)
+    {
+        ZSTD_inBuffer input = {dec->in, dec->in_len, dec->in_pos};
+        size_t res = ZSTD_decompressStream (dec->codec.zstd, &output, &input);
+        dec->in_pos = input.pos;
+        if (ZSTD_isError (res))
+            err = EINVAL;
+        /* Everything is flushed if the output has room left, so a frame
+         * which still wants input is truncated. */
+        else if (dec->in_pos == dec->in_len && output.pos < output.size)
+        {
+            if (res)
+                err = EINVAL;
+            *end = true;
+            break;
+        }
+    }
+
+    *len = output.pos;
+    return err;
+}
+#endif
+
+/** Decompress the next up to \ref BLOCK_SIZE chars of the input of
+ *  \a dec into \a out.
+ *
+ *  \param len Set to the number of chars in \a out, which are valid even
+ *      if an error is returned.
+ *  \param end Set to true if the end of the input was reached.
+ *  \returns \c EINVAL if the input is corrupt or truncated, \c ENOMEM if
+ *      out of memory else 0.
+ */
+static int
+fill_block (struct decompressor *dec, char *out, size_t *len, bool *end)
+{
+    switch (dec->compression)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        return fill_gzip (dec, out, len, end);
+#endif
+#ifdef HAVE_LZMA
+    case COMPRESSION_XZ:
+        return fill_xz (dec, out, len, end);
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        return fill_zstd (dec, out, len, end);
+#endif
+    default:
+        *len = 0;
+        *end = true;
+        return 0;
+    }
+}
+
+/** Set up the codec of \a dec.
+ *
+ *  \returns \c ENOTSUP if the library of the compression is missing,
+ *      \c ENOMEM if out of memory else 0.
+ */
+static int
+init_codec (struct decompressor *dec)
+{
+    switch (dec->compression)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        /* Window of 32 KiB and detection of the gzip or zlib header. */
+        return inflateInit2 (&dec->codec.gzip, 15 + 32) == Z_OK ? 0 : ENOMEM;
+#endif
+#ifdef HAVE_LZMA
+    case COMPRESSION_XZ:
+    {
+        lzma_stream xz = LZMA_STREAM_INIT;
+        dec->codec.xz = xz;
+        if (lzma_stream_decoder (
+                &dec->codec.xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+            return ENOMEM;
+        dec->codec.xz.next_in = (const uint8_t *) dec->in;
+        dec->codec.xz.avail_in = dec->in_len;
+        return 0;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        dec->codec.zstd = ZSTD_createDStream ();
+        return dec->codec.zstd ? 0 : ENOMEM;
+#endif
+    default:
+        return ENOTSUP;
+    }
+}
+
+/** Release the codec of \a dec. */
+static void
+end_codec (struct decompressor *dec)
+{
+    switch (dec->compression)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        inflateEnd (&dec->codec.gzip);
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case COMPRESSION_XZ:
+        lzma_end (&dec->codec.xz);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        ZSTD_freeDStream (dec->codec.zstd);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/** Thread function: fill the blocks of \a dec_arg until the end of the
+ *  input, an error or until the reader stops. */
+static void *
+decompress_worker (void *dec_arg)
+{
+    struct decompressor *dec = dec_arg;
+
+    pthread_mutex_lock (&dec->lock);
+    while (!dec->finished && !dec->stopping)
+    {
+        if (dec->filled - dec->taken >= NUM_BLOCKS)
+        {
+            pthread_cond_wait (&dec->changed, &dec->lock);
+            continue;
+        }
+
+        int block = (int) (dec->filled % NUM_BLOCKS);
+        pthread_mutex_unlock (&dec->lock);
+
+        bool end = false;
+        size_t len = 0;
+        int res = fill_block (dec, dec->blocks + block * BLOCK_SIZE, &len, &end);
+
+        pthread_mutex_lock (&dec->lock);
+        dec->lens[block] = len;
+        ++dec->filled;
+        dec->error = res;
+        dec->finished = res || end;
+        pthread_cond_broadcast (&dec->changed);
+    }
+    pthread_mutex_unlock (&dec->lock);
+
+    return NULL;
+}
+
+/** Start the decompression of the \a len chars at \a in with
+ *  \a compression on a new thread.  \a in has to stay valid until
+ *  \a decompressor is freed.  If no thread can be started, the blocks
+ *  are decompressed by \ref decompressor_next.
+ *
+ *  \param decompressor Set to the new decompressor.  Release with
+ *      \ref decompressor_free.
+ *  \returns \c ENOTSUP if the library of \a compression is missing,
+ *      \c ENOMEM if out of memory else 0.
+ */
+int
+decompressor_start (
+    enum compression compression, const char *in, size_t len,
+    struct decompressor **decompressor)
+{
+    struct decompressor *dec = calloc (1, sizeof (*dec));
+    if (!dec)
+        return ENOMEM;
+    dec->compression = compression;
+    dec->in = in;
+    dec->in_len = len;
+
+    int res = init_codec (dec);
+    if (res)
+    {
+        free (dec);
+        return res;
+    }
+    if (!(dec->blocks = malloc (NUM_BLOCKS * BLOCK_SIZE)))
+    {
+        end_codec (dec);
+        free (dec);
+        return ENOMEM;
+    }
+
+    pthread_mutex_init (&dec->lock, NULL);
+    pthread_cond_init (&dec->changed, NULL);
+    dec->threaded =
+        !pthread_create (&dec->thread, NULL, decompress_worker, dec);
+
+    *decompressor = dec;
+    return 0;
+}
+
+/** Get the next block of decompressed text of \a dec.  The block stays
+ *  valid until the next call.
+ *
+ *  \param block Set to the decompressed text.
+ *  \param len Set to the length of \a block, which is 0 at the end of
+ *      the input.
+ *  \returns \c EINVAL if the input is corrupt or truncated, \c ENOMEM if
+ *      out of memory else 0.
+ */
+int
+decompressor_next (struct decompressor *dec, const char **block, size_t *len)
+{
+    *len = 0;
+    if (!dec->threaded)
+    {
+        if (dec->finished)
+            return dec->error;
+        bool end = false;
+        *block = dec->blocks;
+        dec->error = fill_block (dec, dec->blocks, len, &end);
+        dec->finished = dec->error || end;
+        return *len ? 0 : dec->error;
+    }
+
+    pthread_mutex_lock (&dec->lock);
+    if (dec->holding)
+    {
+        ++dec->taken;
+        dec->holding = false;
+        pthread_cond_broadcast (&dec->changed);
+    }
+
+    /* The last block may be empty; the error comes after the text
+     * decompressed before it. */
+    int res = 0;
+    for (;;)
+    {
+        while (dec->taken == dec->filled && !dec->finished)
+            pthread_cond_wait (&dec->changed, &dec->lock);
+        if (dec->taken == dec->filled)
+        {
+            res = dec->error;
+            break;
+        }
+
+        int taken = (int) (dec->taken % NUM_BLOCKS);
+        if (dec->lens[taken])
+        {
+            *block = dec->blocks + taken * BLOCK_SIZE;
+            *len = dec->lens[taken];
+            dec->holding = true;
+            break;
+        }
+        ++dec->taken;
+        pthread_cond_broadcast (&dec->changed);
+    }
+    pthread_mutex_unlock (&dec->lock);
+
+    return res;
+}
+
+/** Stop the decompression of \a dec and free it.  Does nothing if \a dec
+ *  is \c NULL. */
+void
+decompressor_free (struct decompressor *dec)
+{
+    if (!dec)
+        return;
+
+    if (dec->threaded)
+    {
+        pthread_mutex_lock (&dec->lock);
+        dec->stopping = true;
+        pthread_cond_broadcast (&dec->changed);
+        pthread_mutex_unlock (&dec->lock);
+        pthread_join (dec->thread, NULL);
+    }
+
+    pthread_cond_destroy (&dec->changed);
+    pthread_mutex_destroy (&dec->lock);
+    end_codec (dec);
+    free (dec->blocks);
+    free (dec);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,51 @@
+/** \file
+ * Decompress gzip, zstd and xz compressed input on its own thread.
+ *
+ * The compression is detected by the magic bytes at the start of the
+ * input.  A thread decompresses the input into a few blocks ahead of the
+ * reader, so decompressing and stripping run at the same time.  Each
+ * format is only supported if domaincloud is built with its library.
+ */
+
+#ifndef DECOMPRESS_H_
+#define DECOMPRESS_H_
+
+#include <stddef.h>
+
+/** Formats of compressed input. */
+enum compression
+{
+    COMPRESSION_NONE,   /**< The input isn't compressed. */
+    COMPRESSION_GZIP,   /**< gzip or zlib. */
+    COMPRESSION_ZSTD,   /**< Zstandard. */
+    COMPRESSION_XZ      /**< xz. */
+};
+
+/** The blocks a \ref decompressor returns from compressed input. */
+struct decompressor;
+
+enum compression input_compression (const char *data, size_t len);
+int decompressor_start (
+    enum compression compression, const char *in, size_t len,
+    struct decompressor **decompressor);
+int decompressor_next (
+    struct decompressor *decompressor, const char **block, size_t *len);
+void decompressor_free (struct decompressor *decompressor);
+
+#endif /* not DECOMPRESS_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,200 @@
+/** \file
+ * Hash sets of the files and contents of the input files seen so far.
+ *
+ * Files are known by their device and inode, so hard links, symbolic
+ * links and files given twice are found without reading them.  Copies
+ * are known by the size and XXH64 hash of their content.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "dedupe.h"
+
+/** Initial number of slots of a \ref dedupe_table. */
+#define MIN_SLOTS 1024
+
+/** \struct dedupe_key
+ *  \brief An entry of a \ref dedupe_table: the device and inode of a
+ *      file or the size and hash of a content.
+ *
+ *  \var bool dedupe_key::used
+ *      Whether the slot holds a key.
+ */
+struct dedupe_key
+{
+    uint64_t first;
+    uint64_t second;
+    bool used;
+};
+
+/** \struct dedupe_table
+ *  \brief A hash set of \ref dedupe_key with linear probing.
+ *
+ *  \var struct dedupe_key *dedupe_table::slots
+ *      The keys.  The number of slots is 0 or a power of two of which at
+ *      most half are used.
+ */
+struct dedupe_table
+{
+    struct dedupe_key *slots;
+    size_t num_slots;
+    size_t num_keys;
+};
+
+/** \struct dedupe_set
+ *  \brief The files and contents seen so far.  Both tables are protected
+ *      by \a lock.
+ */
+struct dedupe_set
+{
+    pthread_mutex_t lock;
+    struct dedupe_table files;
+    struct dedupe_table contents;
+};
+
+/** Create an empty set of input files, which may be used by several
+ *  threads at once.
+ *
+ *  \returns The set or \c NULL if out of memory.  Release with
+ *      \ref dedupe_set_free.
+ */
+struct dedupe_set *
+dedupe_set_new (void)
+{
+    struct dedupe_set *set = calloc (1, sizeof (*set));
+    if (!set)
+        return NULL;
+
+    pthread_mutex_init (&set->lock, NULL);
+    return set;
+}
+
+/** Free \a set.  Does nothing if \a set is \c NULL. */
+void
+dedupe_set_free (struct dedupe_set *set)
+{
+    if (!set)
+        return;
+
+    pthread_mutex_destroy (&set->lock);
+    free (set->files.slots);
+    free (set->contents.slots);
+    free (set);
+}
+
+/** The slot of \a table where \a key is or would be put. */
+static struct dedupe_key *
+find_slot (const struct dedupe_table *table, const struct dedupe_key *key)
+{
+    uint64_t words[2] = {key->first, key->second};
+    size_t mask = table->num_slots - 1;
+    size_t slot = (size_t) hash_bytes (words, sizeof (words)) & mask;
+    while (table->slots[slot].used
+           && (table->slots[slot].first != key->first
+               || table->slots[slot].second != key->second))
+        slot = (slot + 1) & mask;
+
+    return &table->slots[slot];
+}
+
+/** Double the slots of \a table or allocate the first ones.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+grow_table (struct dedupe_table *table)
+{
+    struct dedupe_table grown = {
+        NULL, table->num_slots ? 2 * table->num_slots : MIN_SLOTS,
+        table->num_keys};
+    if (!(grown.slots = calloc (grown.num_slots, sizeof (*grown.slots))))
+        return ENOMEM;
+
+    for (size_t slot = 0; slot < table->num_slots; ++slot)
+        if (table->slots[slot].used)
+            *find_slot (&grown, &table->slots[slot]) = table->slots[slot];
+
+    free (table->slots);
+    *table = grown;
+    return 0;
+}
+
+/** Add \a first and \a second to \a table of \a set.
+ *
+ *  \param added Set to false if they were in \a table before.
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+add_key (
+    struct dedupe_set *set, struct dedupe_table *table,
+    uint64_t first, uint64_t second, bool *added)
+{
+    struct dedupe_key key = {first, second, true};
+    int res = 0;
+    *added = false;
+
+    pthread_mutex_lock (&set->lock);
+    if (2 * (table->num_keys + 1) > table->num_slots)
+        res = grow_table (table);
+    if (!res)
+    {
+        struct dedupe_key *slot = find_slot (table, &key);
+        if (!slot->used)
+        {
+            *slot = key;
+            ++table->num_keys;
+            *added = true;
+        }
+    }
+    pthread_mutex_unlock (&set->lock);
+
+    return res;
+}
+
+/** Add the file with \a file_stat to \a set by its device and inode.
+ *
+ *  \param added Set to false if the file was added before.
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+int
+dedupe_add_file (
+    struct dedupe_set *set, const struct stat *file_stat, bool *added)
+{
+    return add_key (
+        set, &set->files, (uint64_t) file_stat->st_dev,
+        (uint64_t) file_stat->st_ino, added);
+}
+
+/** Add the \a len chars at \a data to \a set by their size and hash.
+ *  The content is hashed before the set is locked.
+ *
+ *  \param added Set to false if the same content was added before.
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+int
+dedupe_add_content (
+    struct dedupe_set *set, const char *data, size_t len, bool *added)
+{
+    return add_key (
+        set, &set->contents, (uint64_t) len, hash_bytes (data, len), added);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,39 @@
+/** \file
+ * Find input files whose content was seen before, first by their device
+ * and inode, then by the hash of their content.
+ */
+
+#ifndef DEDUPE_H_
+#define DEDUPE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+/** The input files seen so far, see \ref dedupe_set_new. */
+struct dedupe_set;
+
+struct dedupe_set *dedupe_set_new (void);
+void dedupe_set_free (struct dedupe_set *set);
+int dedupe_add_file (
+    struct dedupe_set *set, const struct stat *file_stat, bool *added);
+int dedupe_add_content (
+    struct dedupe_set *set, const char *data, size_t len, bool *added);
+
+#endif /* not DEDUPE_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -6,70 +6,551 @@
     #include "config.h"
 #endif
 
-#include <ctype.h>
 #include <errno.h>
 #include <error.h>
+#include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "archive.h"
+#include "cache.h"
+#include "char_class.h"
+#include "decompress.h"
+#include "dedupe.h"
 #include "domaincloud.h"
+#include "input.h"
+#include "jobs.h"
+#include "lang.h"
+#include "loader.h"
+#include "scan.h"
+#include "stats.h"
+#include "trace.h"
+#include "walk.h"
+
+/** The kinds of output of the program. */
+enum output_mode
+{
+    OUTPUT_IMAGE,   /**< A word cloud image. */
+    OUTPUT_TEXT,    /**< The input without comments and literals. */
+    OUTPUT_COUNTS,  /**< The words and their number of occurrences. */
+    OUTPUT_TABLE,   /**< The word counts as binary table. */
+    OUTPUT_MERGED_TABLE /**< The sum of the binary tables given as input. */
+};
+
+/** The programs which can draw the word cloud. */
+enum renderer
+{
+    RENDERER_NATIVE,    /**< \ref render_word_cloud */
+    RENDERER_PYTHON     /**< The \c wordcloud Python package. */
+};
+
+/** The formats of the statistics of \c --stats. */
+enum stats_format
+{
+    STATS_NONE,     /**< No statistics. */
+    STATS_TEXT,     /**< A table for humans. */
+    STATS_JSON      /**< A JSON object. */
+};
 
 /** \struct cli_options
  *  \brief Flags and arguments to be set by \ref parse_cli_options.
  *
  *  \var const char *cli_options::output_file
  *      Where to put the final result.
- *  \var bool cli_options::substitute_only
- *      Strip unwanted clutter from source only.
+ *  \var const char *cli_options::table_file
+ *      Where \c --emit-table saves the table or \c NULL.
+ *  \var enum output_mode cli_options::mode
+ *      What to output.
+ *  \var enum renderer cli_options::renderer
+ *      Who draws the word cloud image.
+ *  \var enum stats_format cli_options::stats
+ *      How the statistics of the run are written to standard error.
+ *  \var const char *cli_options::trace_file
+ *      Where the spans of the run are written to or \c NULL.
+ *  \var bool cli_options::recursive
+ *      Whether directories among the arguments are walked.
+ *  \var struct walk_filter cli_options::filter
+ *      Which files are processed while walking directories.
+ *  \var const char *cli_options::cache_dir
+ *      Directory of the \ref file_cache or \c NULL.
+ *  \var const struct clutter_lang *cli_options::lang
+ *      The language of all input files or \c NULL to choose it by the
+ *      extension of each file.
+ *  \var const char *cli_options::stopwords_file
+ *      File of words which are not counted or \c NULL.
+ *  \var bool cli_options::keep_keywords
+ *      Whether the keywords of the languages are counted.
+ *  \var bool cli_options::split_identifiers
+ *      Whether the parts of identifiers are counted instead of the
+ *      identifiers.
+ *  \var size_t cli_options::approx_top
+ *      The number of most frequent words printed if they are counted
+ *      approximately with bounded memory, else 0.
+ *  \var size_t cli_options::mem_limit
+ *      The memory in bytes for the approximate word counts of all jobs.
+ *  \var bool cli_options::dedupe
+ *      Whether input files whose content was seen before are skipped.
  *  \var char **cli_options::arguments
  *      The part of \a argv where the arguments begin.
  *  \var int cli_options::num_arguments
  *      Number of arguments.
+ *  \var int cli_options::num_jobs
+ *      Number of input files to process in parallel.
  */
 struct cli_options
 {
     char **arguments;
     const char *output_file;
+    const char *table_file;
+    const char *cache_dir;
+    const char *trace_file;
+    const struct clutter_lang *lang;
+    const char *stopwords_file;
+    size_t approx_top;
+    size_t mem_limit;
     int num_arguments;
-    bool substitute_only;
+    int num_jobs;
+    enum output_mode mode;
+    enum renderer renderer;
+    enum stats_format stats;
+    bool recursive;
+    bool keep_keywords;
+    bool split_identifiers;
+    bool dedupe;
+    struct walk_filter filter;
+};
+
+/** Input files of at least this size are split into chunks which are
+ *  stripped in parallel if \ref file_split_jobs is greater than 1. */
+#define SPLIT_MIN_FILE_SIZE (8 * 1024 * 1024)
+
+/** Number of threads to use for a single large input file. */
+static int file_split_jobs = 1;
+
+/** Cache of the stripped text of the input files or \c NULL. */
+static struct file_cache *file_cache;
+
+/** The language of all input files given by \c --lang or \c NULL. */
+static const struct clutter_lang *input_lang;
+
+/** Which members of archives are stripped, set by \c --include and
+ *  \c --exclude. */
+static const struct walk_filter *member_filter;
+
+/** The words given by \c --stopwords, which are not counted, or \c NULL. */
+static struct word_filter *stopwords;
+
+/** Whether the keywords of the languages are counted, set by
+ *  \c --keep-keywords. */
+static bool keep_keywords;
+
+/** Whether identifiers are split into their parts, set by
+ *  \c --split-identifiers. */
+static bool split_identifiers;
+
+/** The files seen so far by a walk with \c --dedupe or \c NULL. */
+static struct dedupe_set *seen_files;
+
+/** Counters of the run for \c --stats or \c NULL. */
+static struct run_stats *run_stats;
+
+/** The number of slowest input files listed by \c --stats. */
+#define STATS_SLOWEST_FILES 10
+
+/** The number of most frequent words shown in the word cloud. */
+#define CLOUD_MAX_WORDS 200
+/** Size of the word cloud image in pixels. */
+#define CLOUD_WIDTH 1500
+#define CLOUD_HEIGHT 1000
+
+/** Default memory for the approximate word counts of \c --approx-top. */
+#define DEFAULT_MEM_LIMIT (64 * 1024 * 1024)
+
+/** Values of \c getopt_long for options without a short form. */
+enum long_only_option
+{
+    OPTION_RENDERER = 0x100,
+    OPTION_CACHE_DIR,
+    OPTION_INCLUDE,
+    OPTION_EXCLUDE,
+    OPTION_GITIGNORE,
+    OPTION_EMIT_TABLE,
+    OPTION_STATS,
+    OPTION_TRACE,
+    OPTION_LANG,
+    OPTION_STOPWORDS,
+    OPTION_KEEP_KEYWORDS,
+    OPTION_SPLIT_IDENTIFIERS,
+    OPTION_APPROX_TOP,
+    OPTION_MEM_LIMIT,
+    OPTION_DEDUPE
 };
 
 static void parse_cli_options (char *argv[], int argc, struct cli_options *options);
-static void process_input_file (const char *input_file, FILE *ostr);
-static void generate_word_cloud (const char *input_file, const char *output_file);
+static void strip_input_files (const struct cli_options *options, FILE *ostr);
+static struct word_counts *count_input_files (const struct cli_options *options);
+static void process_input_file (
+    const char *input_file, const struct loaded_input *loaded, FILE *ostr,
+    void *counts);
+static void generate_word_cloud (
+    const struct word_counts *counts, FILE *ostr);
+static void merge_input_tables (const struct cli_options *options, FILE *ostr);
+static void drop_duplicate_arguments (struct cli_options *options);
+static FILE *open_python_renderer (const char *output_file);
+static void close_python_renderer (FILE *renderer);
+static void enter_phase (enum run_phase phase);
+static int remove_clutter_stream (
+    const struct clutter_lang *lang, FILE *istr, FILE *ostr,
+    struct clutter_stats *stats);
+static int remove_clutter_input (
+    const struct clutter_lang *lang, const struct input_buf *in,
+    struct clutter_stats *stats, FILE *ostr,
+    clutter_sink *sink, void *sink_data);
+static int remove_clutter_mapped (
+    const struct clutter_lang *lang, int fd, size_t size,
+    struct clutter_stats *stats, FILE *ostr,
+    clutter_sink *sink, void *sink_data);
+static int remove_clutter_archive (
+    enum archive_format format, int fd, const struct input_buf *loaded,
+    size_t size, struct clutter_stats *stats, FILE *ostr,
+    struct word_tokenizer *tokenizer, clutter_sink *sink, void *sink_data);
 
 int
 main (int argc, char *argv[])
 {
     struct cli_options options = {
-        .output_file = "-", .substitute_only = false};
+        .mode = OUTPUT_IMAGE,
+        .renderer = RENDERER_NATIVE, .num_jobs = 1,
+        .mem_limit = DEFAULT_MEM_LIMIT};
+
+    /* "domaincloud merge TABLE..." reads tables instead of source files. */
+    bool merge = argc > 1 && !strcmp (argv[1], "merge");
+    if (merge)
+    {
+        options.mode = OUTPUT_MERGED_TABLE;
+        --argc;
+        ++argv;
+    }
 
     parse_cli_options (argv, argc, &options);
+    input_lang = options.lang;
+    member_filter = &options.filter;
+    keep_keywords = options.keep_keywords;
+    split_identifiers = options.split_identifiers;
+    if (options.stopwords_file)
+    {
+        int res = word_filter_read (options.stopwords_file, &stopwords);
+        if (res)
+            error (
+                EXIT_FAILURE, res,
+                "Can't read stopwords '%s'!", options.stopwords_file);
+    }
+    if (merge && options.mode != OUTPUT_MERGED_TABLE)
+        error (EXIT_FAILURE, 0, "merge can only write tables!");
+
+    if (options.stats != STATS_NONE
+        && !(run_stats = run_stats_new (STATS_SLOWEST_FILES)))
+        error (EXIT_FAILURE, ENOMEM, "Can't collect statistics");
+
+    FILE *trace_stream = NULL;
+    if (options.trace_file)
+    {
+        if (!(trace_stream = fopen (options.trace_file, "w")))
+            error (
+                EXIT_FAILURE, errno,
+                "Can't open '%s' for writing!", options.trace_file);
+        trace_start ();
+    }
 
-    const char *tmp_name = ".rename_me_42";
     FILE *output_stream;
     bool to_stdout = !strcmp (options.output_file, "-");
+    bool to_python =
+        options.mode == OUTPUT_IMAGE && options.renderer == RENDERER_PYTHON;
 
-    if (options.substitute_only)
-        output_stream = to_stdout ? stdout : fopen (options.output_file, "w");
+    /* Python starts up while the input files are counted. */
+    uint64_t renderer_start = trace_begin ();
+    if (to_python)
+        output_stream = open_python_renderer (options.output_file);
     else
-        output_stream = fopen (tmp_name, "w");
+        output_stream = to_stdout ? stdout : fopen (options.output_file, "w");
 
     if (!output_stream)
         error (
             EXIT_FAILURE, errno,
             "Can't open '%s' for writing!", options.output_file);
 
-    for (int input_file = 0; input_file < options.num_arguments; ++input_file)
-        process_input_file (options.arguments[input_file], output_stream);
+    /* The first of equal input files is kept, no matter which job gets
+     * to it first.  A walk finds its files in no fixed order, so it
+     * skips them while processing. */
+    if (options.dedupe && !options.recursive
+        && options.mode != OUTPUT_MERGED_TABLE)
+        drop_duplicate_arguments (&options);
+    else if (options.dedupe && !(seen_files = dedupe_set_new ()))
+        error (EXIT_FAILURE, ENOMEM, "Can't find duplicate input files");
+
+    if (options.cache_dir && !(file_cache = file_cache_open (options.cache_dir)))
+        error (
+            EXIT_FAILURE, errno,
+            "Can't open cache directory '%s'!", options.cache_dir);
+
+    /* Jobs left over after one per input file strip large files.  The
+     * number of files in directories is unknown. */
+    file_split_jobs = options.recursive
+        ? 1 : options.num_jobs / options.num_arguments;
+    if (file_split_jobs < 1)
+        file_split_jobs = 1;
+
+    enter_phase (PHASE_INPUT);
+    if (options.mode == OUTPUT_TEXT)
+        strip_input_files (&options, output_stream);
+    else if (options.mode == OUTPUT_MERGED_TABLE)
+        merge_input_tables (&options, output_stream);
+    else
+    {
+        struct word_counts *counts = count_input_files (&options);
+        enter_phase (PHASE_OUTPUT);
+        uint64_t output_start = trace_begin ();
+        if (options.mode == OUTPUT_TABLE)
+        {
+            int res = word_counts_write_table (counts, output_stream);
+            if (res)
+                error (EXIT_FAILURE, res, "Can't write word counts table!");
+            trace_end ("write_table", output_start, 0, NULL);
+        }
+        else if (options.mode == OUTPUT_IMAGE && !to_python)
+        {
+            generate_word_cloud (counts, output_stream);
+            trace_end ("render_word_cloud", output_start, 0, NULL);
+        }
+        else
+        {
+            int res = word_counts_print (
+                counts, to_python ? CLOUD_MAX_WORDS : options.approx_top,
+                output_stream);
+            trace_end ("print_counts", output_start, 0, NULL);
+            /* A failing renderer is the more likely cause of errors. */
+            if (to_python)
+            {
+                close_python_renderer (output_stream);
+                trace_end ("python_renderer", renderer_start, 0, NULL);
+            }
+            if (res)
+                error (EXIT_FAILURE, res, "Can't write word counts!");
+        }
+        word_counts_free (counts);
+    }
 
-    if (!to_stdout)
+    if (!to_stdout && !to_python)
         fclose (output_stream);
+    file_cache_close (file_cache);
+    dedupe_set_free (seen_files);
+    word_filter_free (stopwords);
+
+    if (run_stats)
+    {
+        run_stats_print (run_stats, options.stats == STATS_JSON, stderr);
+        run_stats_free (run_stats);
+    }
+
+    if (trace_stream)
+    {
+        int res = trace_write (trace_stream);
+        if (fclose (trace_stream) && !res)
+            res = errno;
+        if (res)
+            error (
+                EXIT_FAILURE, res,
+                "Can't write trace '%s'!", options.trace_file);
+    }
+}
+
+/** Start \a phase in \ref run_stats if statistics are collected. */
+static void
+enter_phase (enum run_phase phase)
+{
+    if (run_stats)
+        run_stats_phase (run_stats, phase);
+}
+
+/** Strip all input files of \a options and write the text to \a ostr.
+ *  Exit if the output can't be written. */
+static void
+strip_input_files (const struct cli_options *options, FILE *ostr)
+{
+    int res = 0;
+    if (options->recursive)
+        res = walk_files_parallel (
+            options->arguments, options->num_arguments, &options->filter,
+            ostr, options->num_jobs, process_input_file, NULL);
+    else if (options->num_jobs > 1)
+        res = process_files_parallel (
+            options->arguments, options->num_arguments, ostr,
+            options->num_jobs, process_input_file, NULL);
+    else
+        for (int input_file = 0; input_file < options->num_arguments; ++input_file)
+            process_input_file (
+                options->arguments[input_file], NULL, ostr, NULL);
+
+    if (res)
+        error (EXIT_FAILURE, res, "Can't write output!");
+}
+
+/** Count the words of all input files of \a options.  Every job counts
+ *  into its own table; the tables are merged at the end.  With
+ *  \c --approx-top the tables are bounded and share the memory limit.
+ *  Exit if out of memory.
+ *
+ *  \returns The word counts.  Release with \ref word_counts_free.
+ */
+static struct word_counts *
+count_input_files (const struct cli_options *options)
+{
+    int num_tables = options->num_jobs > 1 ? options->num_jobs : 1;
+    struct word_counts **tables = calloc ((size_t) num_tables, sizeof (*tables));
+    if (!tables)
+        error (EXIT_FAILURE, ENOMEM, "Can't count words");
+
+    size_t max_words = options->approx_top
+        ? word_counts_max_words (options->mem_limit / (size_t) num_tables) : 0;
+    if (options->approx_top && max_words < options->approx_top)
+        error (
+            EXIT_FAILURE, 0, "A memory limit of %zu bytes is too small for"
+            " the top %zu words with %d jobs!", options->mem_limit,
+            options->approx_top, num_tables);
+
+    for (int table = 0; table < num_tables; ++table)
+        if (!(tables[table] = max_words
+              ? word_counts_new_bounded (max_words) : word_counts_new ()))
+            error (EXIT_FAILURE, ENOMEM, "Can't count words");
+
+    int res = 0;
+    if (options->recursive)
+        res = walk_files_parallel (
+            options->arguments, options->num_arguments, &options->filter,
+            NULL, num_tables, process_input_file, (void **) tables);
+    else if (num_tables > 1)
+        res = process_files_parallel (
+            options->arguments, options->num_arguments, NULL,
+            num_tables, process_input_file, (void **) tables);
+    else
+        for (int input_file = 0; input_file < options->num_arguments; ++input_file)
+            process_input_file (
+                options->arguments[input_file], NULL, NULL, tables[0]);
+
+    if (res)
+        error (EXIT_FAILURE, res, "Can't count words");
+
+    enter_phase (PHASE_MERGE);
+    for (int table = 1; table < num_tables; ++table)
+    {
+        uint64_t merge_start = trace_begin ();
+        if (word_counts_merge (tables[0], tables[table]))
+            error (EXIT_FAILURE, ENOMEM, "Can't count words");
+        word_counts_free (tables[table]);
+        trace_end ("merge_word_counts", merge_start, 0, NULL);
+    }
+
+    struct word_counts *counts = tables[0];
+    free (tables);
+    return counts;
+}
+
+/** Merge the tables given as arguments in \a options into one table and
+ *  write it to \a ostr.  Exit on error. */
+static void
+merge_input_tables (const struct cli_options *options, FILE *ostr)
+{
+    int bad_table = -1;
+    int res = merge_count_tables (
+        options->arguments, options->num_arguments, ostr, &bad_table);
+
+    if (res && bad_table >= 0)
+        error (
+            EXIT_FAILURE, res == EINVAL ? 0 : res, "Can't read table '%s'!%s",
+            options->arguments[bad_table],
+            res == EINVAL ? " It is no valid table." : "");
+    else if (res)
+        error (EXIT_FAILURE, res, "Can't write merged table!");
+}
+
+/** Parse the argument of the \c --jobs option.  \c 0 stands for the
+ *  number of processors.  Exit if \a arg is no number or negative. */
+static int
+parse_num_jobs (const char *arg)
+{
+    char *arg_end;
+    errno = 0;
+    long num_jobs = strtol (arg, &arg_end, 10);
+
+    if (errno || arg_end == arg || *arg_end || num_jobs < 0
+        || num_jobs > INT_MAX)
+    {
+        fprintf (stderr, "Invalid number of jobs '%s'!\n", arg);
+        print_usage (stderr);
+        exit (EXIT_FAILURE);
+    }
+
+    return num_jobs ? (int) num_jobs : default_num_jobs ();
+}
+
+/** Parse the argument \a arg of the option \a option, which is a
+ *  positive number.  It may end in one of the suffixes \c K, \c M and
+ *  \c G for multiples of 1024 if \a with_units.  Exit if it is
+ *  invalid. */
+static size_t
+parse_size (const char *option, const char *arg, bool with_units)
+{
+    char *arg_end;
+    errno = 0;
+    unsigned long long size = strtoull (arg, &arg_end, 10);
+
+    int shift = 0;
+    const char *units = "KMG";
+    const char *unit = with_units && *arg_end ? strchr (units, *arg_end) : NULL;
+    if (unit)
+    {
+        shift = 10 * (int) (unit - units + 1);
+        ++arg_end;
+    }
+
+    if (errno || arg_end == arg || *arg_end || *arg == '-' || !size
+        || size > (SIZE_MAX >> shift))
+    {
+        fprintf (stderr, "Invalid argument '%s' for %s!\n", arg, option);
+        print_usage (stderr);
+        exit (EXIT_FAILURE);
+    }
+
+    return (size_t) size << shift;
+}
 
-    if (!options.substitute_only)
-        generate_word_cloud (tmp_name, options.output_file);
+/** Append the comma separated patterns in \a arg to the \a num_patterns
+ *  \a patterns.  Exit if out of memory. */
+static void
+add_patterns (char ***patterns, int *num_patterns, const char *arg)
+{
+    char *arg_copy = strdup (arg);
+    if (!arg_copy)
+        error (EXIT_FAILURE, ENOMEM, "Can't parse patterns");
+
+    char *save_pos;
+    for (char *pattern = strtok_r (arg_copy, ",", &save_pos); pattern;
+         pattern = strtok_r (NULL, ",", &save_pos))
+    {
+        char **grown = realloc (
+            *patterns, ((size_t) *num_patterns + 1) * sizeof (*grown));
+        if (!grown)
+            error (EXIT_FAILURE, ENOMEM, "Can't parse patterns");
+        *patterns = grown;
+        (*patterns)[(*num_patterns)++] = pattern;
+    }
 }
 
 /** Parse CLI options and put results into \a options.  Will exit on error. */
@@ -87,11 +568,29 @@ parse_cli_options (char *argv[], int argc, struct cli_options *options)
             {"help",    no_argument, 0, 'h'},
             {"substitute-only", no_argument, 0, 'S'},
             {"output",  required_argument, 0, 'o'},
+            {"counts",  no_argument, 0, 'c'},
+            {"jobs",    required_argument, 0, 'j'},
+            {"renderer", required_argument, 0, OPTION_RENDERER},
+            {"cache-dir", required_argument, 0, OPTION_CACHE_DIR},
+            {"recursive", no_argument, 0, 'r'},
+            {"include", required_argument, 0, OPTION_INCLUDE},
+            {"exclude", required_argument, 0, OPTION_EXCLUDE},
+            {"gitignore", no_argument, 0, OPTION_GITIGNORE},
+            {"emit-table", required_argument, 0, OPTION_EMIT_TABLE},
+            {"stats", optional_argument, 0, OPTION_STATS},
+            {"trace", required_argument, 0, OPTION_TRACE},
+            {"lang", required_argument, 0, OPTION_LANG},
+            {"stopwords", required_argument, 0, OPTION_STOPWORDS},
+            {"keep-keywords", no_argument, 0, OPTION_KEEP_KEYWORDS},
+            {"split-identifiers", no_argument, 0, OPTION_SPLIT_IDENTIFIERS},
+            {"approx-top", required_argument, 0, OPTION_APPROX_TOP},
+            {"mem-limit", required_argument, 0, OPTION_MEM_LIMIT},
+            {"dedupe", no_argument, 0, OPTION_DEDUPE},
             {0, 0, 0, 0}
         };
 
         int choice = getopt_long (
-            argc, argv, "VhSo:", long_options, &option_index);
+            argc, argv, "VhSco:j:r", long_options, &option_index);
 
         if (choice == -1)
             break;
@@ -111,7 +610,107 @@ parse_cli_options (char *argv[], int argc, struct cli_options *options)
                 break;
 
             case 'S':
-                options->substitute_only = true;
+                options->mode = OUTPUT_TEXT;
+                break;
+
+            case 'c':
+                options->mode = OUTPUT_COUNTS;
+                break;
+
+            case 'j':
+                options->num_jobs = parse_num_jobs (optarg);
+                break;
+
+            case OPTION_RENDERER:
+                if (!strcmp (optarg, "native"))
+                    options->renderer = RENDERER_NATIVE;
+                else if (!strcmp (optarg, "python"))
+                    options->renderer = RENDERER_PYTHON;
+                else
+                {
+                    fprintf (stderr, "Unknown renderer '%s'!\n", optarg);
+                    print_usage (stderr);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+
+            case OPTION_CACHE_DIR:
+                options->cache_dir = optarg;
+                break;
+
+            case 'r':
+                options->recursive = true;
+                break;
+
+            case OPTION_INCLUDE:
+                add_patterns (
+                    &options->filter.include, &options->filter.num_include,
+                    optarg);
+                break;
+
+            case OPTION_EXCLUDE:
+                add_patterns (
+                    &options->filter.exclude, &options->filter.num_exclude,
+                    optarg);
+                break;
+
+            case OPTION_GITIGNORE:
+                options->filter.gitignore = true;
+                break;
+
+            case OPTION_EMIT_TABLE:
+                options->mode = OUTPUT_TABLE;
+                options->table_file = optarg;
+                break;
+
+            case OPTION_STATS:
+                if (!optarg || !strcmp (optarg, "text"))
+                    options->stats = STATS_TEXT;
+                else if (!strcmp (optarg, "json"))
+                    options->stats = STATS_JSON;
+                else
+                {
+                    fprintf (stderr, "Unknown statistics format '%s'!\n", optarg);
+                    print_usage (stderr);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+
+            case OPTION_TRACE:
+                options->trace_file = optarg;
+                break;
+
+            case OPTION_LANG:
+                if (!(options->lang = clutter_lang_find (optarg)))
+                {
+                    fprintf (stderr, "Unknown language '%s'!\n", optarg);
+                    print_usage (stderr);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+
+            case OPTION_STOPWORDS:
+                options->stopwords_file = optarg;
+                break;
+
+            case OPTION_KEEP_KEYWORDS:
+                options->keep_keywords = true;
+                break;
+
+            case OPTION_SPLIT_IDENTIFIERS:
+                options->split_identifiers = true;
+                break;
+
+            case OPTION_APPROX_TOP:
+                options->approx_top = parse_size ("--approx-top", optarg, false);
+                break;
+
+            case OPTION_MEM_LIMIT:
+                options->mem_limit = parse_size ("--mem-limit", optarg, true);
+                break;
+
+            case OPTION_DEDUPE:
+                options->dedupe = true;
                 break;
 
             case '?':
@@ -125,6 +724,11 @@ parse_cli_options (char *argv[], int argc, struct cli_options *options)
         }
     }
 
+    if (options->table_file && options->output_file)
+        error (EXIT_FAILURE, 0, "--emit-table can't be combined with -o!");
+    if (!options->output_file)
+        options->output_file = options->table_file ? options->table_file : "-";
+
     if (optind < argc)
     {
         options->arguments = argv + optind;
@@ -138,30 +742,75 @@ parse_cli_options (char *argv[], int argc, struct cli_options *options)
     }
 }
 
-/** Generate a word cloud from \a input_file and save the resulting PNG
- *  image to the file \a output_file.
- *  Using the
- *  <a href="https://github.com/amueller/word_cloud">wordcloud_cli.py</a>
- *  program.  Exit if this program encounters problems.
+/** Python program which reads words and their counts separated by a tab
+ *  from standard input and saves their word cloud with the width
+ *  \c argv[2] and the height \c argv[3] to the file \c argv[1] or to
+ *  standard output if it is "-". */
+#define WORD_CLOUD_SCRIPT \
+    "import sys; " \
+    "from wordcloud import WordCloud; " \
+    "lines = (line.rstrip(\"\\n\").split(\"\\t\")[:2] for line in sys.stdin); " \
+    "words = dict((word, int(count)) for word, count in lines); " \
+    "out = sys.stdout.buffer if sys.argv[1] == \"-\" else sys.argv[1]; " \
+    "WordCloud(width=int(sys.argv[2]), height=int(sys.argv[3]))" \
+    ".generate_from_frequencies(words).to_image().save(out, \"PNG\")"
+
+/** Generate a word cloud from the \ref CLOUD_MAX_WORDS most frequent
+ *  words of \a counts with \ref render_word_cloud and write the PNG image
+ *  to \a ostr.  Exit on error.
  */
 static void
-generate_word_cloud (const char *input_file, const char *output_file)
+generate_word_cloud (const struct word_counts *counts, FILE *ostr)
+{
+    struct word_count *words = word_counts_sorted (counts);
+    if (!words)
+        error (EXIT_FAILURE, ENOMEM, "Can't sort words");
+
+    size_t num_words = word_counts_size (counts);
+    if (num_words > CLOUD_MAX_WORDS)
+        num_words = CLOUD_MAX_WORDS;
+
+    int res = render_word_cloud (
+        words, num_words, CLOUD_WIDTH, CLOUD_HEIGHT, ostr);
+    free (words);
+
+    if (res)
+        error (EXIT_FAILURE, res, "Can't write word cloud image!");
+}
+
+/** Start the Python package
+ *  <a href="https://github.com/amueller/word_cloud">wordcloud</a> which
+ *  reads words and their counts as printed by \ref word_counts_print and
+ *  saves their word cloud as PNG image to the file \a output_file.
+ *
+ *  \returns A stream to the standard input of the renderer, which has to
+ *      be closed with \ref close_python_renderer, or \c NULL on error.
+ */
+static FILE *
+open_python_renderer (const char *output_file)
 {
     char *cmd;
     int length = asprintf (
-        &cmd,
-        "wordcloud_cli.py --text '%s' --imagefile '%s' "
-        "--width=1500 --height=1000",
-        input_file, output_file);
+        &cmd, "python3 -c '%s' '%s' %d %d",
+        WORD_CLOUD_SCRIPT, output_file, CLOUD_WIDTH, CLOUD_HEIGHT);
     if (length < 0)
         error (EXIT_FAILURE, 0, "Memory allocation error");
 
-    int res = system (cmd);
-    remove (input_file);
+    /* Write errors should be reported if the renderer exits early. */
+    signal (SIGPIPE, SIG_IGN);
+    FILE *renderer = popen (cmd, "w");
     free (cmd);
 
-    if (res)
-        error (EXIT_FAILURE, 0, "wordcloud_cli.py error!");
+    return renderer;
+}
+
+/** Close the input of \a renderer and wait until it saved the image.
+ *  Exit if the renderer failed. */
+static void
+close_python_renderer (FILE *renderer)
+{
+    if (pclose (renderer))
+        error (EXIT_FAILURE, 0, "wordcloud error!");
 }
 
 /** Print version information to \a ostr.  */
@@ -181,7 +830,8 @@ print_version (FILE *ostr)
 void
 print_usage (FILE *ostr)
 {
-    fprintf (ostr, "Usage: %s %s\n", PROJECT_NAME, "[OPTION]... [FILE]...\n");
+    fprintf (ostr, "Usage: %s %s\n", PROJECT_NAME, "[OPTION]... [FILE]...");
+    fprintf (ostr, "  or:  %s %s\n", PROJECT_NAME, "merge [-o FILE] TABLE...\n");
     fprintf (ostr,
 "Generate a word cloud from source files and show the domain as expressed by\n"
 "the code.\n\n");
@@ -194,141 +844,1111 @@ print_usage (FILE *ostr)
 "  -S, --substitute-only\n"
 "                      Remove comments and string literals only and don't\n"
 "                      generate an image. If no -o Option is present print\n"
-"                      to stdout.\n");
+"                      to stdout.\n"
+"  -c, --counts        Count the words and don't generate an image.  Print\n"
+"                      each word and its count separated by a tab, the most\n"
+"                      frequent words first.\n"
+"  --emit-table=FILE   Count the words and save them as binary table in FILE.\n"
+"                      Tables are summed up by 'merge' and read instead of\n"
+"                      source files if their name ends in .dct.  Can't be\n"
+"                      combined with -o.\n"
+"  -j N, --jobs=N      Process N input files in parallel.  With N = 0 use\n"
+"                      one job per processor.  The output is the same as\n"
+"                      for sequential processing, except that with -r the\n"
+"                      files are written in the order they are done.\n"
+"                      Large input files are split and processed on the\n"
+"                      jobs that are left over.\n"
+"  --renderer=NAME     Draw the word cloud with NAME: 'native' (default) or\n"
+"                      'python' for the wordcloud Python package.\n"
+"  --cache-dir=DIR     Keep the stripped text of the input files in DIR and\n"
+"                      reuse it for unchanged files.\n"
+"  -r, --recursive     Process the files in directories and their\n"
+"                      subdirectories except for .git.  The order of the\n"
+"                      files in the output is unspecified.\n"
+"  --include=PATTERNS  Process only files matching one of the comma\n"
+"                      separated wildcard PATTERNS with -r and in archives.\n"
+"                      Patterns containing a '/' match the path below the\n"
+"                      directory or in the archive, others the file name.\n"
+"  --exclude=PATTERNS  Skip files and directories matching one of PATTERNS\n"
+"                      with -r and in archives.\n"
+"  --gitignore         Skip files ignored by .gitignore files with -r.\n"
+"  --stats[=FORMAT]    Write the number of processed bytes, the removed\n"
+"                      comments, strings and white space, the time of each\n"
+"                      phase and the slowest files to standard error as\n"
+"                      'text' (default) or 'json'.\n"
+"  --trace=FILE        Save the time spent on each file and step by each\n"
+"                      thread to FILE in the Chrome Trace Event Format.\n"
+"  --lang=NAME         Strip all input files as NAME: 'c', 'cpp', 'go',\n"
+"                      'js', 'lua', 'python', 'rust' or 'shell'.  By default\n"
+"                      the language is chosen by the file name extension\n"
+"                      and is 'c' for unknown extensions.\n"
+"  --stopwords=FILE    Don't count the words in FILE, which are separated\n"
+"                      by white space.  '#' starts a comment.\n"
+"  --keep-keywords     Count the keywords of the languages, which are\n"
+"                      dropped by default.\n"
+"  --split-identifiers Count the parts of identifiers in small letters,\n"
+"                      split at underscores, capitals after small letters\n"
+"                      and digits, e.g. 'parse', 'cli' and 'options' for\n"
+"                      'parseCliOptions'.\n"
+"  --approx-top=K      Count the words approximately in constant memory and\n"
+"                      print the K most frequent ones with --counts.  Each\n"
+"                      count is followed by its error, by which it may\n"
+"                      exceed the true count.\n"
+"  --mem-limit=SIZE    Use at most SIZE bytes for the counts of\n"
+"                      --approx-top (default 64M).  SIZE may end in K, M\n"
+"                      or G.\n"
+"  --dedupe            Skip input files which are the same file or have the\n"
+"                      same content as an earlier input file.  The\n"
+"                      skipped files and bytes are reported by --stats.\n");
+}
+
+/** A \ref clutter_sink which writes to the \c FILE passed as \a sink_data. */
+static int
+write_to_stream (const char *text, size_t len, void *sink_data)
+{
+    if (fwrite (text, 1, len, sink_data) != len)
+        return errno ? errno : EIO;
+    return 0;
+}
+
+/** Decompress the \a len chars at \a in with \a compression on another
+ *  thread and strip the text as \a lang while it is decompressed.  The
+ *  decompressed and removed chars are added to \a stats.
+ *
+ *  \returns The first nonzero value returned by \a sink, \c EINVAL if
+ *      \a in is corrupt, \c ENOTSUP if \a compression isn't supported,
+ *      \c ENOMEM if out of memory or 0.
+ */
+static int
+remove_clutter_compressed (
+    const struct clutter_lang *lang, enum compression compression,
+    const char *in, size_t len, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    struct decompressor *decompressor;
+    int res = decompressor_start (compression, in, len, &decompressor);
+    if (res)
+        return res;
+
+    unsigned state = 0;
+    const char *block;
+    size_t block_len;
+    while (!res && !(res = decompressor_next (decompressor, &block, &block_len))
+           && block_len)
+        res = remove_clutter_lang_buf (
+            lang, block, block_len, &state, stats, sink, sink_data);
+    if (!res)
+        res = remove_clutter_lang_end (lang, &state, stats, sink, sink_data);
+    decompressor_free (decompressor);
+
+    return res;
+}
+
+/** Strip the \a len chars at \a in as \a lang, C on \a num_jobs
+ *  threads, and add the read and removed chars to \a stats.  Compressed
+ *  input is decompressed first by \ref remove_clutter_compressed.
+ *
+ *  \returns The first nonzero value returned by \a sink, an error of
+ *      the decompression or 0.
+ */
+static int
+remove_clutter_lang_all (
+    const struct clutter_lang *lang, const char *in, size_t len,
+    int num_jobs, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    enum compression compression = input_compression (in, len);
+    if (compression != COMPRESSION_NONE)
+        return remove_clutter_compressed (
+            lang, compression, in, len, stats, sink, sink_data);
+
+    if (lang->native)
+        return remove_clutter_parallel (
+            in, len, num_jobs, stats, sink, sink_data);
+
+    unsigned state = 0;
+    int res = remove_clutter_lang_buf (
+        lang, in, len, &state, stats, sink, sink_data);
+    if (!res)
+        res = remove_clutter_lang_end (lang, &state, stats, sink, sink_data);
+    return res;
+}
+
+/** Read the chars of \a fd, which is \a input_file with \a input_stat,
+ *  and strip them as \a lang like \ref remove_clutter_lang_all.  Reuse
+ *  the stripped text from \ref file_cache if it is there, else add it.
+ *  The file is only read if its stat isn't found.  It is mapped unless
+ *  it is \c stdin, whose position may be past its start.
+ *
+ *  \param loaded If not \c NULL, the content of \a input_file, which is
+ *      used instead of reading \a fd.
+ *  \param file Set to the chars read and removed and whether the text
+ *      came from the cache.
+ *  \returns The first nonzero value returned by \a sink, \a errno if
+ *      some I/O error occurred or 0.
+ */
+static int
+remove_clutter_cached (
+    const char *input_file, const struct clutter_lang *lang, int fd,
+    const struct input_buf *loaded, const struct stat *input_stat,
+    struct file_stats *file, clutter_sink *sink, void *sink_data)
+{
+    char *text = NULL;
+    size_t text_len = 0;
+    file->clutter.bytes_in = (unsigned long long) input_stat->st_size;
+    file->cached = true;
+    const char *lang_name = clutter_lang_name (lang);
+    if (!file_cache_find_stat (
+            file_cache, input_stat, lang_name, &text, &text_len))
+    {
+        int res = sink (text, text_len, sink_data);
+        file->bytes_out = text_len;
+        free (text);
+        return res;
+    }
+
+    size_t size = (size_t) input_stat->st_size;
+    struct input_buf in;
+    int res = 0;
+    if (loaded)
+        in = *loaded;
+    else if (fd == STDIN_FILENO)
+        res = input_buf_read (fd, size, &in);
+    else
+        res = input_buf_map (fd, size, &in);
+    if (res)
+        return res;
+
+    if (file_cache_find_content (
+            file_cache, input_stat, lang_name, in.data, in.len,
+            &text, &text_len))
+    {
+        memset (&file->clutter, 0, sizeof (file->clutter));
+        file->cached = false;
+        FILE *text_stream = open_memstream (&text, &text_len);
+        if (!text_stream)
+            res = errno;
+        else
+        {
+            res = remove_clutter_lang_all (
+                lang, in.data, in.len, file_split_jobs, &file->clutter,
+                write_to_stream, text_stream);
+            if (fclose (text_stream) && !res)
+                res = errno;
+        }
+
+        int cache_res = res ? 0 : file_cache_add (
+            file_cache, input_stat, lang_name, in.data, in.len,
+            text, text_len);
+        if (cache_res)
+            error (0, cache_res, "Can't cache '%s'!", input_file);
+    }
+    if (!loaded)
+        input_buf_release (&in);
+
+    if (!res)
+        res = sink (text, text_len, sink_data);
+    file->bytes_out = text_len;
+    free (text);
+
+    return res;
+}
+
+/** Add \a input_file, which was processed since \a start, to
+ *  \ref run_stats if statistics are collected.  If \a file is \c NULL,
+ *  the file was skipped. */
+static void
+record_input_file (
+    const char *input_file, struct file_stats *file, double start)
+{
+    if (!run_stats)
+        return;
+
+    if (!file)
+    {
+        run_stats_skip_file (run_stats);
+        return;
+    }
+
+    file->seconds = run_stats_now () - start;
+    int res = run_stats_add_file (run_stats, input_file, file);
+    if (res)
+        error (0, res, "Can't collect statistics for '%s'!", input_file);
 }
 
-/** Try to open \a input_file and use this together with \a ostr as arguments
- *  to \ref remove_clutter.
+/** Find out whether the regular file \a fd with \a input_stat is in
+ *  \a seen, first by its inode, then by its content, and add it.  The
+ *  content is only read if the inode is new.
  *
- *  If \a input_file is \c "-", will use \a stdin as input.
+ *  \param loaded The content of \a fd if it was read ahead or \c NULL.
+ *  \param mapped Set to the mapped content if \a loaded is \c NULL.
+ *  \param in Set to \a loaded or \a mapped if the content was read,
+ *      else to \a loaded.
+ *  \param duplicate Set to whether the file was seen before.
+ *  \returns \a errno if the file couldn't be read, \c ENOMEM if out of
+ *      memory or 0.
+ */
+static int
+find_duplicate (
+    struct dedupe_set *seen, int fd, const struct stat *input_stat,
+    const struct input_buf *loaded, struct input_buf *mapped,
+    const struct input_buf **in, bool *duplicate)
+{
+    *in = loaded;
+    *duplicate = false;
+    bool added;
+    int res = dedupe_add_file (seen, input_stat, &added);
+    if (res || !added)
+    {
+        *duplicate = !res;
+        return res;
+    }
+
+    if (!loaded
+        && (res = input_buf_map (fd, (size_t) input_stat->st_size, mapped)))
+        return res;
+    *in = loaded ? loaded : mapped;
+
+    res = dedupe_add_content (seen, (*in)->data, (*in)->len, &added);
+    *duplicate = !res && !added;
+    return res;
+}
+
+/** Remove the input files of \a options which are the same file or have
+ *  the same content as an earlier one by \ref find_duplicate, before
+ *  any of them is processed.  So the first copy is kept on any number of
+ *  threads.  Only regular files are read; \c "-", tables of word counts
+ *  and files which can't be read are kept.  Exit if out of memory. */
+static void
+drop_duplicate_arguments (struct cli_options *options)
+{
+    uint64_t span_start = trace_begin ();
+    struct dedupe_set *seen = dedupe_set_new ();
+    if (!seen)
+        error (EXIT_FAILURE, ENOMEM, "Can't find duplicate input files");
+
+    int kept = 0;
+    for (int arg = 0; arg < options->num_arguments; ++arg)
+    {
+        const char *input_file = options->arguments[arg];
+        size_t name_len = strlen (input_file);
+        bool is_table = options->mode != OUTPUT_TEXT
+            && name_len > strlen (TABLE_SUFFIX)
+            && !strcmp (input_file + name_len - strlen (TABLE_SUFFIX),
+                        TABLE_SUFFIX);
+        struct stat input_stat;
+        int fd = -1;
+        bool duplicate = false;
+        if (strcmp (input_file, "-") && !is_table
+            && !stat (input_file, &input_stat) && S_ISREG (input_stat.st_mode)
+            && (fd = open (input_file, O_RDONLY | O_CLOEXEC)) >= 0
+            && !fstat (fd, &input_stat))
+        {
+            struct input_buf mapped;
+            const struct input_buf *in;
+            int res = find_duplicate (
+                seen, fd, &input_stat, NULL, &mapped, &in, &duplicate);
+            if (res == ENOMEM)
+                error (EXIT_FAILURE, res, "Can't find duplicate input files");
+            if (in == &mapped)
+                input_buf_release (&mapped);
+        }
+        if (fd >= 0)
+            close (fd);
+
+        if (!duplicate)
+            options->arguments[kept++] = options->arguments[arg];
+        else if (run_stats)
+            run_stats_skip_duplicate (
+                run_stats, (unsigned long long) input_stat.st_size);
+    }
+    options->num_arguments = kept;
+
+    dedupe_set_free (seen);
+    trace_end ("drop_duplicates", span_start, 0, NULL);
+}
+
+/** Try to open \a input_file and strip it with \ref remove_clutter.
+ *
+ *  If \a input_file is \c "-", will use \a stdin as input.  Regular files
+ *  are looked up in \ref file_cache if it is open, else mapped and
+ *  stripped in one piece unless they were read ahead.  Pipes and
+ *  \a stdin are read in blocks.  The language is
+ *  \ref input_lang or chosen by the name of \a input_file.  Tar and zip
+ *  archives are stripped member by member by
+ *  \ref remove_clutter_archive.  With \ref seen_files regular files
+ *  which were seen before are skipped by \ref find_duplicate.
  *  Print an error message, if the file can't be opened or if \a remove_clutter
  *  failed.
  *
  *  \param input_file Name of an existing file or \c "-".
+ *  \param loaded The content of \a input_file if it was read ahead or
+ *      \c NULL.
  *  \param ostr The file handle where non-skipped text will be appended.  Has
- *      to be opened for writing.
+ *      to be opened for writing.  Not used if \a counts is given.
+ *  \param counts If not \c NULL, the \ref word_counts to which the words
+ *      of the non-skipped text are added.  Files whose name ends in
+ *      \ref TABLE_SUFFIX are read as table of word counts.
  */
 static void
-process_input_file (const char *input_file, FILE *ostr)
+process_input_file (
+    const char *input_file, const struct loaded_input *loaded, FILE *ostr,
+    void *counts)
 {
+    uint64_t span_start = trace_begin ();
+    double start = run_stats ? run_stats_now () : 0;
+    struct file_stats file;
+    memset (&file, 0, sizeof (file));
+
+    size_t name_len = strlen (input_file);
+    if (counts && name_len > strlen (TABLE_SUFFIX)
+        && !strcmp (input_file + name_len - strlen (TABLE_SUFFIX), TABLE_SUFFIX))
+    {
+        int res = word_counts_read_table (counts, input_file);
+        if (res == EINVAL)
+            error (0, 0, "Can't read table '%s'! It is no valid table.", input_file);
+        else if (res)
+            error (0, res, "Can't read table '%s'!", input_file);
+        record_input_file (input_file, res ? NULL : &file, start);
+        trace_end ("read_table", span_start, 0, input_file);
+        return;
+    }
+
     bool from_stdin = !strcmp (input_file, "-");
-    FILE *istr = from_stdin ? stdin : fopen (input_file, "r");
-    if (!istr)
+    int fd = loaded ? -1
+        : from_stdin ? STDIN_FILENO : open (input_file, O_RDONLY | O_CLOEXEC);
+    if (!loaded && fd < 0)
     {
         error (0, errno, "Can't open '%s'!", input_file);
+        record_input_file (input_file, NULL, start);
+        return;
+    }
+    if (run_stats)
+        file.open_seconds = run_stats_now () - start;
+
+    const struct clutter_lang *lang =
+        input_lang ? input_lang : clutter_lang_for_file (input_file);
+    struct word_tokenizer tokenizer;
+    clutter_sink *sink = write_to_stream;
+    void *sink_data = ostr;
+    if (counts)
+    {
+        word_tokenizer_init (&tokenizer, counts);
+        word_tokenizer_set_filters (
+            &tokenizer, keep_keywords ? NULL : clutter_lang_keywords (lang),
+            stopwords);
+        word_tokenizer_set_split (&tokenizer, split_identifiers);
+        sink = count_words;
+        sink_data = &tokenizer;
+    }
+    struct stat input_stat;
+    if (loaded)
+        input_stat = loaded->stat;
+    bool is_regular = loaded
+        || (!fstat (fd, &input_stat) && S_ISREG (input_stat.st_mode));
+    const struct input_buf *in = loaded ? &loaded->buf : NULL;
+    struct input_buf mapped;
+    bool duplicate = false;
+    int res = 0;
+    if (seen_files && is_regular && !from_stdin)
+        res = find_duplicate (
+            seen_files, fd, &input_stat, in, &mapped, &in, &duplicate);
+    if (res || duplicate)
+    {
+        if (res)
+        {
+            error (0, res, "Can't read '%s'!", input_file);
+            record_input_file (input_file, NULL, start);
+        }
+        else if (run_stats)
+            run_stats_skip_duplicate (
+                run_stats, (unsigned long long) input_stat.st_size);
+        if (in == &mapped)
+            input_buf_release (&mapped);
+        if (fd >= 0)
+            close (fd);
+        trace_end ("process_input_file", span_start, 0, input_file);
         return;
     }
 
-    int res = remove_clutter (istr, ostr);
+    enum archive_format archive = archive_format_for_file (input_file);
+    uint64_t strip_start = trace_begin ();
+    FILE *istr = NULL;
+    if (archive != ARCHIVE_NONE && is_regular && !from_stdin)
+        res = remove_clutter_archive (
+            archive, fd, in, (size_t) input_stat.st_size, &file.clutter,
+            counts ? NULL : ostr, counts ? &tokenizer : NULL,
+            sink, sink_data);
+    else if (file_cache && is_regular)
+        res = remove_clutter_cached (
+            input_file, lang, fd, in, &input_stat, &file, sink, sink_data);
+    else if (in)
+        res = remove_clutter_input (
+            lang, in, &file.clutter, counts ? NULL : ostr, sink, sink_data);
+    else if (is_regular && !from_stdin)
+        res = remove_clutter_mapped (
+            lang, fd, (size_t) input_stat.st_size, &file.clutter,
+            counts ? NULL : ostr, sink, sink_data);
+    else if (!(istr = from_stdin ? stdin : fdopen (fd, "r")))
+        res = errno;
+    else if (counts)
+        res = remove_clutter_lang_file (
+            lang, istr, &file.clutter, sink, sink_data);
+    else
+        res = remove_clutter_stream (lang, istr, ostr, &file.clutter);
+
+    if (!file.cached)
+        file.bytes_out = clutter_stats_bytes_out (&file.clutter);
+    trace_end (
+        "remove_clutter", strip_start, file.clutter.bytes_in, input_file);
+
+    if (counts && !res)
+        res = word_tokenizer_end (&tokenizer);
+    else if (!counts)
+    {
+        uint64_t flush_start = trace_begin ();
+        fflush (ostr);
+        trace_end ("flush_output", flush_start, file.bytes_out, NULL);
+    }
+
     if (res)
         error (0, res, "Error during processing of '%s'!", input_file);
+    record_input_file (input_file, res ? NULL : &file, start);
 
-    if (!from_stdin)
+    if (in == &mapped)
+        input_buf_release (&mapped);
+    if (istr && !from_stdin)
         fclose (istr);
+    else if (fd >= 0 && !from_stdin)
+        close (fd);
+    trace_end (
+        "process_input_file", span_start, file.clutter.bytes_in, input_file);
 }
 
-/** Advance \a istr past the next <tt>*</tt><tt>/</tt> or to \a EOF.
+/** Size of the blocks \ref remove_clutter reads from its input and
+ *  collects for its output. */
+#define CLUTTER_BLOCK_SIZE (64 * 1024)
+
+/** Advance \a pos past the next <tt>*</tt><tt>/</tt> or to \a end.
  *
- *  \param istr The file handle to the input source.  Has to be opened
- *      for reading.
+ *  \param pos Start of the input inside a block comment.
+ *  \param end End of the input.
+ *  \param state Either \ref CLUTTER_BLOCK_COMMENT or
+ *      \ref CLUTTER_BLOCK_COMMENT_STAR if the char before \a pos was a
+ *      <tt>*</tt>.  Set to \ref CLUTTER_CODE if the comment ended.
+ *  \returns The position after the end of the comment or \a end.
  */
-static void
-skip_block_comments (FILE *istr)
+static const char *
+skip_block_comments (
+    const char *pos, const char *end, enum clutter_state *state)
 {
-    int cur = getc (istr);
-    int next;
-    while ((next = getc (istr)) != EOF)
+    if (*state == CLUTTER_BLOCK_COMMENT_STAR && pos < end && *pos == '/')
     {
-        if (cur == '*' && next == '/')
-            break;
-        cur = next;
+        *state = CLUTTER_CODE;
+        return pos + 1;
+    }
+
+    while ((pos = scan_find_char (pos, end, '*')) < end)
+    {
+        if (++pos == end)
+        {
+            *state = CLUTTER_BLOCK_COMMENT_STAR;
+            return pos;
+        }
+        if (*pos == '/')
+        {
+            *state = CLUTTER_CODE;
+            return pos + 1;
+        }
     }
+
+    *state = CLUTTER_BLOCK_COMMENT;
+    return pos;
 }
 
-/** Advance \a istr past the first not escaped delimiter char \a delim
- *  or to \a EOF.
+/** Advance \a pos past the first not escaped delimiter char \a delim
+ *  or to \a end.
  *
  *  \param delim The delimiter char.
- *  \param istr The file handle to the input source.  Has to be opened
- *      for reading.
+ *  \param pos Start of the input inside the delimited text.
+ *  \param end End of the input.
+ *  \param escaped Whether the char at \a pos is escaped.  Will be set to
+ *      whether the char following \a end is escaped.
+ *  \returns The position after the delimiter or \c NULL if \a end was
+ *      reached first.
  */
-static void
-skip_delimiter_escape_aware (int delim, FILE *istr)
+static const char *
+skip_delimiter_escape_aware (
+    char delim, const char *pos, const char *end, bool *escaped)
 {
-    int cur;
-    bool ignore_next = false;
-    while ((cur = getc (istr)) != EOF)
+    if (*escaped)
     {
-        if (ignore_next)
-            ignore_next = false;
-        else if (cur == '\\')
-            ignore_next = true;
-        else if (cur == delim)
-            break;
+        if (pos == end)
+            return NULL;
+        ++pos;
+    }
+
+    /* A backslash escapes the char after it, so skipping that char keeps
+     * track of the parity of successive backslashes. */
+    while ((pos = scan_find_char2 (pos, end, delim, '\\')) < end)
+    {
+        if (*pos++ == delim)
+        {
+            *escaped = false;
+            return pos;
+        }
+        if (pos == end)
+        {
+            *escaped = true;
+            return NULL;
+        }
+        ++pos;
     }
+
+    *escaped = false;
+    return NULL;
 }
 
-/** Write a space to \a ostr and skip following white space. The first
- *  char that is not white space is pushed back to \a istr.
+/** Skip the rest of a line comment, string or char literal.
  *
- *  \param istr The file handle to the input source.  Has to be opened
- *      for reading.
- *  \param ostr The file handle where non-skipped text will be put.  Has
- *      to be opened for writing.
- *  \pre The last char read was a white space.
- *  \post The position of \a ostr is at the first char that is not white space
- *      or at \a EOF.
+ *  \param delim The delimiter char which ends the text.
+ *  \param plain The state inside the text.
+ *  \param escape The state inside the text after a \c \\.
+ *  \param pos Start of the input.
+ *  \param end End of the input.
+ *  \param state Either \a plain or \a escape.  Set to \ref CLUTTER_CODE if
+ *      the delimiter was found.
+ *  \returns The position after the delimiter or \a end.
  */
-static void
-skip_white_space (FILE *istr, FILE *ostr)
+static const char *
+skip_delimited (
+    char delim, enum clutter_state plain, enum clutter_state escape,
+    const char *pos, const char *end, enum clutter_state *state)
+{
+    bool escaped = *state == escape;
+    const char *after = skip_delimiter_escape_aware (delim, pos, end, &escaped);
+
+    if (after)
+    {
+        *state = CLUTTER_CODE;
+        return after;
+    }
+
+    *state = escaped ? escape : plain;
+    return end;
+}
+
+/** Skip white space.
+ *
+ *  \returns The position of the first char that is not white space or
+ *      \a end.
+ */
+static const char *
+skip_white_space (const char *pos, const char *end)
+{
+    return scan_find_non_space (pos, end);
+}
+
+/** Copy a run of code from \a pos to \a sink up to the start of the next
+ *  comment, literal or white space.  A single space ending the run is
+ *  copied as part of the run.
+ *
+ *  \param state Set to the state for the char that ended the run.
+ *  \param res Set to the value returned by \a sink.
+ *  \returns The position after the char that ended the run or \a end.
+ */
+static const char *
+copy_code (
+    const char *pos, const char *end, enum clutter_state *state,
+    clutter_sink *sink, void *sink_data, int *res)
 {
-    putc (' ', ostr);
-    int cur;
-    while ((cur = getc (istr)) != EOF)
+    const char *run = pos;
+    while (pos < end && !char_is (*pos, CHAR_CLUTTER_START))
+        ++pos;
+
+    const char *run_end = pos;
+    if (pos < end)
     {
-        if (!isspace (cur))
+        char cur = *pos++;
+        if (cur == '/')
+            *state = CLUTTER_SLASH;
+        else if (cur == '"')
+            *state = CLUTTER_STRING;
+        else if (cur == '\'')
+            *state = CLUTTER_CHAR;
+        else
         {
-            ungetc (cur, istr);
-            break;
+            *state = CLUTTER_WHITE_SPACE;
+            if (cur == ' ')
+                run_end = pos;
         }
     }
+
+    if (run_end > run)
+        *res = sink (run, (size_t) (run_end - run), sink_data);
+    if (!*res && *state == CLUTTER_WHITE_SPACE && run_end != pos)
+        *res = sink (" ", 1, sink_data);
+
+    return pos;
 }
 
-/** Skip block or line comments if the next read char is \c / or <tt>*</tt>,
- *  respectively.  Otherwise push back this char with \a ungetc and put \c /
- *  to \a ostr.
+/** Copy the \a len chars of \a in to \a sink while skipping comments,
+ *  string literals and replacing successive white space by a single
+ *  space.
+ *
+ *  The input may be split into arbitrary blocks: the lexer state is
+ *  carried in \a state from one call to the next.  Call
+ *  \ref remove_clutter_end after the last block.
+ *
+ *  \param in The input text.
+ *  \param len The length of \a in.
+ *  \param state The lexer state.  Has to be \ref CLUTTER_CODE at the start
+ *      of the input.
+ *  \param stats If not \c NULL, the chars of \a in and the removed chars
+ *      are added to it.
+ *  \param sink Receives the non-skipped text in contiguous runs.
+ *  \param sink_data Passed through to \a sink.
+ *  \returns The first nonzero value returned by \a sink or 0.
+ */
+int
+remove_clutter_buf (
+    const char *in, size_t len, enum clutter_state *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data)
+{
+    const char *pos = in;
+    const char *end = in + len;
+    enum clutter_state cur_state = *state;
+    size_t comment_bytes = 0;
+    size_t string_bytes = 0;
+    size_t white_space_bytes = 0;
+    int res = 0;
+
+    while (pos < end && !res)
+    {
+        const char *step = pos;
+        switch (cur_state)
+        {
+            case CLUTTER_CODE:
+                pos = copy_code (pos, end, &cur_state, sink, sink_data, &res);
+                /* The opening quote belongs to the literal. */
+                if (cur_state == CLUTTER_STRING || cur_state == CLUTTER_CHAR)
+                    ++string_bytes;
+                break;
+
+            case CLUTTER_SLASH:
+                if (*pos == '/')
+                {
+                    cur_state = CLUTTER_LINE_COMMENT;
+                    ++pos;
+                    comment_bytes += 2;
+                }
+                else if (*pos == '*')
+                {
+                    cur_state = CLUTTER_BLOCK_COMMENT;
+                    ++pos;
+                    comment_bytes += 2;
+                }
+                else
+                {
+                    /* Not a comment: reread *pos as code. */
+                    cur_state = CLUTTER_CODE;
+                    res = sink ("/", 1, sink_data);
+                }
+                break;
+
+            case CLUTTER_LINE_COMMENT:
+            case CLUTTER_LINE_COMMENT_ESCAPE:
+                pos = skip_delimited (
+                    '\n', CLUTTER_LINE_COMMENT, CLUTTER_LINE_COMMENT_ESCAPE,
+                    pos, end, &cur_state);
+                comment_bytes += (size_t) (pos - step);
+                break;
+
+            case CLUTTER_BLOCK_COMMENT:
+            case CLUTTER_BLOCK_COMMENT_STAR:
+                pos = skip_block_comments (pos, end, &cur_state);
+                comment_bytes += (size_t) (pos - step);
+                break;
+
+            case CLUTTER_STRING:
+            case CLUTTER_STRING_ESCAPE:
+                pos = skip_delimited (
+                    '"', CLUTTER_STRING, CLUTTER_STRING_ESCAPE,
+                    pos, end, &cur_state);
+                string_bytes += (size_t) (pos - step);
+                break;
+
+            case CLUTTER_CHAR:
+            case CLUTTER_CHAR_ESCAPE:
+                pos = skip_delimited (
+                    '\'', CLUTTER_CHAR, CLUTTER_CHAR_ESCAPE,
+                    pos, end, &cur_state);
+                string_bytes += (size_t) (pos - step);
+                break;
+
+            case CLUTTER_WHITE_SPACE:
+                pos = skip_white_space (pos, end);
+                white_space_bytes += (size_t) (pos - step);
+                if (pos < end)
+                    cur_state = CLUTTER_CODE;
+                break;
+
+            default:
+                res = EINVAL;
+        }
+    }
+
+    if (stats)
+    {
+        stats->bytes_in += len;
+        stats->comment_bytes += comment_bytes;
+        stats->string_bytes += string_bytes;
+        stats->white_space_bytes += white_space_bytes;
+    }
+
+    *state = cur_state;
+    return res;
+}
+
+/** Finish the input processed by \ref remove_clutter_buf: a pending
+ *  \c / is written to \a sink.  Any comment or literal is terminated by the
+ *  end of the input.
+ *
+ *  \param state The lexer state after the last block.  Will be reset to
+ *      \ref CLUTTER_CODE.
+ *  \returns The value returned by \a sink or 0.
+ */
+int
+remove_clutter_end (
+    enum clutter_state *state, clutter_sink *sink, void *sink_data)
+{
+    int res = 0;
+    if (*state == CLUTTER_SLASH)
+        res = sink ("/", 1, sink_data);
+
+    *state = CLUTTER_CODE;
+    return res;
+}
+
+/** Add the counts of \a from to \a into. */
+void
+clutter_stats_add (struct clutter_stats *into, const struct clutter_stats *from)
+{
+    into->bytes_in += from->bytes_in;
+    into->comment_bytes += from->comment_bytes;
+    into->string_bytes += from->string_bytes;
+    into->white_space_bytes += from->white_space_bytes;
+}
+
+/** The number of chars copied from the input counted in \a stats. */
+unsigned long long
+clutter_stats_bytes_out (const struct clutter_stats *stats)
+{
+    return stats->bytes_in - stats->comment_bytes - stats->string_bytes
+        - stats->white_space_bytes;
+}
+
+/** \struct stream_sink
+ *  \brief Collect the output of \ref remove_clutter_buf in blocks of
+ *      \ref CLUTTER_BLOCK_SIZE for a \c FILE.
+ *
+ *  \var FILE *stream_sink::ostr
+ *      Where the full blocks are written to.
+ *  \var size_t stream_sink::len
+ *      Number of chars in \a buf.
+ *  \var char stream_sink::buf[]
+ *      The collected text.
+ */
+struct stream_sink
+{
+    FILE *ostr;
+    size_t len;
+    char buf[CLUTTER_BLOCK_SIZE];
+};
+
+/** Write the content of \a out to its stream.
+ *
+ *  \returns \a errno if the write failed else 0.
+ */
+static int
+flush_stream_sink (struct stream_sink *out)
+{
+    size_t written = fwrite (out->buf, 1, out->len, out->ostr);
+    bool failed = written != out->len;
+    out->len = 0;
+
+    if (failed)
+        return errno ? errno : EIO;
+    else
+        return 0;
+}
+
+/** A \ref clutter_sink for a \ref stream_sink passed as \a sink_data. */
+static int
+write_stream_sink (const char *text, size_t len, void *sink_data)
+{
+    struct stream_sink *out = sink_data;
+
+    if (out->len + len > sizeof (out->buf))
+    {
+        int res = flush_stream_sink (out);
+        if (res)
+            return res;
+        if (len > sizeof (out->buf))
+        {
+            if (fwrite (text, 1, len, out->ostr) != len)
+                return errno ? errno : EIO;
+            return 0;
+        }
+    }
+
+    memcpy (out->buf + out->len, text, len);
+    out->len += len;
+    return 0;
+}
+
+/** Strip the content of \a istr like \ref remove_clutter_buf and pass
+ *  the non-skipped text to \a sink.
  *
  *  \param istr The file handle to the input source.  Has to be opened
  *      for reading.
- *  \param ostr The file handle where non-skipped text will be put.  Has
- *      to be opened for writing.
- *  \pre The last char read was a \c /.
- *  \post The position of \a ostr is
- *    \li after the first not escaped newline (line comment \c //),
- *    \li after the first <tt>*</tt><tt>/</tt> (block comment),
- *    \li at the position of the start of the function call (not a comment) or
- *    \li at \a EOF (comment "terminated" by \a EOF).
+ *  \param stats If not \c NULL, the read and removed chars are added to
+ *      it.
+ *  \param sink Receives the non-skipped text.
+ *  \param sink_data Passed through to \a sink.
+ *  \returns The first nonzero value returned by \a sink, \a errno if
+ *      reading failed or 0.
+ *  \post \c feof(istr) is true.
  */
-static void
-try_skip_comments (FILE *istr, FILE *ostr)
+int
+remove_clutter_file (
+    FILE *istr, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    char in[CLUTTER_BLOCK_SIZE];
+    enum clutter_state state = CLUTTER_CODE;
+    int res = 0;
+    size_t len;
+
+    while (!res && (len = fread (in, 1, sizeof (in), istr)) > 0)
+        res = remove_clutter_buf (in, len, &state, stats, sink, sink_data);
+
+    if (!res && ferror (istr))
+        res = errno ? errno : EIO;
+    if (!res)
+        res = remove_clutter_end (&state, sink, sink_data);
+
+    return res;
+}
+
+/** Like \ref remove_clutter but strip the input as \a lang and add the
+ *  read and removed chars to \a stats if it is not \c NULL. */
+static int
+remove_clutter_stream (
+    const struct clutter_lang *lang, FILE *istr, FILE *ostr,
+    struct clutter_stats *stats)
 {
-    int next = getc (istr);
+    struct stream_sink out;
+    out.ostr = ostr;
+    out.len = 0;
 
-    if (next == '/')
-        skip_delimiter_escape_aware ('\n', istr);
-    else if (next == '*')
-        skip_block_comments (istr);
+    int res = remove_clutter_lang_file (
+        lang, istr, stats, write_stream_sink, &out);
+    if (!res)
+        res = flush_stream_sink (&out);
+
+    fflush (ostr);
+
+    if (res)
+        return res;
+    else if (ferror (istr) || ferror (ostr))
+        return errno;
     else
+        return 0;
+}
+
+/** Strip the content of \a in as \a lang like
+ *  \ref remove_clutter_lang_all.  Inputs of at least
+ *  \ref SPLIT_MIN_FILE_SIZE chars are stripped on \ref file_split_jobs
+ *  threads.  The read and removed chars are added to \a stats.
+ *
+ *  \param ostr If not \c NULL, the non-skipped text is written to it in
+ *      blocks instead of being passed to \a sink.
+ *  \returns The first nonzero value returned by \a sink, \a errno if
+ *      the output couldn't be written or 0.
+ */
+static int
+remove_clutter_input (
+    const struct clutter_lang *lang, const struct input_buf *in,
+    struct clutter_stats *stats, FILE *ostr,
+    clutter_sink *sink, void *sink_data)
+{
+    struct stream_sink out;
+    if (ostr)
     {
-        putc ('/', ostr);
-        ungetc (next, istr);
+        out.ostr = ostr;
+        out.len = 0;
+        sink = write_stream_sink;
+        sink_data = &out;
     }
+
+    int num_jobs = in->len >= SPLIT_MIN_FILE_SIZE ? file_split_jobs : 1;
+    int res = remove_clutter_lang_all (
+        lang, in->data, in->len, num_jobs, stats, sink, sink_data);
+    if (!res && ostr)
+        res = flush_stream_sink (&out);
+
+    return res;
+}
+
+/** Map the \a size chars of the regular file \a fd and strip them like
+ *  \ref remove_clutter_input.
+ *
+ *  \returns The first nonzero value returned by \a sink, \a errno if
+ *      some I/O error occurred or 0.
+ */
+static int
+remove_clutter_mapped (
+    const struct clutter_lang *lang, int fd, size_t size,
+    struct clutter_stats *stats, FILE *ostr,
+    clutter_sink *sink, void *sink_data)
+{
+    struct input_buf in;
+    int res = input_buf_map (fd, size, &in);
+    if (res)
+        return res;
+
+    res = remove_clutter_input (lang, &in, stats, ostr, sink, sink_data);
+    input_buf_release (&in);
+
+    return res;
+}
+
+/** \struct archive_stripper
+ *  \brief The members of an archive stripped by
+ *      \ref remove_clutter_archive.
+ *
+ *  \var const struct clutter_lang *archive_stripper::lang
+ *      The language of the current member.
+ *  \var unsigned archive_stripper::state
+ *      The state of the lexer of \a lang in the current member.
+ *  \var struct word_tokenizer *archive_stripper::tokenizer
+ *      The tokenizer behind \a sink if the words are counted, else
+ *      \c NULL.  Its keywords are those of \a lang.
+ */
+struct archive_stripper
+{
+    const struct clutter_lang *lang;
+    unsigned state;
+    struct clutter_stats *stats;
+    struct word_tokenizer *tokenizer;
+    clutter_sink *sink;
+    void *sink_data;
+};
+
+/** Whether the archive member \a name passes \ref member_filter. */
+static bool
+select_archive_member (const char *name, void *stripper_data)
+{
+    (void) stripper_data;
+    return walk_filter_selects (member_filter, name);
+}
+
+/** Start stripping the archive member \a name as \ref input_lang or the
+ *  language of \a name. */
+static int
+begin_archive_member (const char *name, void *stripper_data)
+{
+    struct archive_stripper *stripper = stripper_data;
+    stripper->lang = input_lang ? input_lang : clutter_lang_for_file (name);
+    stripper->state = 0;
+    if (stripper->tokenizer)
+        word_tokenizer_set_filters (
+            stripper->tokenizer,
+            keep_keywords ? NULL : clutter_lang_keywords (stripper->lang),
+            stopwords);
+    return 0;
+}
+
+/** Strip the next \a len chars of the current archive member. */
+static int
+strip_archive_member (const char *text, size_t len, void *stripper_data)
+{
+    struct archive_stripper *stripper = stripper_data;
+    return remove_clutter_lang_buf (
+        stripper->lang, text, len, &stripper->state, stripper->stats,
+        stripper->sink, stripper->sink_data);
+}
+
+/** Finish the current archive member.  Its last word isn't joined with
+ *  the first of the next member. */
+static int
+end_archive_member (void *stripper_data)
+{
+    struct archive_stripper *stripper = stripper_data;
+    int res = remove_clutter_lang_end (
+        stripper->lang, &stripper->state, stripper->stats,
+        stripper->sink, stripper->sink_data);
+    if (!res && stripper->tokenizer)
+        res = word_tokenizer_end (stripper->tokenizer);
+    return res;
+}
+
+/** Strip the members of the tar or zip archive in \a format, which is
+ *  \a loaded or the \a size chars of the regular file \a fd, in one
+ *  pass.  Members which don't pass \ref member_filter are skipped.  The
+ *  read and removed chars of all members are added to \a stats.
+ *
+ *  \param ostr If not \c NULL, the non-skipped text is written to it in
+ *      blocks instead of being passed to \a sink.
+ *  \param tokenizer If the words are counted, the tokenizer behind
+ *      \a sink, else \c NULL.
+ *  \returns The first nonzero value returned by \a sink, an error of
+ *      \ref archive_read, \a errno if some I/O error occurred or 0.
+ */
+static int
+remove_clutter_archive (
+    enum archive_format format, int fd, const struct input_buf *loaded,
+    size_t size, struct clutter_stats *stats, FILE *ostr,
+    struct word_tokenizer *tokenizer, clutter_sink *sink, void *sink_data)
+{
+    struct input_buf in;
+    int res = 0;
+    if (loaded)
+        in = *loaded;
+    else if ((res = input_buf_map (fd, size, &in)))
+        return res;
+
+    struct stream_sink out;
+    if (ostr)
+    {
+        out.ostr = ostr;
+        out.len = 0;
+        sink = write_stream_sink;
+        sink_data = &out;
+    }
+
+    struct archive_stripper stripper = {
+        .stats = stats, .tokenizer = tokenizer,
+        .sink = sink, .sink_data = sink_data};
+    struct archive_visitor visitor = {
+        select_archive_member, begin_archive_member, strip_archive_member,
+        end_archive_member, &stripper};
+    res = archive_read (format, in.data, in.len, &visitor);
+    if (!res && ostr)
+        res = flush_stream_sink (&out);
+
+    if (!loaded)
+        input_buf_release (&in);
+    return res;
 }
 
 /** Copy content of \a istr to \a ostr while skipping comments,
  *  string literals and replacing successive white space by a single
  *  space.
  *
+ *  The input is read in blocks and processed by \ref remove_clutter_buf.
+ *
  *  \param istr The file handle to the input source.  Has to be opened
  *      for reading.
  *  \param ostr The file handle where non-skipped text will be put.  Has
@@ -340,26 +1960,7 @@ try_skip_comments (FILE *istr, FILE *ostr)
 int
 remove_clutter (FILE *istr, FILE *ostr)
 {
-    int cur;
-
-    while ((cur = getc (istr)) != EOF && !ferror (ostr))
-    {
-        if (cur == '/')
-            try_skip_comments (istr, ostr);
-        else if (cur == '"' || cur == '\'')
-            skip_delimiter_escape_aware (cur, istr);
-        else if (isspace (cur))
-            skip_white_space (istr, ostr);
-        else
-            putc (cur, ostr);
-    }
-
-    fflush (ostr);
-
-    if (ferror (istr) || ferror (ostr))
-        return errno;
-    else
-        return 0;
+    return remove_clutter_stream (NULL, istr, ostr, NULL);
 }
 
 /* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
@@ -5,12 +5,222 @@
 #ifndef DOMAINCLOUD_H_
 #define DOMAINCLOUD_H_
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
+/** Words shorter than this are not counted by \ref count_words. */
+#define WORD_MIN_LEN 2
+/** Longer words are cut to this length by \ref count_words. */
+#define WORD_MAX_LEN 256
+/** Input files with this suffix are read as tables of word counts. */
+#define TABLE_SUFFIX ".dct"
+
+/** States of the lexer behind \ref remove_clutter_buf.  The state is all
+ *  that has to be carried from one block of input to the next. */
+enum clutter_state
+{
+    CLUTTER_CODE,                   /**< Text which is copied. */
+    CLUTTER_SLASH,                  /**< After a \c / outside a comment. */
+    CLUTTER_LINE_COMMENT,           /**< Inside a \c // comment. */
+    CLUTTER_LINE_COMMENT_ESCAPE,    /**< After a \c \\ in a line comment. */
+    CLUTTER_BLOCK_COMMENT,          /**< Inside a block comment. */
+    CLUTTER_BLOCK_COMMENT_STAR,     /**< After a \c * in a block comment. */
+    CLUTTER_STRING,                 /**< Inside a \c " literal. */
+    CLUTTER_STRING_ESCAPE,          /**< After a \c \\ in a \c " literal. */
+    CLUTTER_CHAR,                   /**< Inside a \c ' literal. */
+    CLUTTER_CHAR_ESCAPE,            /**< After a \c \\ in a \c ' literal. */
+    CLUTTER_WHITE_SPACE,            /**< After white space in code. */
+    CLUTTER_NUM_STATES
+};
+
+/** Receive \a len chars of non-skipped \a text.  Return 0 to continue or
+ *  an \a errno value to stop the processing. */
+typedef int clutter_sink (const char *text, size_t len, void *sink_data);
+
+/** \struct clutter_stats
+ *  \brief What \ref remove_clutter_buf removed from its input.
+ *
+ *  Every char of the input is either copied or removed as part of a
+ *  comment, a literal including its quotes or a run of white space, of
+ *  which a single space is copied.
+ *
+ *  \var unsigned long long clutter_stats::bytes_in
+ *      Number of chars of the input.
+ *  \var unsigned long long clutter_stats::comment_bytes
+ *      Number of chars removed as comments.
+ *  \var unsigned long long clutter_stats::string_bytes
+ *      Number of chars removed as string and char literals.
+ *  \var unsigned long long clutter_stats::white_space_bytes
+ *      Number of chars removed as white space.
+ */
+struct clutter_stats
+{
+    unsigned long long bytes_in;
+    unsigned long long comment_bytes;
+    unsigned long long string_bytes;
+    unsigned long long white_space_bytes;
+};
+
+/** A language whose comments and literals are removed, see
+ *  \ref clutter_lang_find. */
+struct clutter_lang;
+
+/** A set of words which are not counted, see \ref word_filter_new. */
+struct word_filter;
+
+/** A table of words and their number of occurrences. */
+struct word_counts;
+
+/** \struct word_count
+ *  \brief A word of \ref word_counts and its number of occurrences.
+ *
+ *  \var const char *word_count::word
+ *      The zero terminated word.
+ *  \var size_t word_count::len
+ *      The length of \a word.
+ *  \var unsigned long word_count::error
+ *      By how much \a count may exceed the number of occurrences in a
+ *      table of \ref word_counts_new_bounded, else 0.
+ */
+struct word_count
+{
+    const char *word;
+    size_t len;
+    unsigned long count;
+    unsigned long error;
+};
+
+/** \struct word_tokenizer
+ *  \brief The state of \ref count_words between two texts.
+ *
+ *  \var clutter_sink *word_tokenizer::word_sink
+ *      Receives each complete word.  Words split between texts are
+ *      passed from \a word, else from the text itself.
+ *  \var void *word_tokenizer::sink_data
+ *      Passed to \a word_sink.
+ *  \var const struct word_filter *word_tokenizer::keywords
+ *      The keywords of the language, which are dropped.  May be \c NULL.
+ *  \var const struct word_filter *word_tokenizer::stopwords
+ *      Further words which are dropped.  May be \c NULL.
+ *  \var bool word_tokenizer::split
+ *      Whether identifiers are split into their parts in small letters.
+ *  \var bool word_tokenizer::in_word
+ *      Whether the last text ended inside of a word.
+ *  \var char word_tokenizer::word[]
+ *      The start of the word which may be continued by the next text.
+ *  \var char word_tokenizer::part[]
+ *      The part of an identifier converted to small letters.
+ */
+struct word_tokenizer
+{
+    clutter_sink *word_sink;
+    void *sink_data;
+    const struct word_filter *keywords;
+    const struct word_filter *stopwords;
+    size_t len;
+    bool split;
+    bool in_word;
+    char word[WORD_MAX_LEN];
+    char part[WORD_MAX_LEN];
+};
+
+/** What a \ref dc_ctx passes to its callback. */
+enum dc_output
+{
+    DC_OUTPUT_TEXT,     /**< The stripped text in pieces. */
+    DC_OUTPUT_WORDS     /**< Each word of the stripped text. */
+};
+
+/** The state of one input pushed in buffers. */
+struct dc_ctx;
+
 void print_version (FILE *ostr);
 void print_usage (FILE *ostr);
 
 int remove_clutter (FILE *istr, FILE *ostr);
+int remove_clutter_file (
+    FILE *istr, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data);
+int remove_clutter_buf (
+    const char *in, size_t len, enum clutter_state *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data);
+int remove_clutter_end (
+    enum clutter_state *state, clutter_sink *sink, void *sink_data);
+int remove_clutter_parallel (
+    const char *in, size_t len, int num_jobs, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data);
+const struct clutter_lang *clutter_lang_find (const char *name);
+const struct clutter_lang *clutter_lang_for_file (const char *file_name);
+const char *clutter_lang_name (const struct clutter_lang *lang);
+const struct word_filter *clutter_lang_keywords (
+    const struct clutter_lang *lang);
+int remove_clutter_lang_buf (
+    const struct clutter_lang *lang, const char *in, size_t len,
+    unsigned *state, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data);
+int remove_clutter_lang_end (
+    const struct clutter_lang *lang, unsigned *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data);
+int remove_clutter_lang_file (
+    const struct clutter_lang *lang, FILE *istr, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data);
+void clutter_stats_add (
+    struct clutter_stats *into, const struct clutter_stats *from);
+unsigned long long clutter_stats_bytes_out (const struct clutter_stats *stats);
+
+struct word_counts *word_counts_new (void);
+struct word_counts *word_counts_new_bounded (size_t max_words);
+size_t word_counts_max_words (size_t mem_limit);
+void word_counts_free (struct word_counts *counts);
+int word_counts_add (
+    struct word_counts *counts, const char *word, size_t len,
+    unsigned long count);
+int word_counts_merge (struct word_counts *into, const struct word_counts *from);
+size_t word_counts_size (const struct word_counts *counts);
+bool word_counts_is_bounded (const struct word_counts *counts);
+unsigned long word_counts_error_bound (const struct word_counts *counts);
+struct word_count *word_counts_sorted (const struct word_counts *counts);
+int word_counts_print (
+    const struct word_counts *counts, size_t max_words, FILE *ostr);
+
+int word_counts_write_table (const struct word_counts *counts, FILE *ostr);
+int word_counts_read_table (struct word_counts *counts, const char *file_name);
+int merge_count_tables (
+    char **table_files, int num_tables, FILE *ostr, int *bad_table);
+
+int render_word_cloud (
+    const struct word_count *words, size_t num_words,
+    unsigned width, unsigned height, FILE *ostr);
+
+struct word_filter *word_filter_new (const char *const *words, size_t num_words);
+int word_filter_read (const char *file_name, struct word_filter **filter);
+void word_filter_free (struct word_filter *filter);
+bool word_filter_contains (
+    const struct word_filter *filter, const char *word, size_t len);
+
+void word_tokenizer_init (
+    struct word_tokenizer *tokenizer, struct word_counts *counts);
+void word_tokenizer_init_sink (
+    struct word_tokenizer *tokenizer, clutter_sink *word_sink,
+    void *sink_data);
+void word_tokenizer_set_filters (
+    struct word_tokenizer *tokenizer, const struct word_filter *keywords,
+    const struct word_filter *stopwords);
+void word_tokenizer_set_split (struct word_tokenizer *tokenizer, bool split);
+int count_words (const char *text, size_t len, void *tokenizer);
+int word_tokenizer_end (struct word_tokenizer *tokenizer);
+
+struct dc_ctx *dc_ctx_new (
+    enum dc_output output, clutter_sink *callback, void *user_data);
+void dc_ctx_free (struct dc_ctx *ctx);
+void dc_ctx_set_lang (struct dc_ctx *ctx, const struct clutter_lang *lang);
+void dc_ctx_set_filters (
+    struct dc_ctx *ctx, const struct word_filter *keywords,
+    const struct word_filter *stopwords);
+int dc_feed (struct dc_ctx *ctx, const char *buf, size_t len);
+int dc_finish (struct dc_ctx *ctx);
+const struct clutter_stats *dc_ctx_stats (const struct dc_ctx *ctx);
 
 #endif /* not DOMAINCLOUD_H_ */
 
@@ -0,0 +1,33 @@
+/** \file
+ * An embedded bitmap font for the letters, digits and underscores of
+ * words. */
+
+#ifndef FONT_H_
+#define FONT_H_
+
+/** Width of a glyph in pixels. */
+#define GLYPH_WIDTH 5
+/** Height of a glyph in pixels including two rows for descenders. */
+#define GLYPH_HEIGHT 9
+/** Horizontal distance of two glyphs in pixels. */
+#define GLYPH_ADVANCE (GLYPH_WIDTH + 1)
+
+const unsigned char *font_glyph (char cur);
+
+#endif /* not FONT_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,894 @@
+/** \file
+ * Compile the descriptions of the comments and literals of each language
+ * into the transition tables of \ref clutter_lang.
+ *
+ * Usage: gen_lang_tables OUTPUT_FILE
+ *
+ * A language is a list of regions which are removed from code, each
+ * started by an opener and ended by a closer.  The lexer of a language
+ * is built as a deterministic automaton over bytes: code, white space,
+ * prefixes of openers and the inside of each region become states.  An
+ * opener prefix which turns out to be code is written when the byte
+ * after it is known, so every byte takes exactly one transition.
+ * Bytes which behave alike in all states share a class, which keeps the
+ * tables dense.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "char_class.h"
+#include "lang.h"
+#include "word_filter.h"
+
+/** The region is only opened after a char which is not part of a word.
+ *  Used for prefixed openers like <tt>r"</tt> and for quotes which are
+ *  code inside words. */
+#define REGION_AT_WORD_START 0x01
+/** Openers inside of the region nest. */
+#define REGION_NESTED 0x02
+/** If the opener is followed by a word char, both are code.  Tells Rust
+ *  lifetimes from char literals. */
+#define REGION_WORD_IS_CODE 0x04
+/** An unescaped newline ends the region and is code.  Keeps a quote of
+ *  a JavaScript regex literal from removing the rest of the file. */
+#define REGION_LINE 0x08
+
+/** Regions nest at most this deep, deeper openers are ignored. */
+#define MAX_DEPTH 8
+/** Maximum length of openers, closers and emitted texts. */
+#define MAX_TEXT 16
+#define MAX_STATES 4096
+#define MAX_ACTIONS 16384
+#define MAX_KEYWORDS 512
+
+/** \struct region
+ *  \brief A comment or literal of a language.
+ *
+ *  \var char region::escape
+ *      Inside of the region, the char after it is skipped.  0 if there
+ *      are no escapes.
+ *  \var unsigned region::flags
+ *      Set of \c REGION_* flags.
+ */
+struct region
+{
+    const char *opener;
+    const char *closer;
+    char escape;
+    enum lang_removed category;
+    unsigned flags;
+};
+
+/** \struct lang_desc
+ *  \brief The description of a language.
+ *
+ *  \var char lang_desc::code_escape
+ *      In code, the char after it is copied without starting a region.
+ *      0 if there is none.
+ *  \var const char *lang_desc::word_breaks
+ *      The chars besides white space which end a word.  If \c NULL, words
+ *      are identifiers.
+ *  \var const char *lang_desc::keywords
+ *      The keywords separated by spaces.  They are placed into a
+ *      \ref word_filter.
+ */
+struct lang_desc
+{
+    const char *name;
+    const char *extensions[12];
+    bool native;
+    char code_escape;
+    const char *word_breaks;
+    const char *keywords;
+    struct region regions[24];
+};
+
+#define C_REGIONS \
+    {"//", "\n", '\\', LANG_REMOVED_COMMENT, 0}, \
+    {"/*", "*/", 0, LANG_REMOVED_COMMENT, 0}, \
+    {"\"", "\"", '\\', LANG_REMOVED_STRING, 0}, \
+    {"'", "'", '\\', LANG_REMOVED_STRING, 0}
+
+#define C_KEYWORDS \
+    "auto break case char const continue default do double else enum " \
+    "extern float for goto if inline int long register restrict return " \
+    "short signed sizeof static struct switch typedef union unsigned " \
+    "void volatile while _Bool _Complex _Imaginary _Alignas _Alignof " \
+    "_Atomic _Generic _Noreturn _Static_assert _Thread_local bool true " \
+    "false NULL define include ifdef ifndef endif elif undef pragma " \
+    "defined"
+
+#define RAW_STRING(opener, closer) \
+    {opener, closer, 0, LANG_REMOVED_STRING, REGION_AT_WORD_START}
+
+#define LUA_LONG_BRACKETS(category, prefix) \
+    {prefix "[[", "]]", 0, category, 0}, \
+    {prefix "[=[", "]=]", 0, category, 0}, \
+    {prefix "[==[", "]==]", 0, category, 0}, \
+    {prefix "[===[", "]===]", 0, category, 0}
+
+static const struct lang_desc langs[] = {
+    {"c", {".c", ".h"}, true, 0, NULL, C_KEYWORDS, {C_REGIONS}},
+    {
+        "cpp",
+        {".cc", ".cpp", ".cxx", ".c++", ".hh", ".hpp", ".hxx", ".h++",
+         ".ipp", ".tcc"},
+        false, 0, NULL,
+        C_KEYWORDS " alignas alignof and and_eq asm bitand bitor catch "
+        "char8_t char16_t char32_t class compl concept consteval constexpr "
+        "constinit const_cast co_await co_return co_yield decltype delete "
+        "dynamic_cast explicit export friend mutable namespace new noexcept "
+        "not not_eq nullptr operator or or_eq private protected public "
+        "reinterpret_cast requires static_assert static_cast template this "
+        "thread_local throw try typeid typename using virtual wchar_t xor "
+        "xor_eq override final",
+        {
+            C_REGIONS,
+            RAW_STRING ("R\"(", ")\""), RAW_STRING ("LR\"(", ")\""),
+            RAW_STRING ("uR\"(", ")\""), RAW_STRING ("UR\"(", ")\""),
+            RAW_STRING ("u8R\"(", ")\"")
+        }
+    },
+    {
+        "go", {".go"}, false, 0, NULL,
+        "break case chan const continue default defer else fallthrough for "
+        "func go goto if import interface map package range return select "
+        "struct switch type var true false nil iota bool byte rune string "
+        "int int8 int16 int32 int64 uint uint8 uint16 uint32 uint64 "
+        "uintptr float32 float64 error append cap len make new panic",
+        {C_REGIONS, {"`", "`", 0, LANG_REMOVED_STRING, 0}}
+    },
+    {
+        "js", {".js", ".mjs", ".cjs", ".jsx", ".ts", ".tsx"}, false, 0, NULL,
+        "async await break case catch class const continue debugger default "
+        "delete do else export extends false finally for function if import "
+        "in instanceof let new null of return static super switch this "
+        "throw true try typeof undefined var void while with yield "
+        "interface type enum implements private protected public readonly "
+        "abstract as any boolean number string declare namespace",
+        {
+            {"//", "\n", '\\', LANG_REMOVED_COMMENT, 0},
+            {"/*", "*/", 0, LANG_REMOVED_COMMENT, 0},
+            {"\"", "\"", '\\', LANG_REMOVED_STRING, REGION_LINE},
+            {"'", "'", '\\', LANG_REMOVED_STRING, REGION_LINE},
+            {"`", "`", '\\', LANG_REMOVED_STRING, 0}
+        }
+    },
+    {
+        "lua", {".lua"}, false, 0, NULL,
+        "and break do else elseif end false for function goto if in local "
+        "nil not or repeat return then true until while self",
+        {
+            {"--", "\n", 0, LANG_REMOVED_COMMENT, 0},
+            LUA_LONG_BRACKETS (LANG_REMOVED_COMMENT, "--"),
+            LUA_LONG_BRACKETS (LANG_REMOVED_STRING, ""),
+            {"\"", "\"", '\\', LANG_REMOVED_STRING, 0},
+            {"'", "'", '\\', LANG_REMOVED_STRING, 0}
+        }
+    },
+    {
+        "python", {".py", ".pyi", ".pyw"}, false, 0, NULL,
+        "False None True and as assert async await break class continue def "
+        "del elif else except finally for from global if import in is "
+        "lambda nonlocal not or pass raise return try while with yield self "
+        "cls",
+        {
+            {"#", "\n", 0, LANG_REMOVED_COMMENT, 0},
+            {"\"\"\"", "\"\"\"", '\\', LANG_REMOVED_STRING, 0},
+            {"'''", "'''", '\\', LANG_REMOVED_STRING, 0},
+            {"\"", "\"", '\\', LANG_REMOVED_STRING, 0},
+            {"'", "'", '\\', LANG_REMOVED_STRING, 0}
+        }
+    },
+    {
+        "rust", {".rs"}, false, 0, NULL,
+        "as async await break const continue crate dyn else enum extern "
+        "false fn for if impl in let loop match mod move mut pub ref return "
+        "self Self static struct super trait true type unsafe use where "
+        "while Some None Ok Err Option Result Box Vec String bool char str "
+        "i8 i16 i32 i64 i128 isize u8 u16 u32 u64 u128 usize f32 f64",
+        {
+            {"//", "\n", 0, LANG_REMOVED_COMMENT, 0},
+            {"/*", "*/", 0, LANG_REMOVED_COMMENT, REGION_NESTED},
+            {"\"", "\"", '\\', LANG_REMOVED_STRING, 0},
+            RAW_STRING ("r\"", "\""), RAW_STRING ("r#\"", "\"#"),
+            RAW_STRING ("r##\"", "\"##"), RAW_STRING ("r###\"", "\"###"),
+            RAW_STRING ("br\"", "\""), RAW_STRING ("br#\"", "\"#"),
+            RAW_STRING ("br##\"", "\"##"), RAW_STRING ("br###\"", "\"###"),
+            {"'", "'", '\\', LANG_REMOVED_STRING,
+             REGION_AT_WORD_START | REGION_WORD_IS_CODE}
+        }
+    },
+    {
+        "shell", {".sh", ".bash", ".ksh", ".zsh"}, false, '\\',
+        ";&|()<>",
+        "if then else elif fi case esac for select while until do done in "
+        "function time return exit break continue local export readonly "
+        "declare typeset unset shift set echo printf read test eval exec "
+        "source true false",
+        {
+            {"#", "\n", 0, LANG_REMOVED_COMMENT, REGION_AT_WORD_START},
+            {"'", "'", 0, LANG_REMOVED_STRING, 0},
+            {"\"", "\"", '\\', LANG_REMOVED_STRING, 0}
+        }
+    }
+};
+
+/** Kinds of \ref lexer_state. */
+enum state_kind
+{
+    STATE_CODE,         /**< Code, \a word if after a word char. */
+    STATE_WHITE_SPACE,  /**< After white space in code. */
+    STATE_ESCAPE,       /**< After the \ref lang_desc::code_escape. */
+    STATE_PREFIX,       /**< After the prefix \a text of an opener. */
+    STATE_REGION        /**< Inside of \a region. */
+};
+
+/** \struct lexer_state
+ *  \brief A state of the automaton of a language.
+ *
+ *  All unused members are 0, so states compare with \c memcmp.
+ *
+ *  \var bool lexer_state::word
+ *      Whether the code before the state ended in a word char.  Openers
+ *      with \ref REGION_AT_WORD_START are only recognized if not.
+ *  \var char lexer_state::text[]
+ *      The prefix of an opener or, inside of a region, the longest
+ *      suffix of the region which is a prefix of its closer or, if it is
+ *      nested, of its opener.
+ *  \var int lexer_state::depth
+ *      The number of open nested regions.
+ *  \var bool lexer_state::escaped
+ *      Whether the region is after its escape char.
+ */
+struct lexer_state
+{
+    enum state_kind kind;
+    bool word;
+    char text[MAX_TEXT];
+    size_t len;
+    int region;
+    int depth;
+    bool escaped;
+};
+
+/** \struct action
+ *  \brief The uncompressed \ref lang_action.
+ */
+struct action
+{
+    int next;
+    bool copy;
+    size_t emit_len;
+    char emit[MAX_TEXT];
+    int removed[LANG_NUM_REMOVED];
+};
+
+static const struct lang_desc *lang;
+static struct lexer_state states[MAX_STATES];
+static int num_states;
+static struct action actions[MAX_ACTIONS];
+static int num_actions;
+static int transitions[MAX_STATES][256];
+static struct action end_actions[MAX_STATES];
+
+static void
+fail (const char *message)
+{
+    fprintf (stderr, "gen_lang_tables: %s: %s\n", lang->name, message);
+    exit (EXIT_FAILURE);
+}
+
+/** The id of \a state, which is added if it is new. */
+static int
+state_id (const struct lexer_state *state)
+{
+    for (int id = 0; id < num_states; ++id)
+        if (!memcmp (&states[id], state, sizeof (*state)))
+            return id;
+
+    if (num_states == MAX_STATES)
+        fail ("too many states");
+    states[num_states] = *state;
+    return num_states++;
+}
+
+static bool region_allowed (const struct region *region, bool word);
+static int num_regions (void);
+
+/** Whether some region of \ref lang depends on the char before it. */
+static bool
+tracks_words (void)
+{
+    for (int region = 0; region < num_regions (); ++region)
+        if (!region_allowed (&lang->regions[region], true))
+            return true;
+    return false;
+}
+
+static int
+code_state (bool word)
+{
+    struct lexer_state state;
+    memset (&state, 0, sizeof (state));
+    state.kind = STATE_CODE;
+    state.word = word && tracks_words ();
+    return state_id (&state);
+}
+
+static int
+simple_state (enum state_kind kind)
+{
+    struct lexer_state state;
+    memset (&state, 0, sizeof (state));
+    state.kind = kind;
+    return state_id (&state);
+}
+
+static int
+prefix_state (const char *text, size_t len, bool word)
+{
+    struct lexer_state state;
+    memset (&state, 0, sizeof (state));
+    state.kind = STATE_PREFIX;
+    state.word = word && tracks_words ();
+    memcpy (state.text, text, len);
+    state.len = len;
+    return state_id (&state);
+}
+
+static int
+region_state (
+    int region, int depth, const char *text, size_t len, bool escaped)
+{
+    struct lexer_state state;
+    memset (&state, 0, sizeof (state));
+    state.kind = STATE_REGION;
+    state.region = region;
+    state.depth = depth;
+    memcpy (state.text, text, len);
+    state.len = len;
+    state.escaped = escaped;
+    return state_id (&state);
+}
+
+static bool
+is_word_char (unsigned char cur)
+{
+    if (lang->word_breaks)
+        return !char_is ((char) cur, CHAR_SPACE | CHAR_QUOTE) && cur
+            && !strchr (lang->word_breaks, cur);
+    else
+        return char_is ((char) cur, CHAR_IDENT);
+}
+
+static bool
+region_allowed (const struct region *region, bool word)
+{
+    return !word || !(region->flags & REGION_AT_WORD_START);
+}
+
+static int
+num_regions (void)
+{
+    int num = 0;
+    while (num < (int) (sizeof (lang->regions) / sizeof (lang->regions[0]))
+           && lang->regions[num].opener)
+        ++num;
+    return num;
+}
+
+/** Whether the \a len chars at \a text start an opener after code
+ *  ending in a word char if \a word.  With \a exact, the index of the
+ *  region opened by exactly them or -1. */
+static int
+find_opener (const char *text, size_t len, bool word, bool exact)
+{
+    for (int region = 0; region < num_regions (); ++region)
+    {
+        const struct region *cur = &lang->regions[region];
+        size_t opener_len = strlen (cur->opener);
+        if (region_allowed (cur, word) && len <= opener_len
+            && !memcmp (cur->opener, text, len)
+            && (!exact || len == opener_len))
+            return region;
+    }
+    return -1;
+}
+
+/** Whether an opener is longer than the \a len chars at \a text and
+ *  starts with them. */
+static bool
+has_longer_opener (const char *text, size_t len, bool word)
+{
+    for (int region = 0; region < num_regions (); ++region)
+    {
+        const struct region *cur = &lang->regions[region];
+        if (region_allowed (cur, word) && strlen (cur->opener) > len
+            && !memcmp (cur->opener, text, len))
+            return true;
+    }
+    return false;
+}
+
+static void
+emit (struct action *action, const char *text, size_t len)
+{
+    if (action->emit_len + len > MAX_TEXT)
+        fail ("emitted text too long");
+    memcpy (action->emit + action->emit_len, text, len);
+    action->emit_len += len;
+}
+
+static int step (int state, unsigned char cur, struct action *action);
+
+/** Process the \a len chars at \a text starting in \a state, which are
+ *  no longer available as input.  Chars which are copied are added to
+ *  \a action as emitted text.
+ *
+ *  \returns The state after them.
+ */
+static int
+feed (int state, const char *text, size_t len, struct action *action)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        struct action sub;
+        memset (&sub, 0, sizeof (sub));
+        state = step (state, (unsigned char) text[i], &sub);
+
+        emit (action, sub.emit, sub.emit_len);
+        if (sub.copy)
+            emit (action, &text[i], 1);
+        for (int cat = 0; cat < LANG_NUM_REMOVED; ++cat)
+            action->removed[cat] += sub.removed[cat];
+    }
+    return state;
+}
+
+/** The state after the \a len chars at \a text of an opener.  If they
+ *  are a complete opener which can't be continued, the region is
+ *  entered. */
+static int
+enter_prefix (const char *text, size_t len, bool word, struct action *action)
+{
+    int region = find_opener (text, len, word, true);
+    if (region >= 0 && !has_longer_opener (text, len, word)
+        && !(lang->regions[region].flags & REGION_WORD_IS_CODE))
+    {
+        action->removed[lang->regions[region].category] += (int) len;
+        return region_state (region, 1, "", 0, false);
+    }
+    return prefix_state (text, len, word);
+}
+
+/** The pending prefix of \a state can't be continued: remove its
+ *  longest part which is an opener and process the remaining chars, or
+ *  copy its first char and process the others.
+ *
+ *  \returns The state after the prefix.
+ */
+static int
+resolve_prefix (const struct lexer_state *state, struct action *action)
+{
+    for (size_t len = state->len; len > 0; --len)
+    {
+        int region = find_opener (state->text, len, state->word, true);
+        if (region >= 0)
+        {
+            action->removed[lang->regions[region].category] += (int) len;
+            return feed (
+                region_state (region, 1, "", 0, false),
+                state->text + len, state->len - len, action);
+        }
+    }
+
+    emit (action, state->text, 1);
+    return feed (
+        code_state (is_word_char ((unsigned char) state->text[0])),
+        state->text + 1, state->len - 1, action);
+}
+
+static bool
+is_region_text (const struct region *region, const char *text, size_t len)
+{
+    return (len <= strlen (region->closer)
+            && !memcmp (region->closer, text, len))
+        || ((region->flags & REGION_NESTED) && len <= strlen (region->opener)
+            && !memcmp (region->opener, text, len));
+}
+
+/** Process \a cur in \a state: add the text written before it to
+ *  \a action and set whether it is copied.
+ *
+ *  \returns The next state.
+ */
+static int
+step (int state_index, unsigned char cur, struct action *action)
+{
+    struct lexer_state state = states[state_index];
+    switch (state.kind)
+    {
+        case STATE_CODE:
+            if (char_is ((char) cur, CHAR_SPACE))
+            {
+                if (cur == ' ')
+                    action->copy = true;
+                else
+                    emit (action, " ", 1);
+                return simple_state (STATE_WHITE_SPACE);
+            }
+            else if (lang->code_escape && cur == (unsigned char) lang->code_escape)
+            {
+                action->copy = true;
+                return simple_state (STATE_ESCAPE);
+            }
+            else if (find_opener ((const char *) &cur, 1, state.word, false) >= 0)
+                return enter_prefix ((const char *) &cur, 1, state.word, action);
+
+            action->copy = true;
+            return code_state (is_word_char (cur));
+
+        case STATE_WHITE_SPACE:
+            if (char_is ((char) cur, CHAR_SPACE))
+            {
+                ++action->removed[LANG_REMOVED_WHITE_SPACE];
+                return state_index;
+            }
+            return step (code_state (false), cur, action);
+
+        case STATE_ESCAPE:
+            action->copy = true;
+            return code_state (true);
+
+        case STATE_PREFIX:
+        {
+            char text[MAX_TEXT + 1];
+            memcpy (text, state.text, state.len);
+            text[state.len] = (char) cur;
+            if (find_opener (text, state.len + 1, state.word, false) >= 0)
+                return enter_prefix (text, state.len + 1, state.word, action);
+
+            int region = find_opener (state.text, state.len, state.word, true);
+            if (region >= 0 && (lang->regions[region].flags & REGION_WORD_IS_CODE)
+                && is_word_char (cur))
+            {
+                emit (action, state.text, state.len);
+                action->copy = true;
+                return code_state (true);
+            }
+
+            return step (resolve_prefix (&state, action), cur, action);
+        }
+
+        case STATE_REGION:
+        {
+            const struct region *region = &lang->regions[state.region];
+            if ((region->flags & REGION_LINE) && cur == '\n' && !state.escaped)
+                return step (code_state (false), cur, action);
+
+            ++action->removed[region->category];
+            if (state.escaped)
+                return region_state (state.region, state.depth, "", 0, false);
+            if (region->escape && cur == (unsigned char) region->escape)
+                return region_state (state.region, state.depth, "", 0, true);
+
+            char text[MAX_TEXT + 1];
+            memcpy (text, state.text, state.len);
+            text[state.len] = (char) cur;
+            size_t start = 0;
+            size_t len = state.len + 1;
+            while (len > 0 && !is_region_text (region, text + start, len))
+            {
+                ++start;
+                --len;
+            }
+
+            if (len == strlen (region->closer)
+                && !memcmp (text + start, region->closer, len))
+            {
+                if (state.depth == 1)
+                    return code_state (false);
+                return region_state (state.region, state.depth - 1, "", 0, false);
+            }
+            if ((region->flags & REGION_NESTED) && len == strlen (region->opener)
+                && !memcmp (text + start, region->opener, len))
+            {
+                int depth = state.depth < MAX_DEPTH ? state.depth + 1 : MAX_DEPTH;
+                return region_state (state.region, depth, "", 0, false);
+            }
+            return region_state (
+                state.region, state.depth, text + start, len, false);
+        }
+    }
+
+    fail ("invalid state");
+    return 0;
+}
+
+/** What happens if the input ends in \a state. */
+static void
+end_of_input (int state_index, struct action *action)
+{
+    while (states[state_index].kind == STATE_PREFIX)
+    {
+        struct lexer_state state = states[state_index];
+        state_index = resolve_prefix (&state, action);
+    }
+    action->next = 0;
+}
+
+/** The index of \a action in \ref actions, which is added if it is new. */
+static int
+action_id (const struct action *action)
+{
+    for (int id = 0; id < num_actions; ++id)
+        if (!memcmp (&actions[id], action, sizeof (*action)))
+            return id;
+
+    if (num_actions == MAX_ACTIONS)
+        fail ("too many actions");
+    actions[num_actions] = *action;
+    return num_actions++;
+}
+
+/** Build the automaton of \ref lang. */
+static void
+compile_lang (void)
+{
+    num_states = 0;
+    num_actions = 0;
+    code_state (false);
+
+    for (int state = 0; state < num_states; ++state)
+    {
+        for (int cur = 0; cur < 256; ++cur)
+        {
+            struct action action;
+            memset (&action, 0, sizeof (action));
+            action.next = step (state, (unsigned char) cur, &action);
+            for (int cat = 0; cat < LANG_NUM_REMOVED; ++cat)
+                if (action.removed[cat] > 255)
+                    fail ("too many removed chars");
+            transitions[state][cur] = action_id (&action);
+        }
+
+        memset (&end_actions[state], 0, sizeof (end_actions[state]));
+        end_of_input (state, &end_actions[state]);
+    }
+    if (num_actions > UINT16_MAX || num_states > UINT16_MAX)
+        fail ("tables too large");
+}
+
+static void
+write_string (FILE *ostr, const char *text, size_t len)
+{
+    fputc ('"', ostr);
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char cur = (unsigned char) text[i];
+        if (cur == '"' || cur == '\\')
+            fprintf (ostr, "\\%c", cur);
+        else if (cur >= 0x20 && cur < 0x7f)
+            fputc (cur, ostr);
+        else
+            fprintf (ostr, "\\%03o", cur);
+    }
+    fputc ('"', ostr);
+}
+
+static void
+write_action (FILE *ostr, const struct action *action)
+{
+    fprintf (ostr, "    {%d, %s, %zu, ", action->next,
+             action->copy ? "true" : "false", action->emit_len);
+    write_string (ostr, action->emit, action->emit_len);
+    fprintf (ostr, ", {%d, %d, %d}},\n",
+             action->removed[LANG_REMOVED_COMMENT],
+             action->removed[LANG_REMOVED_STRING],
+             action->removed[LANG_REMOVED_WHITE_SPACE]);
+}
+
+/** Write the keywords of \ref lang to \a ostr as the slots of their
+ *  \ref word_filter. */
+static void
+write_keywords (FILE *ostr)
+{
+    static const char *words[MAX_KEYWORDS];
+    static uint16_t lens[MAX_KEYWORDS];
+    static int32_t displacements[MAX_KEYWORDS];
+    static uint32_t slots[MAX_KEYWORDS];
+    static int slot_words[MAX_KEYWORDS];
+    uint32_t num_words = 0;
+    uint16_t max_len = 0;
+
+    for (const char *pos = lang->keywords; *pos; )
+    {
+        size_t len = strcspn (pos, " ");
+        if (len)
+        {
+            if (num_words == MAX_KEYWORDS)
+                fail ("too many keywords");
+            words[num_words] = pos;
+            lens[num_words++] = (uint16_t) len;
+            if (len > max_len)
+                max_len = (uint16_t) len;
+        }
+        pos += len + (pos[len] == ' ');
+    }
+    if (!num_words)
+        fail ("no keywords");
+    if (word_filter_place (words, lens, num_words, displacements, slots))
+        fail ("can't place the keywords, are they distinct?");
+    for (uint32_t word = 0; word < num_words; ++word)
+        slot_words[slots[word]] = (int) word;
+
+    fprintf (ostr, "static const int32_t %s_keyword_displacements[] = {",
+             lang->name);
+    for (uint32_t bucket = 0; bucket < num_words; ++bucket)
+        fprintf (ostr, "%s%d,", bucket % 12 ? " " : "\n    ",
+                 displacements[bucket]);
+    fprintf (ostr, "\n};\n\n");
+
+    fprintf (ostr, "static const char *const %s_keyword_words[] = {",
+             lang->name);
+    for (uint32_t slot = 0; slot < num_words; ++slot)
+    {
+        fprintf (ostr, "%s", slot % 6 ? " " : "\n    ");
+        write_string (ostr, words[slot_words[slot]], lens[slot_words[slot]]);
+        fputc (',', ostr);
+    }
+    fprintf (ostr, "\n};\n\n");
+
+    fprintf (ostr, "static const uint16_t %s_keyword_lens[] = {", lang->name);
+    for (uint32_t slot = 0; slot < num_words; ++slot)
+        fprintf (ostr, "%s%d,", slot % 16 ? " " : "\n    ",
+                 lens[slot_words[slot]]);
+    fprintf (ostr, "\n};\n\n");
+
+    fprintf (ostr,
+             "static const struct word_filter %s_keywords = {\n"
+             "    %u, %u, %s_keyword_displacements, %s_keyword_words,\n"
+             "    %s_keyword_lens\n};\n\n",
+             lang->name, (unsigned) num_words, (unsigned) max_len,
+             lang->name, lang->name, lang->name);
+}
+
+/** Write the compressed tables of \ref lang to \a ostr.
+ *
+ *  \returns The number of classes.
+ */
+static int
+write_tables (FILE *ostr)
+{
+    int classes[256];
+    int class_bytes[256];
+    int num_classes = 0;
+    for (int cur = 0; cur < 256; ++cur)
+    {
+        int cls = 0;
+        while (cls < num_classes)
+        {
+            int state = 0;
+            while (state < num_states && transitions[state][cur]
+                   == transitions[state][class_bytes[cls]])
+                ++state;
+            if (state == num_states)
+                break;
+            ++cls;
+        }
+        if (cls == num_classes)
+            class_bytes[num_classes++] = cur;
+        classes[cur] = cls;
+    }
+
+    fprintf (ostr, "static const char *const %s_extensions[] = {", lang->name);
+    for (int ext = 0; lang->extensions[ext]; ++ext)
+        fprintf (ostr, "\"%s\", ", lang->extensions[ext]);
+    fprintf (ostr, "NULL};\n\n");
+
+    fprintf (ostr, "static const unsigned char %s_classes[256] = {", lang->name);
+    for (int cur = 0; cur < 256; ++cur)
+        fprintf (ostr, "%s%d,", cur % 16 ? " " : "\n    ", classes[cur]);
+    fprintf (ostr, "\n};\n\n");
+
+    fprintf (ostr, "static const uint16_t %s_transitions[] = {\n", lang->name);
+    for (int state = 0; state < num_states; ++state)
+    {
+        fprintf (ostr, "    ");
+        for (int cls = 0; cls < num_classes; ++cls)
+            fprintf (ostr, "%d,%s", transitions[state][class_bytes[cls]],
+                     cls + 1 < num_classes ? " " : "\n");
+    }
+    fprintf (ostr, "};\n\n");
+
+    fprintf (ostr, "static const struct lang_action %s_actions[] = {\n",
+             lang->name);
+    for (int action = 0; action < num_actions; ++action)
+        write_action (ostr, &actions[action]);
+    fprintf (ostr, "};\n\n");
+
+    fprintf (ostr, "static const struct lang_action %s_end_actions[] = {\n",
+             lang->name);
+    for (int state = 0; state < num_states; ++state)
+        write_action (ostr, &end_actions[state]);
+    fprintf (ostr, "};\n\n");
+
+    return num_classes;
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf (stderr, "Usage: gen_lang_tables OUTPUT_FILE\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *ostr = fopen (argv[1], "w");
+    if (!ostr)
+    {
+        fprintf (stderr, "gen_lang_tables: Can't open '%s': %s\n",
+                 argv[1], strerror (errno));
+        return EXIT_FAILURE;
+    }
+
+    fprintf (ostr,
+             "/* Generated by gen_lang_tables from the language descriptions"
+             " in\n   gen_lang_tables.c.  Do not edit. */\n\n"
+             "#include <stddef.h>\n\n#include \"lang.h\"\n\n");
+
+    const int num_langs = (int) (sizeof (langs) / sizeof (langs[0]));
+    int num_classes[sizeof (langs) / sizeof (langs[0])];
+    int lang_states[sizeof (langs) / sizeof (langs[0])];
+    for (int i = 0; i < num_langs; ++i)
+    {
+        lang = &langs[i];
+        compile_lang ();
+        num_classes[i] = write_tables (ostr);
+        write_keywords (ostr);
+        lang_states[i] = num_states;
+    }
+
+    fprintf (ostr, "const struct clutter_lang clutter_langs[] = {\n");
+    for (int i = 0; i < num_langs; ++i)
+    {
+        const char *name = langs[i].name;
+        fprintf (ostr,
+                 "    {\"%s\", %s_extensions, %s, &%s_keywords, %d, %d,\n"
+                 "     %s_classes, %s_transitions, %s_actions,"
+                 " %s_end_actions},\n",
+                 name, name, langs[i].native ? "true" : "false", name,
+                 lang_states[i], num_classes[i], name, name, name, name);
+    }
+    fprintf (ostr, "};\n\nconst int num_clutter_langs = %d;\n", num_langs);
+
+    if (fclose (ostr))
+    {
+        fprintf (stderr, "gen_lang_tables: Can't write '%s': %s\n",
+                 argv[1], strerror (errno));
+        remove (argv[1]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,113 @@
+/** \file
+ * Mapping and reading of whole input files. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "input.h"
+
+/** Read the content of the open file \a fd, which has \a size bytes, into
+ *  \a buf with \c read.  The file may have changed its size since.
+ *
+ *  \returns \c ENOMEM if out of memory, \a errno if reading failed else 0.
+ */
+int
+input_buf_read (int fd, size_t size, struct input_buf *buf)
+{
+    /* One spare byte sees the end of the file without growing. */
+    size_t capacity = size + 1;
+    char *data = malloc (capacity);
+    if (!data)
+        return ENOMEM;
+
+    size_t len = 0;
+    for (;;)
+    {
+        if (len == capacity)
+        {
+            char *bigger = realloc (data, 2 * capacity);
+            if (!bigger)
+            {
+                free (data);
+                return ENOMEM;
+            }
+            data = bigger;
+            capacity *= 2;
+        }
+
+        ssize_t res = read (fd, data + len, capacity - len);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res < 0)
+        {
+            int err = errno;
+            free (data);
+            return err;
+        }
+        if (res == 0)
+            break;
+        len += (size_t) res;
+    }
+
+    buf->data = data;
+    buf->len = len;
+    buf->mapped = false;
+    return 0;
+}
+
+/** Map the content of the open regular file \a fd, which has \a size
+ *  bytes, into \a buf.  The kernel is told that the map is read once from
+ *  start to end, so it reads ahead and drops the pages behind.  Files
+ *  which can't be mapped are read with \ref input_buf_read.
+ *
+ *  If the file is truncated while it is mapped, reading the pages past
+ *  its new end raises \c SIGBUS, which isn't caught.
+ *
+ *  \returns \c ENOMEM if out of memory, \a errno if reading failed else 0.
+ */
+int
+input_buf_map (int fd, size_t size, struct input_buf *buf)
+{
+    void *map = size ? mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)
+        : MAP_FAILED;
+    if (map == MAP_FAILED)
+        return input_buf_read (fd, size, buf);
+
+    madvise (map, size, MADV_SEQUENTIAL);
+    madvise (map, size, MADV_WILLNEED);
+    buf->data = map;
+    buf->len = size;
+    buf->mapped = true;
+    return 0;
+}
+
+/** Unmap or free the content of \a buf. */
+void
+input_buf_release (struct input_buf *buf)
+{
+    if (buf->mapped)
+        munmap ((void *) buf->data, buf->len);
+    else
+        free ((void *) buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->mapped = false;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
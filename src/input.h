@@ -0,0 +1,52 @@
+/** \file
+ * The content of an input file as one span of memory.
+ *
+ * Regular files are mapped, so stripping reads the page cache directly
+ * without copying the input to user space.  If a file can't be mapped,
+ * it is read into a buffer instead.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** \struct input_buf
+ *  \brief The content of an input file.
+ *
+ *  \var const char *input_buf::data
+ *      The content of the file.
+ *  \var size_t input_buf::len
+ *      The number of chars of \a data.
+ *  \var bool input_buf::mapped
+ *      Whether \a data is mapped or else allocated.
+ */
+struct input_buf
+{
+    const char *data;
+    size_t len;
+    bool mapped;
+};
+
+int input_buf_map (int fd, size_t size, struct input_buf *buf);
+int input_buf_read (int fd, size_t size, struct input_buf *buf);
+void input_buf_release (struct input_buf *buf);
+
+#endif /* not INPUT_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
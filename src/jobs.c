@@ -0,0 +1,271 @@
+/** \file
+ * A pool of worker threads which process one input file at a time into a
+ * memory buffer.  The buffers are written to the output stream in the
+ * order of the input files.  The files after the ones taken are read
+ * ahead by an \ref input_loader. */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "jobs.h"
+#include "loader.h"
+#include "trace.h"
+
+/** Number of finished files per worker which may wait for an earlier file
+ *  before the worker stops taking new files. */
+#define FILES_AHEAD_PER_JOB 4
+
+/** \struct file_result
+ *  \brief The output for one input file.
+ *
+ *  \var char *file_result::text
+ *      The output.  Allocated by \c open_memstream.
+ *  \var size_t file_result::len
+ *      The length of \a text.
+ *  \var bool file_result::done
+ *      Whether the file was processed.
+ */
+struct file_result
+{
+    char *text;
+    size_t len;
+    bool done;
+};
+
+/** \struct file_jobs
+ *  \brief The state shared by the workers of
+ *      \ref process_files_parallel.  All members after \a lock are protected
+ *      by it.
+ *
+ *  \var struct input_load **file_jobs::loads
+ *      The load of each file which is read ahead or \c NULL.
+ *  \var int file_jobs::next_file
+ *      Index of the next file to process.
+ *  \var int file_jobs::next_load
+ *      Index of the next file to read ahead.
+ *  \var int file_jobs::num_loads
+ *      Number of loads which aren't released yet.
+ *  \var int file_jobs::next_output
+ *      Index of the next file to write to \a ostr.
+ *  \var struct file_result *file_jobs::window
+ *      Ring buffer of \a window_size results, starting with the one for
+ *      \a next_output.
+ */
+struct file_jobs
+{
+    char **input_files;
+    int num_files;
+    FILE *ostr;
+    input_file_processor *process;
+    int window_size;
+    struct input_loader *loader;
+    struct input_load **loads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t output_done;
+    int next_file;
+    int next_load;
+    int num_loads;
+    int next_output;
+    struct file_result *window;
+    int write_error;
+};
+
+/** Write all results which are done and next in order to the output
+ *  stream.  Has to be called with the lock held. */
+static void
+write_finished_results (struct file_jobs *jobs)
+{
+    struct file_result *res;
+    bool wrote = false;
+
+    while ((res = &jobs->window[jobs->next_output % jobs->window_size])->done)
+    {
+        uint64_t write_start = trace_begin ();
+        if (!jobs->write_error && res->len
+            && fwrite (res->text, 1, res->len, jobs->ostr) != res->len)
+            jobs->write_error = errno ? errno : EIO;
+        trace_end ("write_output", write_start, res->len, NULL);
+
+        free (res->text);
+        *res = (struct file_result) {NULL, 0, false};
+        ++jobs->next_output;
+        wrote = true;
+    }
+
+    if (wrote)
+        pthread_cond_broadcast (&jobs->output_done);
+}
+
+/** Queue the loads of the next files until \ref INPUT_LOADER_DEPTH are
+ *  in flight.  Has to be called with the lock held. */
+static void
+load_files_ahead (struct file_jobs *jobs)
+{
+    while (jobs->loader && jobs->num_loads < INPUT_LOADER_DEPTH
+           && jobs->next_load < jobs->num_files)
+    {
+        int file = jobs->next_load++;
+        if (input_loader_skips (jobs->input_files[file]))
+            continue;
+        jobs->loads[file] =
+            input_loader_add (jobs->loader, jobs->input_files[file]);
+        if (jobs->loads[file])
+            ++jobs->num_loads;
+    }
+}
+
+/** \struct file_worker
+ *  \brief Argument of \ref process_files_worker. */
+struct file_worker
+{
+    struct file_jobs *jobs;
+    void *data;
+    pthread_t thread;
+};
+
+/** Thread function: process input files until all are taken. */
+static void *
+process_files_worker (void *worker_arg)
+{
+    struct file_worker *worker = worker_arg;
+    struct file_jobs *jobs = worker->jobs;
+
+    pthread_mutex_lock (&jobs->lock);
+    while (jobs->next_file < jobs->num_files)
+    {
+        if (jobs->next_file - jobs->next_output >= jobs->window_size)
+        {
+            pthread_cond_wait (&jobs->output_done, &jobs->lock);
+            continue;
+        }
+
+        load_files_ahead (jobs);
+        int file = jobs->next_file++;
+        struct input_load *load = jobs->loads ? jobs->loads[file] : NULL;
+        pthread_mutex_unlock (&jobs->lock);
+
+        struct file_result res = {NULL, 0, true};
+        FILE *buffer = NULL;
+        if (jobs->ostr)
+            buffer = open_memstream (&res.text, &res.len);
+        if (buffer || !jobs->ostr)
+            jobs->process (
+                jobs->input_files[file], load ? input_load_wait (load) : NULL,
+                buffer, worker->data);
+        if (buffer)
+            fclose (buffer);
+        input_load_release (load);
+
+        pthread_mutex_lock (&jobs->lock);
+        if (load)
+            --jobs->num_loads;
+        if (!buffer && jobs->ostr)
+            jobs->write_error = errno;
+        jobs->window[file % jobs->window_size] = res;
+        write_finished_results (jobs);
+    }
+    pthread_mutex_unlock (&jobs->lock);
+
+    return NULL;
+}
+
+/** Call \a process for each of the \a num_files \a input_files on
+ *  \a num_jobs threads.  Each file is processed into its own memory
+ *  buffer; the buffers are written to \a ostr in the order of
+ *  \a input_files, so the output is the same as for sequential
+ *  processing.  Small regular files are read ahead of the threads and
+ *  \a process gets their content.
+ *
+ *  If \a ostr is \c NULL, \a process gets \c NULL as stream.  If
+ *  \a worker_data is not \c NULL, it has \a num_jobs entries and
+ *  \a process gets a different entry on each thread.
+ *
+ *  \returns \a errno if a buffer couldn't be allocated or written to
+ *      \a ostr else 0.
+ */
+int
+process_files_parallel (
+    char **input_files, int num_files, FILE *ostr, int num_jobs,
+    input_file_processor *process, void **worker_data)
+{
+    if (num_jobs > num_files)
+        num_jobs = num_files;
+    if (num_jobs < 1)
+        return 0;
+
+    struct file_jobs jobs = {
+        .input_files = input_files, .num_files = num_files, .ostr = ostr,
+        .process = process, .window_size = num_jobs * FILES_AHEAD_PER_JOB};
+
+    jobs.window = calloc ((size_t) jobs.window_size, sizeof (*jobs.window));
+    struct file_worker *workers = calloc ((size_t) num_jobs, sizeof (*workers));
+    if (!jobs.window || !workers)
+    {
+        free (jobs.window);
+        free (workers);
+        return ENOMEM;
+    }
+
+    /* Without a loader each file is read by its worker. */
+    jobs.loads = calloc ((size_t) num_files, sizeof (*jobs.loads));
+    if (jobs.loads)
+        jobs.loader = input_loader_new ();
+
+    pthread_mutex_init (&jobs.lock, NULL);
+    pthread_cond_init (&jobs.output_done, NULL);
+
+    int started = 0;
+    for (; started < num_jobs; ++started)
+    {
+        workers[started].jobs = &jobs;
+        workers[started].data = worker_data ? worker_data[started] : NULL;
+        if (pthread_create (
+                &workers[started].thread, NULL, process_files_worker,
+                &workers[started]))
+            break;
+    }
+
+    /* Without any thread the calling one does all the work. */
+    if (!started)
+        process_files_worker (&workers[0]);
+
+    for (int worker = 0; worker < started; ++worker)
+        pthread_join (workers[worker].thread, NULL);
+
+    input_loader_free (jobs.loader);
+    pthread_cond_destroy (&jobs.output_done);
+    pthread_mutex_destroy (&jobs.lock);
+    free (workers);
+    free (jobs.loads);
+    free (jobs.window);
+
+    return jobs.write_error;
+}
+
+/** The number of online processors or 1 if unknown. */
+int
+default_num_jobs (void)
+{
+    long num_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (int) num_cpus : 1;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
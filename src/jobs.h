@@ -0,0 +1,41 @@
+/** \file
+ * Process input files on several threads and write their output in the
+ * order of the files.
+ */
+
+#ifndef JOBS_H_
+#define JOBS_H_
+
+#include <stdio.h>
+
+struct loaded_input;
+
+/** Process \a input_file and write the result to \a ostr.  \a loaded is
+ *  the content of \a input_file if it was read ahead, else \c NULL.
+ *  \a worker_data is used by one thread only. */
+typedef void input_file_processor (
+    const char *input_file, const struct loaded_input *loaded, FILE *ostr,
+    void *worker_data);
+
+int process_files_parallel (
+    char **input_files, int num_files, FILE *ostr, int num_jobs,
+    input_file_processor *process, void **worker_data);
+int default_num_jobs (void);
+
+#endif /* not JOBS_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,255 @@
+/** \file
+ * Strip the comments and literals of other languages than C with the
+ * tables compiled by gen_lang_tables.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "lang.h"
+
+/** Size of the blocks \ref remove_clutter_lang_file reads. */
+#define LANG_BLOCK_SIZE (64 * 1024)
+
+/** The language called \a name or \c NULL if there is none. */
+const struct clutter_lang *
+clutter_lang_find (const char *name)
+{
+    for (int i = 0; i < num_clutter_langs; ++i)
+        if (!strcmp (clutter_langs[i].name, name))
+            return &clutter_langs[i];
+    return NULL;
+}
+
+/** Suffixes of compressed files, which come after the extension. */
+static const char *const compression_suffixes[] = {".gz", ".zst", ".xz", NULL};
+
+/** The language of \a file_name by its extension, which may be followed
+ *  by one of \ref compression_suffixes.  Files with unknown or no
+ *  extensions are C. */
+const struct clutter_lang *
+clutter_lang_for_file (const char *file_name)
+{
+    const char *base = strrchr (file_name, '/');
+    base = base ? base + 1 : file_name;
+    size_t len = strlen (base);
+    for (const char *const *suffix = compression_suffixes; *suffix; ++suffix)
+    {
+        size_t suffix_len = strlen (*suffix);
+        if (len > suffix_len && !strcmp (base + len - suffix_len, *suffix))
+        {
+            len -= suffix_len;
+            break;
+        }
+    }
+
+    const char *ext = memrchr (base, '.', len);
+    size_t ext_len = ext ? (size_t) (base + len - ext) : 0;
+    if (ext)
+        for (int i = 0; i < num_clutter_langs; ++i)
+            for (const char *const *cur = clutter_langs[i].extensions;
+                 *cur; ++cur)
+                if (strlen (*cur) == ext_len && !memcmp (*cur, ext, ext_len))
+                    return &clutter_langs[i];
+
+    return clutter_lang_find ("c");
+}
+
+/** The name of \a lang as given to \ref clutter_lang_find. */
+const char *
+clutter_lang_name (const struct clutter_lang *lang)
+{
+    return lang ? lang->name : "c";
+}
+
+/** The keywords of \a lang, which are not counted as words. */
+const struct word_filter *
+clutter_lang_keywords (const struct clutter_lang *lang)
+{
+    return (lang ? lang : clutter_lang_find ("c"))->keywords;
+}
+
+/** Add the removed chars counted in \a removed and \a len read chars to
+ *  \a stats if it is not \c NULL. */
+static void
+add_removed (
+    struct clutter_stats *stats, size_t len,
+    const unsigned long long removed[LANG_NUM_REMOVED])
+{
+    if (!stats)
+        return;
+
+    stats->bytes_in += len;
+    stats->comment_bytes += removed[LANG_REMOVED_COMMENT];
+    stats->string_bytes += removed[LANG_REMOVED_STRING];
+    stats->white_space_bytes += removed[LANG_REMOVED_WHITE_SPACE];
+}
+
+/** Like \ref remove_clutter_buf with the tables of \a lang.  Each byte
+ *  is one table lookup; runs of copied bytes are passed to \a sink at
+ *  once.
+ *
+ *  \param state Has to be 0 at the start of the input.
+ *  \returns The first nonzero value returned by \a sink, \c EINVAL if
+ *      \a state is invalid or 0.
+ */
+int
+lang_table_buf (
+    const struct clutter_lang *lang, const char *in, size_t len,
+    unsigned *state, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    const unsigned char *classes = lang->classes;
+    const uint16_t *transitions = lang->transitions;
+    const struct lang_action *actions = lang->actions;
+    const unsigned num_classes = lang->num_classes;
+    const char *pos = in;
+    const char *end = in + len;
+    const char *run = NULL;
+    unsigned cur_state = *state;
+    unsigned long long removed[LANG_NUM_REMOVED] = {0};
+    int res = 0;
+
+    if (cur_state >= lang->num_states)
+        return EINVAL;
+
+    for (; pos < end && !res; ++pos)
+    {
+        const struct lang_action *action = &actions[transitions[
+            cur_state * num_classes + classes[(unsigned char) *pos]]];
+        cur_state = action->next;
+        removed[LANG_REMOVED_COMMENT] += action->removed[LANG_REMOVED_COMMENT];
+        removed[LANG_REMOVED_STRING] += action->removed[LANG_REMOVED_STRING];
+        removed[LANG_REMOVED_WHITE_SPACE] +=
+            action->removed[LANG_REMOVED_WHITE_SPACE];
+
+        if (action->copy && !action->emit_len)
+        {
+            if (!run)
+                run = pos;
+            continue;
+        }
+
+        if (run)
+        {
+            res = sink (run, (size_t) (pos - run), sink_data);
+            run = NULL;
+        }
+        if (!res && action->emit_len)
+            res = sink (action->emit, action->emit_len, sink_data);
+        if (action->copy)
+            run = pos;
+    }
+    if (run && !res)
+        res = sink (run, (size_t) (pos - run), sink_data);
+
+    add_removed (stats, len, removed);
+    *state = cur_state;
+    return res;
+}
+
+/** Like \ref remove_clutter_end with the tables of \a lang.  Chars of a
+ *  pending opener prefix which are removed are added to \a stats. */
+int
+lang_table_end (
+    const struct clutter_lang *lang, unsigned *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data)
+{
+    if (*state >= lang->num_states)
+        return EINVAL;
+
+    const struct lang_action *action = &lang->end_actions[*state];
+    unsigned long long removed[LANG_NUM_REMOVED];
+    for (int cat = 0; cat < LANG_NUM_REMOVED; ++cat)
+        removed[cat] = action->removed[cat];
+    add_removed (stats, 0, removed);
+
+    *state = 0;
+    return action->emit_len ? sink (action->emit, action->emit_len, sink_data) : 0;
+}
+
+/** Strip the \a len chars at \a in like \ref remove_clutter_buf, but as
+ *  code of \a lang.
+ *
+ *  \param lang A language from \ref clutter_lang_find or
+ *      \ref clutter_lang_for_file.  C if \c NULL.
+ *  \param state The lexer state.  Has to be 0 at the start of the input.
+ *  \returns The first nonzero value returned by \a sink or 0.
+ */
+int
+remove_clutter_lang_buf (
+    const struct clutter_lang *lang, const char *in, size_t len,
+    unsigned *state, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    if (lang && !lang->native)
+        return lang_table_buf (lang, in, len, state, stats, sink, sink_data);
+
+    enum clutter_state native_state = (enum clutter_state) *state;
+    int res = remove_clutter_buf (
+        in, len, &native_state, stats, sink, sink_data);
+    *state = native_state;
+    return res;
+}
+
+/** Finish the input processed by \ref remove_clutter_lang_buf: pending
+ *  chars which are code are written to \a sink, those which are removed
+ *  are added to \a stats if it is not \c NULL.
+ *
+ *  \param state Will be reset to 0.
+ *  \returns The value returned by \a sink or 0.
+ */
+int
+remove_clutter_lang_end (
+    const struct clutter_lang *lang, unsigned *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data)
+{
+    if (lang && !lang->native)
+        return lang_table_end (lang, state, stats, sink, sink_data);
+
+    enum clutter_state native_state = (enum clutter_state) *state;
+    *state = 0;
+    return remove_clutter_end (&native_state, sink, sink_data);
+}
+
+/** Like \ref remove_clutter_file, but strip the content of \a istr as
+ *  code of \a lang. */
+int
+remove_clutter_lang_file (
+    const struct clutter_lang *lang, FILE *istr, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data)
+{
+    if (!lang || lang->native)
+        return remove_clutter_file (istr, stats, sink, sink_data);
+
+    char in[LANG_BLOCK_SIZE];
+    unsigned state = 0;
+    int res = 0;
+    size_t len;
+
+    while (!res && (len = fread (in, 1, sizeof (in), istr)) > 0)
+        res = lang_table_buf (lang, in, len, &state, stats, sink, sink_data);
+
+    if (!res && ferror (istr))
+        res = errno ? errno : EIO;
+    if (!res)
+        res = lang_table_end (lang, &state, stats, sink, sink_data);
+
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
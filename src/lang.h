@@ -0,0 +1,119 @@
+/** \file
+ * The transition tables of the languages known to
+ * \ref remove_clutter_lang_buf.
+ *
+ * The tables are generated at build time by gen_lang_tables from the
+ * descriptions of the comments and literals of each language.  A lexer
+ * state is an index into them, so it can be carried from one block of
+ * input to the next like \ref clutter_state.  State 0 is code at the
+ * start of the input.
+ */
+
+#ifndef LANG_H_
+#define LANG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "domaincloud.h"
+#include "word_filter.h"
+
+/** Indices of \ref lang_action::removed. */
+enum lang_removed
+{
+    LANG_REMOVED_COMMENT,
+    LANG_REMOVED_STRING,
+    LANG_REMOVED_WHITE_SPACE,
+    LANG_NUM_REMOVED
+};
+
+/** \struct lang_action
+ *  \brief What the lexer of a \ref clutter_lang does with a byte in a
+ *      state.
+ *
+ *  \var uint16_t lang_action::next
+ *      The state after the byte.
+ *  \var bool lang_action::copy
+ *      Whether the byte is copied after \a emit.
+ *  \var unsigned char lang_action::emit_len
+ *      Number of chars of \a emit.
+ *  \var const char *lang_action::emit
+ *      Text written before the byte, e.g. a pending \c / which turned out
+ *      not to start a comment.
+ *  \var unsigned char lang_action::removed[]
+ *      Number of chars removed by the byte, which may include pending
+ *      chars before it, for each \ref lang_removed.
+ */
+struct lang_action
+{
+    uint16_t next;
+    bool copy;
+    unsigned char emit_len;
+    const char *emit;
+    unsigned char removed[LANG_NUM_REMOVED];
+};
+
+/** \struct clutter_lang
+ *  \brief A language with its compiled lexer.
+ *
+ *  \var const char *clutter_lang::name
+ *      The name given to <tt>--lang</tt>.
+ *  \var const char *const *clutter_lang::extensions
+ *      File name extensions including the dot, terminated by \c NULL.
+ *  \var bool clutter_lang::native
+ *      Whether \ref remove_clutter_buf strips the language.  Its tables
+ *      describe the same lexer and are only used to test them.
+ *  \var const struct word_filter *clutter_lang::keywords
+ *      The keywords, which are not counted as words.
+ *  \var const unsigned char *clutter_lang::classes
+ *      The class of each byte.  Bytes of a class behave alike in all
+ *      states.
+ *  \var const uint16_t *clutter_lang::transitions
+ *      Index of the \ref lang_action in \a actions for each state and
+ *      class, \a num_classes per state.
+ *  \var const struct lang_action *clutter_lang::end_actions
+ *      What is written and removed if the input ends in a state.  The
+ *      \a copy flags are not set.
+ */
+struct clutter_lang
+{
+    const char *name;
+    const char *const *extensions;
+    bool native;
+    const struct word_filter *keywords;
+    unsigned num_states;
+    unsigned num_classes;
+    const unsigned char *classes;
+    const uint16_t *transitions;
+    const struct lang_action *actions;
+    const struct lang_action *end_actions;
+};
+
+extern const struct clutter_lang clutter_langs[];
+extern const int num_clutter_langs;
+
+int lang_table_buf (
+    const struct clutter_lang *lang, const char *in, size_t len,
+    unsigned *state, struct clutter_stats *stats,
+    clutter_sink *sink, void *sink_data);
+int lang_table_end (
+    const struct clutter_lang *lang, unsigned *state,
+    struct clutter_stats *stats, clutter_sink *sink, void *sink_data);
+
+#endif /* not LANG_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
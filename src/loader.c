@@ -0,0 +1,452 @@
+/** \file
+ * A queue of input files which are opened and read by io_uring or by a
+ * pool of threads.  Loads are done in the order they were added. */
+
+#if defined (HAVE_CONFIG_H) && HAVE_CONFIG_H
+    #include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+    #include <liburing.h>
+    #include <sys/sysmacros.h>
+#endif
+
+#include "domaincloud.h"
+#include "loader.h"
+#include "trace.h"
+
+/** Number of threads reading files without io_uring.  They spend their
+ *  time blocked in the kernel, so there are more than processors. */
+#define LOADER_THREADS 8
+
+#ifdef HAVE_LIBURING
+/** Steps of a load in the ring. */
+enum load_step
+{
+    LOAD_OPEN,
+    LOAD_STAT,
+    LOAD_READ,
+    LOAD_CLOSE
+};
+#endif
+
+/** \struct input_load
+ *  \brief A file queued for loading.
+ *
+ *  \var const char *input_load::path
+ *      The file to load.  Owned by the caller.
+ *  \var bool input_load::loaded
+ *      Whether \a input holds the file.  If not, the file is missing,
+ *      not regular, too large or couldn't be read.
+ *  \var bool input_load::done
+ *      Whether the load is finished.  Protected by the lock of
+ *      \a loader.
+ *  \var struct input_load *input_load::next
+ *      The next load in the queue of \a loader.
+ *  \var uint64_t input_load::start
+ *      When the ring began the load, for its trace span.
+ */
+struct input_load
+{
+    struct input_loader *loader;
+    const char *path;
+    struct loaded_input input;
+    bool loaded;
+    bool done;
+    struct input_load *next;
+#ifdef HAVE_LIBURING
+    enum load_step step;
+    int fd;
+    struct statx statx;
+    uint64_t start;
+#endif
+};
+
+/** \struct input_loader
+ *  \brief The queue of loads and the threads working on it.  All members
+ *      after \a lock are protected by it.
+ *
+ *  \var bool input_loader::uring
+ *      Whether \a ring is used by a single thread instead of blocking
+ *      reads on all threads.
+ *  \var struct input_load *input_loader::pending
+ *      The loads no thread has taken yet, oldest first.
+ */
+struct input_loader
+{
+    bool uring;
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+#endif
+    pthread_t threads[LOADER_THREADS];
+    int num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t pending_added;
+    pthread_cond_t load_done;
+    struct input_load *pending;
+    struct input_load **pending_tail;
+    bool stopping;
+};
+
+/** Remove the oldest pending load from \a loader.  Has to be called with
+ *  the lock held. */
+static struct input_load *
+take_pending (struct input_loader *loader)
+{
+    struct input_load *load = loader->pending;
+    loader->pending = load->next;
+    if (!loader->pending)
+        loader->pending_tail = &loader->pending;
+    load->next = NULL;
+    return load;
+}
+
+/** Open and read the file of \a load with blocking calls.  Pipes aren't
+ *  waited for, they are left to the caller. */
+static void
+read_input (struct input_load *load)
+{
+    uint64_t start = trace_begin ();
+    int fd = open (load->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat *file_stat = &load->input.stat;
+    if (!fstat (fd, file_stat) && S_ISREG (file_stat->st_mode)
+        && file_stat->st_size <= INPUT_LOADER_MAX_SIZE
+        && !input_buf_read (fd, (size_t) file_stat->st_size, &load->input.buf))
+        load->loaded = true;
+    close (fd);
+
+    trace_end ("load_input", start, load->input.buf.len, load->path);
+}
+
+/** Thread function: load files until \a loader_arg stops. */
+static void *
+read_worker (void *loader_arg)
+{
+    struct input_loader *loader = loader_arg;
+
+    pthread_mutex_lock (&loader->lock);
+    for (;;)
+    {
+        if (!loader->pending)
+        {
+            if (loader->stopping)
+                break;
+            pthread_cond_wait (&loader->pending_added, &loader->lock);
+            continue;
+        }
+
+        struct input_load *load = take_pending (loader);
+        pthread_mutex_unlock (&loader->lock);
+
+        read_input (load);
+
+        pthread_mutex_lock (&loader->lock);
+        load->done = true;
+        pthread_cond_broadcast (&loader->load_done);
+    }
+    pthread_mutex_unlock (&loader->lock);
+
+    return NULL;
+}
+
+#ifdef HAVE_LIBURING
+/** Queue the open of the file of \a load in the ring of \a loader. */
+static void
+uring_open (struct input_loader *loader, struct input_load *load)
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe (&loader->ring);
+    io_uring_prep_openat (
+        sqe, AT_FDCWD, load->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC, 0);
+    io_uring_sqe_set_data (sqe, load);
+    load->step = LOAD_OPEN;
+    load->start = trace_begin ();
+}
+
+/** Queue the next step of \a load in the ring of \a loader after its
+ *  last step returned \a res.
+ *
+ *  \returns Whether \a load is done.
+ */
+static bool
+uring_advance (struct input_loader *loader, struct input_load *load, int res)
+{
+    if (load->step == LOAD_CLOSE || (load->step == LOAD_OPEN && res < 0))
+    {
+        trace_end ("load_input", load->start, load->input.buf.len, load->path);
+        return true;
+    }
+
+    struct io_uring_sqe *sqe = io_uring_get_sqe (&loader->ring);
+    const struct statx *sx = &load->statx;
+    char *data;
+    if (load->step == LOAD_OPEN)
+    {
+        load->fd = res;
+        io_uring_prep_statx (
+            sqe, load->fd, "", AT_EMPTY_PATH, STATX_BASIC_STATS,
+            &load->statx);
+        load->step = LOAD_STAT;
+    }
+    else if (load->step == LOAD_STAT && !res && S_ISREG (sx->stx_mode)
+             && sx->stx_size <= INPUT_LOADER_MAX_SIZE
+             && (data = malloc (sx->stx_size + 1)))
+    {
+        struct stat *file_stat = &load->input.stat;
+        file_stat->st_dev = makedev (sx->stx_dev_major, sx->stx_dev_minor);
+        file_stat->st_ino = sx->stx_ino;
+        file_stat->st_mode = sx->stx_mode;
+        file_stat->st_size = (off_t) sx->stx_size;
+        file_stat->st_mtim.tv_sec = sx->stx_mtime.tv_sec;
+        file_stat->st_mtim.tv_nsec = sx->stx_mtime.tv_nsec;
+        file_stat->st_ctim.tv_sec = sx->stx_ctime.tv_sec;
+        file_stat->st_ctim.tv_nsec = sx->stx_ctime.tv_nsec;
+
+        load->input.buf.data = data;
+        io_uring_prep_read (
+            sqe, load->fd, data, (unsigned) sx->stx_size, 0);
+        load->step = LOAD_READ;
+    }
+    else
+    {
+        /* A short read leaves the file to the caller. */
+        if (load->step == LOAD_READ && (uint64_t) res == sx->stx_size)
+        {
+            load->input.buf.len = (size_t) res;
+            load->loaded = true;
+        }
+        else if (load->step == LOAD_READ)
+        {
+            free ((void *) load->input.buf.data);
+            load->input.buf.data = NULL;
+        }
+        io_uring_prep_close (sqe, load->fd);
+        load->step = LOAD_CLOSE;
+    }
+
+    io_uring_sqe_set_data (sqe, load);
+    return false;
+}
+
+/** Thread function: keep up to \ref INPUT_LOADER_DEPTH loads in the ring
+ *  of \a loader_arg until it stops. */
+static void *
+uring_worker (void *loader_arg)
+{
+    struct input_loader *loader = loader_arg;
+    unsigned in_flight = 0;
+
+    pthread_mutex_lock (&loader->lock);
+    for (;;)
+    {
+        /* Each load has one operation in the ring at a time. */
+        while (loader->pending && in_flight < INPUT_LOADER_DEPTH)
+        {
+            uring_open (loader, take_pending (loader));
+            ++in_flight;
+        }
+        if (!in_flight)
+        {
+            if (loader->stopping)
+                break;
+            pthread_cond_wait (&loader->pending_added, &loader->lock);
+            continue;
+        }
+        pthread_mutex_unlock (&loader->lock);
+
+        struct input_load *done = NULL;
+        if (io_uring_submit_and_wait (&loader->ring, 1) >= 0)
+        {
+            struct io_uring_cqe *cqe;
+            unsigned head;
+            unsigned seen = 0;
+            io_uring_for_each_cqe (&loader->ring, head, cqe)
+            {
+                struct input_load *load = io_uring_cqe_get_data (cqe);
+                if (uring_advance (loader, load, cqe->res))
+                {
+                    load->next = done;
+                    done = load;
+                    --in_flight;
+                }
+                ++seen;
+            }
+            io_uring_cq_advance (&loader->ring, seen);
+        }
+
+        pthread_mutex_lock (&loader->lock);
+        while (done)
+        {
+            struct input_load *next = done->next;
+            done->done = true;
+            done = next;
+        }
+        pthread_cond_broadcast (&loader->load_done);
+    }
+    pthread_mutex_unlock (&loader->lock);
+
+    return NULL;
+}
+#endif
+
+/** Whether the input file \a path is left to the caller: \c "-" for the
+ *  standard input and tables of word counts, which are read by
+ *  \ref word_counts_read_table. */
+bool
+input_loader_skips (const char *path)
+{
+    size_t len = strlen (path);
+    return !strcmp (path, "-")
+        || (len > strlen (TABLE_SUFFIX)
+            && !strcmp (path + len - strlen (TABLE_SUFFIX), TABLE_SUFFIX));
+}
+
+/** Start a new loader with its threads.  If liburing is available and
+ *  the kernel supports io_uring, a single thread drives a ring.
+ *
+ *  \returns The loader or \c NULL if out of memory or threads.  Release
+ *      with \ref input_loader_free.
+ */
+struct input_loader *
+input_loader_new (void)
+{
+    struct input_loader *loader = calloc (1, sizeof (*loader));
+    if (!loader)
+        return NULL;
+
+    pthread_mutex_init (&loader->lock, NULL);
+    pthread_cond_init (&loader->pending_added, NULL);
+    pthread_cond_init (&loader->load_done, NULL);
+    loader->pending_tail = &loader->pending;
+
+    void *(*worker) (void *) = read_worker;
+#ifdef HAVE_LIBURING
+    loader->uring = !io_uring_queue_init (INPUT_LOADER_DEPTH, &loader->ring, 0);
+    if (loader->uring)
+        worker = uring_worker;
+#endif
+
+    int num_threads = loader->uring ? 1 : LOADER_THREADS;
+    for (; loader->num_threads < num_threads; ++loader->num_threads)
+        if (pthread_create (
+                &loader->threads[loader->num_threads], NULL, worker, loader))
+            break;
+
+    if (!loader->num_threads)
+    {
+        input_loader_free (loader);
+        return NULL;
+    }
+    return loader;
+}
+
+/** Stop the threads of \a loader and free it.  All its loads have to be
+ *  released before.  Does nothing if \a loader is \c NULL. */
+void
+input_loader_free (struct input_loader *loader)
+{
+    if (!loader)
+        return;
+
+    pthread_mutex_lock (&loader->lock);
+    loader->stopping = true;
+    pthread_cond_broadcast (&loader->pending_added);
+    pthread_mutex_unlock (&loader->lock);
+
+    for (int thread = 0; thread < loader->num_threads; ++thread)
+        pthread_join (loader->threads[thread], NULL);
+
+#ifdef HAVE_LIBURING
+    if (loader->uring)
+        io_uring_queue_exit (&loader->ring);
+#endif
+    pthread_cond_destroy (&loader->load_done);
+    pthread_cond_destroy (&loader->pending_added);
+    pthread_mutex_destroy (&loader->lock);
+    free (loader);
+}
+
+/** Queue the load of the file at \a path in \a loader.  \a path has to
+ *  stay valid until the load is released.
+ *
+ *  \returns The load or \c NULL if \a loader is \c NULL or out of memory.
+ *      Release with \ref input_load_release.
+ */
+struct input_load *
+input_loader_add (struct input_loader *loader, const char *path)
+{
+    if (!loader)
+        return NULL;
+
+    struct input_load *load = calloc (1, sizeof (*load));
+    if (!load)
+        return NULL;
+    load->loader = loader;
+    load->path = path;
+
+    pthread_mutex_lock (&loader->lock);
+    *loader->pending_tail = load;
+    loader->pending_tail = &load->next;
+    pthread_cond_signal (&loader->pending_added);
+    pthread_mutex_unlock (&loader->lock);
+
+    return load;
+}
+
+/** Wait until \a load is finished.
+ *
+ *  \returns The loaded file, which stays valid until \a load is released,
+ *      or \c NULL if the caller has to open the file itself.
+ */
+const struct loaded_input *
+input_load_wait (struct input_load *load)
+{
+    struct input_loader *loader = load->loader;
+
+    pthread_mutex_lock (&loader->lock);
+    while (!load->done)
+        pthread_cond_wait (&loader->load_done, &loader->lock);
+    pthread_mutex_unlock (&loader->lock);
+
+    return load->loaded ? &load->input : NULL;
+}
+
+/** Wait for \a load and free it with its content.  Does nothing if
+ *  \a load is \c NULL. */
+void
+input_load_release (struct input_load *load)
+{
+    if (!load)
+        return;
+
+    if (input_load_wait (load))
+        input_buf_release (&load->input.buf);
+    free (load);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,67 @@
+/** \file
+ * Read small input files ahead of the threads which strip them.
+ *
+ * Opening and reading many small files costs more system calls than
+ * stripping them costs time, so the loads are queued and run on their
+ * own: with io_uring if domaincloud is built with liburing, else on a
+ * pool of threads doing blocking reads.  The caller keeps up to
+ * \ref INPUT_LOADER_DEPTH loads in flight and takes the content of each
+ * file once it gets to it.
+ */
+
+#ifndef LOADER_H_
+#define LOADER_H_
+
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "input.h"
+
+/** The number of loads a caller should keep in flight. */
+#define INPUT_LOADER_DEPTH 64
+
+/** Files larger than this are left to the caller, which maps them. */
+#define INPUT_LOADER_MAX_SIZE (256 * 1024)
+
+/** \struct loaded_input
+ *  \brief A regular file read by an \ref input_loader.
+ *
+ *  \var struct input_buf loaded_input::buf
+ *      The content of the file.
+ *  \var struct stat loaded_input::stat
+ *      The status of the file when it was opened.
+ */
+struct loaded_input
+{
+    struct input_buf buf;
+    struct stat stat;
+};
+
+struct input_loader;
+struct input_load;
+
+bool input_loader_skips (const char *path);
+struct input_loader *input_loader_new (void);
+void input_loader_free (struct input_loader *loader);
+struct input_load *input_loader_add (
+    struct input_loader *loader, const char *path);
+const struct loaded_input *input_load_wait (struct input_load *load);
+void input_load_release (struct input_load *load);
+
+#endif /* not LOADER_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,310 @@
+/** \file
+ * A minimal PNG writer.
+ *
+ * The image data is compressed with a single deflate block using the
+ * fixed Huffman codes.  Matches are only searched one pixel to the left and
+ * one row above, which is enough for the large single colored areas of a
+ * word cloud. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "png.h"
+
+/** Bytes per pixel of an RGB image. */
+#define PNG_PIXEL_SIZE 3
+
+/** Longest and shortest match of deflate. */
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_MIN_MATCH 3
+/** Farthest match of deflate. */
+#define DEFLATE_MAX_DISTANCE 32768
+
+/** \struct byte_buffer
+ *  \brief A growable array of bytes with a bit writer for deflate.
+ *
+ *  \var uint32_t byte_buffer::bits
+ *      Bits which don't fill a byte yet, the first in the lowest bit.
+ *  \var bool byte_buffer::failed
+ *      Whether an allocation failed.
+ */
+struct byte_buffer
+{
+    unsigned char *data;
+    size_t len;
+    size_t size;
+    uint32_t bits;
+    int num_bits;
+    bool failed;
+};
+
+static void
+put_byte (struct byte_buffer *buf, unsigned char byte)
+{
+    if (buf->len == buf->size)
+    {
+        size_t size = buf->size ? 2 * buf->size : 64 * 1024;
+        unsigned char *data = realloc (buf->data, size);
+        if (!data)
+        {
+            buf->failed = true;
+            return;
+        }
+        buf->data = data;
+        buf->size = size;
+    }
+
+    buf->data[buf->len++] = byte;
+}
+
+static void
+put_u32 (struct byte_buffer *buf, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        put_byte (buf, (unsigned char) (value >> shift));
+}
+
+/** Append the \a num_bits lowest bits of \a value, the lowest first. */
+static void
+put_bits (struct byte_buffer *buf, uint32_t value, int num_bits)
+{
+    buf->bits |= value << buf->num_bits;
+    buf->num_bits += num_bits;
+    while (buf->num_bits >= 8)
+    {
+        put_byte (buf, (unsigned char) buf->bits);
+        buf->bits >>= 8;
+        buf->num_bits -= 8;
+    }
+}
+
+/** Append the Huffman \a code of \a len bits, the highest bit first. */
+static void
+put_code (struct byte_buffer *buf, uint32_t code, int len)
+{
+    uint32_t reversed = 0;
+    for (int bit = 0; bit < len; ++bit)
+        reversed |= ((code >> bit) & 1u) << (len - 1 - bit);
+    put_bits (buf, reversed, len);
+}
+
+/** Append the fixed Huffman code of the literal or length \a symbol. */
+static void
+put_symbol (struct byte_buffer *buf, unsigned symbol)
+{
+    if (symbol < 144)
+        put_code (buf, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        put_code (buf, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        put_code (buf, symbol - 256, 7);
+    else
+        put_code (buf, 0xc0 + symbol - 280, 8);
+}
+
+/** Append a match of \a len bytes \a distance bytes back. */
+static void
+put_match (struct byte_buffer *buf, unsigned len, unsigned distance)
+{
+    static const unsigned short len_base[] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const unsigned char len_extra[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const unsigned short dist_base[] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577};
+    static const unsigned char dist_extra[] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    int code = sizeof (len_base) / sizeof (*len_base) - 1;
+    while (len_base[code] > len)
+        --code;
+    put_symbol (buf, 257 + (unsigned) code);
+    put_bits (buf, len - len_base[code], len_extra[code]);
+
+    code = sizeof (dist_base) / sizeof (*dist_base) - 1;
+    while (dist_base[code] > distance)
+        --code;
+    put_code (buf, (uint32_t) code, 5);
+    put_bits (buf, distance - dist_base[code], dist_extra[code]);
+}
+
+/** Length of the match of \a data at \a pos with the bytes \a distance
+ *  before, at most \a max_len. */
+static unsigned
+match_len (
+    const unsigned char *data, size_t pos, size_t distance, size_t max_len)
+{
+    if (distance > pos || distance > DEFLATE_MAX_DISTANCE)
+        return 0;
+
+    size_t len = 0;
+    while (len < max_len && data[pos + len] == data[pos + len - distance])
+        ++len;
+    return (unsigned) len;
+}
+
+/** Append the zlib stream of the \a len bytes of \a data. */
+static void
+put_zlib (
+    struct byte_buffer *buf, const unsigned char *data, size_t len,
+    size_t row_len)
+{
+    /* Deflate with a 32 KiB window, no preset dictionary. */
+    put_byte (buf, 0x78);
+    put_byte (buf, 0x01);
+
+    put_bits (buf, 1, 1);   /* Last block. */
+    put_bits (buf, 1, 2);   /* Fixed Huffman codes. */
+
+    size_t pos = 0;
+    while (pos < len)
+    {
+        size_t max_len = len - pos;
+        if (max_len > DEFLATE_MAX_MATCH)
+            max_len = DEFLATE_MAX_MATCH;
+
+        unsigned pixel_match = match_len (data, pos, PNG_PIXEL_SIZE, max_len);
+        unsigned row_match = match_len (data, pos, row_len, max_len);
+        unsigned best = pixel_match > row_match ? pixel_match : row_match;
+
+        if (best >= DEFLATE_MIN_MATCH)
+        {
+            put_match (
+                buf, best, pixel_match >= row_match ? PNG_PIXEL_SIZE : (unsigned) row_len);
+            pos += best;
+        }
+        else
+            put_symbol (buf, data[pos++]);
+    }
+
+    put_symbol (buf, 256);  /* End of block. */
+    if (buf->num_bits)
+        put_bits (buf, 0, 8 - buf->num_bits);
+
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        a = (a + data[pos]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32 (buf, (b << 16) | a);
+}
+
+/** Update the CRC-32 as used by PNG \a crc with the \a len bytes of
+ *  \a data.  Start with \c 0. */
+static uint32_t
+update_crc (uint32_t crc, const unsigned char *data, size_t len)
+{
+    crc ^= 0xffffffffu;
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        crc ^= data[pos];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1u));
+    }
+    return crc ^ 0xffffffffu;
+}
+
+/** Write a PNG chunk of \a type with the \a len bytes of \a data. */
+static void
+write_chunk (
+    FILE *ostr, const char *type, const unsigned char *data, size_t len)
+{
+    unsigned char header[8] = {
+        (unsigned char) (len >> 24), (unsigned char) (len >> 16),
+        (unsigned char) (len >> 8), (unsigned char) len};
+    memcpy (header + 4, type, 4);
+
+    /* The CRC covers the type and the data. */
+    uint32_t crc = update_crc (0, header + 4, 4);
+    if (len)
+        crc = update_crc (crc, data, len);
+    unsigned char trailer[4] = {
+        (unsigned char) (crc >> 24), (unsigned char) (crc >> 16),
+        (unsigned char) (crc >> 8), (unsigned char) crc};
+
+    fwrite (header, 1, sizeof (header), ostr);
+    if (len)
+        fwrite (data, 1, len, ostr);
+    fwrite (trailer, 1, sizeof (trailer), ostr);
+}
+
+/** Write the RGB image \a pixels with \a width times \a height pixels as
+ *  PNG to \a ostr.  The pixels are stored row by row with three bytes per
+ *  pixel.
+ *
+ *  \returns \a errno if some I/O error occurred, \c ENOMEM if out of
+ *      memory else 0.
+ */
+int
+png_write_rgb (
+    FILE *ostr, const unsigned char *pixels, unsigned width, unsigned height)
+{
+    /* Each row starts with the filter type 0 (none). */
+    size_t row_len = 1 + (size_t) width * PNG_PIXEL_SIZE;
+    size_t raw_len = row_len * height;
+    unsigned char *raw = malloc (raw_len ? raw_len : 1);
+    if (!raw)
+        return ENOMEM;
+
+    for (size_t row = 0; row < height; ++row)
+    {
+        raw[row * row_len] = 0;
+        memcpy (
+            raw + row * row_len + 1, pixels + row * (row_len - 1), row_len - 1);
+    }
+
+    struct byte_buffer idat = {0};
+    put_zlib (&idat, raw, raw_len, row_len);
+    free (raw);
+    if (idat.failed)
+    {
+        free (idat.data);
+        return ENOMEM;
+    }
+
+    static const unsigned char signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    unsigned char ihdr[13] = {
+        (unsigned char) (width >> 24), (unsigned char) (width >> 16),
+        (unsigned char) (width >> 8), (unsigned char) width,
+        (unsigned char) (height >> 24), (unsigned char) (height >> 16),
+        (unsigned char) (height >> 8), (unsigned char) height,
+        8,      /* Bit depth. */
+        2,      /* Color type: RGB. */
+        0, 0, 0 /* Compression, filter and interlace methods. */};
+
+    fwrite (signature, 1, sizeof (signature), ostr);
+    write_chunk (ostr, "IHDR", ihdr, sizeof (ihdr));
+    write_chunk (ostr, "IDAT", idat.data, idat.len);
+    write_chunk (ostr, "IEND", NULL, 0);
+    free (idat.data);
+
+    if (fflush (ostr) || ferror (ostr))
+        return errno ? errno : EIO;
+    return 0;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,28 @@
+/** \file
+ * Write RGB images in the PNG format. */
+
+#ifndef PNG_H_
+#define PNG_H_
+
+#include <stdio.h>
+
+int png_write_rgb (
+    FILE *ostr, const unsigned char *pixels, unsigned width, unsigned height);
+
+#endif /* not PNG_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
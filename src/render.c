@@ -0,0 +1,323 @@
+/** \file
+ * Lay out words on a canvas with sizes by their frequency and save the
+ * picture as PNG.
+ *
+ * The words are placed from the most frequent to the least frequent one
+ * along a spiral starting in the center.  Whether a place is free is
+ * looked up in an integral image (summed area table) of the used pixels,
+ * so each check costs four reads regardless of the size of the word. */
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "font.h"
+#include "png.h"
+
+/** The most frequent word is at most this fraction of the height high. */
+#define CLOUD_MAX_WORD_HEIGHT 0.25
+/** The most frequent word is at most this fraction of the width wide. */
+#define CLOUD_MAX_WORD_WIDTH 0.9
+/** Influence of the frequency on the size of a word relative to the size
+ *  of the word before it.  0 gives all words the same size. */
+#define CLOUD_RELATIVE_SCALING 0.5
+
+/** A point on the search spiral relative to its center. */
+struct spiral_point
+{
+    int x;
+    int y;
+};
+
+/** \struct canvas
+ *  \brief The picture of the word cloud.
+ *
+ *  \var unsigned char *canvas::pixels
+ *      RGB values of the pixels row by row.
+ *  \var unsigned char *canvas::used
+ *      For each pixel 1 if it is covered by a word or its margin else 0.
+ *  \var uint32_t *canvas::integral
+ *      \a width + 1 times \a height + 1 sums of \a used: the entry at
+ *      (x, y) is the sum of all pixels left of x and above y.
+ *  \var struct spiral_point *canvas::spiral
+ *      The offsets from the center at which places for words are tried.
+ */
+struct canvas
+{
+    unsigned width;
+    unsigned height;
+    unsigned char *pixels;
+    unsigned char *used;
+    uint32_t *integral;
+    struct spiral_point *spiral;
+    size_t spiral_len;
+};
+
+/** Colors of the words on the black background. */
+static const unsigned char palette[][3] = {
+    {0xfd, 0xe7, 0x25}, {0x5e, 0xc9, 0x62}, {0x21, 0x91, 0x8c},
+    {0x3b, 0x8b, 0xc2}, {0xad, 0xdc, 0x30}, {0x28, 0xae, 0x80},
+    {0xe0, 0x6c, 0x4c}, {0xc0, 0x7c, 0xd8}};
+
+/** The number of used pixels in the rectangle at \a x, \a y with \a width
+ *  and \a height. */
+static uint32_t
+used_pixels (
+    const struct canvas *canvas, unsigned x, unsigned y,
+    unsigned width, unsigned height)
+{
+    size_t stride = canvas->width + 1;
+    const uint32_t *top = canvas->integral + y * stride;
+    const uint32_t *bottom = canvas->integral + (y + height) * stride;
+
+    return bottom[x + width] - bottom[x] - top[x + width] + top[x];
+}
+
+/** Recompute the integral image of \a canvas from row \a first_row on. */
+static void
+update_integral (struct canvas *canvas, unsigned first_row)
+{
+    size_t stride = canvas->width + 1;
+    for (unsigned y = first_row; y < canvas->height; ++y)
+    {
+        const unsigned char *used = canvas->used + (size_t) y * canvas->width;
+        const uint32_t *above = canvas->integral + y * stride;
+        uint32_t *row = canvas->integral + (y + 1) * stride;
+        uint32_t row_sum = 0;
+
+        for (unsigned x = 0; x < canvas->width; ++x)
+        {
+            row_sum += used[x];
+            row[x + 1] = above[x + 1] + row_sum;
+        }
+    }
+}
+
+/** Compute the points of a spiral from the center of \a canvas outwards
+ *  until it leaves the canvas.  The turns are about 4 pixels apart and the
+ *  points on it about 2 pixels; points which round to the one before are
+ *  left out.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+make_spiral (struct canvas *canvas)
+{
+    double aspect = (double) canvas->width / canvas->height;
+    /* Once the radius reaches the corners the spiral is off the canvas. */
+    double max_radius = hypot (canvas->width / aspect, canvas->height) / 2 + 1;
+    size_t capacity = 1024;
+
+    canvas->spiral = malloc (capacity * sizeof (*canvas->spiral));
+    if (!canvas->spiral)
+        return ENOMEM;
+
+    canvas->spiral_len = 0;
+    for (double angle = 0, radius = 0; radius < max_radius;
+         angle += 2.0 / (radius + 1), radius = angle * 4 / (2 * M_PI))
+    {
+        struct spiral_point point = {
+            (int) lround (radius * aspect * cos (angle)),
+            (int) lround (radius * sin (angle))};
+        if (canvas->spiral_len > 0
+            && canvas->spiral[canvas->spiral_len - 1].x == point.x
+            && canvas->spiral[canvas->spiral_len - 1].y == point.y)
+            continue;
+
+        if (canvas->spiral_len == capacity)
+        {
+            struct spiral_point *grown = realloc (
+                canvas->spiral, 2 * capacity * sizeof (*canvas->spiral));
+            if (!grown)
+                return ENOMEM;
+            canvas->spiral = grown;
+            capacity *= 2;
+        }
+        canvas->spiral[canvas->spiral_len++] = point;
+    }
+
+    return 0;
+}
+
+/** Find a free rectangle of \a width and \a height on \a canvas.  The
+ *  search follows the spiral of \a canvas from the center outwards.
+ *
+ *  \returns Whether a place was found.  Its top left corner is put into
+ *      \a x and \a y.
+ */
+static bool
+find_place (
+    const struct canvas *canvas, unsigned width, unsigned height,
+    unsigned *x, unsigned *y)
+{
+    if (width > canvas->width || height > canvas->height)
+        return false;
+
+    int center_x = (int) (canvas->width - width) / 2;
+    int center_y = (int) (canvas->height - height) / 2;
+    int max_x = (int) (canvas->width - width);
+    int max_y = (int) (canvas->height - height);
+
+    for (size_t point = 0; point < canvas->spiral_len; ++point)
+    {
+        int left = center_x + canvas->spiral[point].x;
+        int top = center_y + canvas->spiral[point].y;
+        if (left < 0 || top < 0 || left > max_x || top > max_y)
+            continue;
+
+        if (!used_pixels (canvas, (unsigned) left, (unsigned) top, width, height))
+        {
+            *x = (unsigned) left;
+            *y = (unsigned) top;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Draw the \a len chars of \a word with glyphs enlarged by \a scale at
+ *  \a x, \a y in \a color.  Mark the area of the word and a \a margin
+ *  around it as used. */
+static void
+draw_word (
+    struct canvas *canvas, const char *word, size_t len, unsigned scale,
+    unsigned margin, unsigned x, unsigned y, const unsigned char color[3])
+{
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        const unsigned char *glyph = font_glyph (word[pos]);
+        unsigned glyph_x = x + margin + (unsigned) pos * GLYPH_ADVANCE * scale;
+
+        for (unsigned row = 0; row < GLYPH_HEIGHT * scale; ++row)
+        {
+            unsigned char bits = glyph[row / scale];
+            unsigned char *pixel = canvas->pixels
+                + 3 * ((size_t) (y + margin + row) * canvas->width + glyph_x);
+
+            for (unsigned col = 0; col < GLYPH_WIDTH * scale; ++col, pixel += 3)
+                if (bits & (0x10 >> (col / scale)))
+                    memcpy (pixel, color, 3);
+        }
+    }
+
+    unsigned width = (GLYPH_ADVANCE * (unsigned) len - 1) * scale + 2 * margin;
+    unsigned height = GLYPH_HEIGHT * scale + 2 * margin;
+    for (unsigned row = y; row < y + height; ++row)
+        memset (canvas->used + (size_t) row * canvas->width + x, 1, width);
+
+    update_integral (canvas, y);
+}
+
+/** Pick the color of \a word from \ref palette. */
+static const unsigned char *
+word_color (const char *word, size_t len)
+{
+    unsigned hash = 0;
+    for (size_t pos = 0; pos < len; ++pos)
+        hash = hash * 31 + (unsigned char) word[pos];
+
+    return palette[hash % (sizeof (palette) / sizeof (*palette))];
+}
+
+/** Place the \a len chars of \a word on \a canvas at the largest scale up to
+ *  \a scale for which there is room.
+ *
+ *  \returns The scale of the placed word or 0 if it didn't fit.
+ */
+static unsigned
+place_word (
+    struct canvas *canvas, const char *word, size_t len, unsigned scale)
+{
+    for (; scale > 0; --scale)
+    {
+        unsigned margin = scale * 3 / 2 + 1;
+        unsigned width = (GLYPH_ADVANCE * (unsigned) len - 1) * scale + 2 * margin;
+        unsigned height = GLYPH_HEIGHT * scale + 2 * margin;
+        unsigned x, y;
+
+        if (find_place (canvas, width, height, &x, &y))
+        {
+            draw_word (
+                canvas, word, len, scale, margin, x, y, word_color (word, len));
+            return scale;
+        }
+    }
+
+    return 0;
+}
+
+/** Render the \a num_words \a words as word cloud of \a width times
+ *  \a height pixels and write it as PNG image to \a ostr.
+ *
+ *  \param words The words sorted by descending count, like the result of
+ *      \ref word_counts_sorted.
+ *  \returns \a errno if some I/O error occurred, \c ENOMEM if out of
+ *      memory else 0.
+ */
+int
+render_word_cloud (
+    const struct word_count *words, size_t num_words,
+    unsigned width, unsigned height, FILE *ostr)
+{
+    size_t num_pixels = (size_t) width * height;
+    struct canvas canvas = {
+        width, height,
+        calloc (num_pixels ? num_pixels : 1, 3),
+        calloc (num_pixels ? num_pixels : 1, 1),
+        calloc (((size_t) width + 1) * (height + 1), sizeof (uint32_t)),
+        NULL, 0};
+
+    int res = ENOMEM;
+    if (canvas.pixels && canvas.used && canvas.integral
+        && (num_pixels == 0 || !make_spiral (&canvas)))
+    {
+        double size = CLOUD_MAX_WORD_HEIGHT * height / GLYPH_HEIGHT;
+        for (size_t word = 0; word < num_words; ++word)
+        {
+            const struct word_count *cur = &words[word];
+            if (word > 0)
+                size *= CLOUD_RELATIVE_SCALING * cur->count / words[word - 1].count
+                    + (1 - CLOUD_RELATIVE_SCALING);
+
+            double max_size = CLOUD_MAX_WORD_WIDTH * width
+                / (GLYPH_ADVANCE * (double) cur->len);
+            long scale = lround (size < max_size ? size : max_size);
+            if (scale < 1)
+                scale = 1;
+
+            unsigned placed = place_word (
+                &canvas, cur->word, cur->len, (unsigned) scale);
+            if (placed)
+                size = placed;
+        }
+
+        res = png_write_rgb (ostr, canvas.pixels, width, height);
+    }
+
+    free (canvas.spiral);
+    free (canvas.integral);
+    free (canvas.used);
+    free (canvas.pixels);
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
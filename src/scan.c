@@ -0,0 +1,291 @@
+/** \file
+ * Scalar, SSE2 and AVX2 kernels for the char search of the lexer. */
+
+#include <stdint.h>
+
+#include "char_class.h"
+#include "scan.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+    #define SCAN_X86 1
+    #include <immintrin.h>
+#else
+    #define SCAN_X86 0
+#endif
+
+/** \struct scan_kernels
+ *  \brief The implementations of the scan functions for one instruction
+ *      set.  All return the position of the first match or \a end.
+ */
+struct scan_kernels
+{
+    const char *(*find_char) (const char *pos, const char *end, char c);
+    const char *(*find_char2) (
+        const char *pos, const char *end, char c1, char c2);
+    const char *(*find_non_space) (const char *pos, const char *end);
+};
+
+static const char *
+find_char_scalar (const char *pos, const char *end, char c)
+{
+    while (pos < end && *pos != c)
+        ++pos;
+    return pos;
+}
+
+static const char *
+find_char2_scalar (const char *pos, const char *end, char c1, char c2)
+{
+    while (pos < end && *pos != c1 && *pos != c2)
+        ++pos;
+    return pos;
+}
+
+static const char *
+find_non_space_scalar (const char *pos, const char *end)
+{
+    while (pos < end && char_is (*pos, CHAR_SPACE))
+        ++pos;
+    return pos;
+}
+
+#if SCAN_X86
+
+/* Inside the loops \c mask has a bit set for each matching char. */
+
+__attribute__ ((target ("sse2")))
+static inline __m128i
+space_mask_sse2 (__m128i chars)
+{
+    __m128i from_tab = _mm_sub_epi8 (chars, _mm_set1_epi8 ('\t'));
+    __m128i upto_cr = _mm_cmpeq_epi8 (
+        _mm_min_epu8 (from_tab, _mm_set1_epi8 ('\r' - '\t')), from_tab);
+    return _mm_or_si128 (upto_cr, _mm_cmpeq_epi8 (chars, _mm_set1_epi8 (' ')));
+}
+
+__attribute__ ((target ("sse2")))
+static const char *
+find_char_sse2 (const char *pos, const char *end, char c)
+{
+    __m128i vc = _mm_set1_epi8 (c);
+    for (; end - pos >= 16; pos += 16)
+    {
+        __m128i chars = _mm_loadu_si128 ((const __m128i *) pos);
+        unsigned mask = (unsigned) _mm_movemask_epi8 (_mm_cmpeq_epi8 (chars, vc));
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_char_scalar (pos, end, c);
+}
+
+__attribute__ ((target ("sse2")))
+static const char *
+find_char2_sse2 (const char *pos, const char *end, char c1, char c2)
+{
+    __m128i vc1 = _mm_set1_epi8 (c1);
+    __m128i vc2 = _mm_set1_epi8 (c2);
+    for (; end - pos >= 16; pos += 16)
+    {
+        __m128i chars = _mm_loadu_si128 ((const __m128i *) pos);
+        unsigned mask = (unsigned) _mm_movemask_epi8 (_mm_or_si128 (
+            _mm_cmpeq_epi8 (chars, vc1), _mm_cmpeq_epi8 (chars, vc2)));
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_char2_scalar (pos, end, c1, c2);
+}
+
+__attribute__ ((target ("sse2")))
+static const char *
+find_non_space_sse2 (const char *pos, const char *end)
+{
+    for (; end - pos >= 16; pos += 16)
+    {
+        __m128i chars = _mm_loadu_si128 ((const __m128i *) pos);
+        unsigned mask =
+            ~(unsigned) _mm_movemask_epi8 (space_mask_sse2 (chars)) & 0xffff;
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_non_space_scalar (pos, end);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+space_mask_avx2 (__m256i chars)
+{
+    __m256i from_tab = _mm256_sub_epi8 (chars, _mm256_set1_epi8 ('\t'));
+    __m256i upto_cr = _mm256_cmpeq_epi8 (
+        _mm256_min_epu8 (from_tab, _mm256_set1_epi8 ('\r' - '\t')), from_tab);
+    return _mm256_or_si256 (
+        upto_cr, _mm256_cmpeq_epi8 (chars, _mm256_set1_epi8 (' ')));
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+find_char_avx2 (const char *pos, const char *end, char c)
+{
+    __m256i vc = _mm256_set1_epi8 (c);
+    for (; end - pos >= 32; pos += 32)
+    {
+        __m256i chars = _mm256_loadu_si256 ((const __m256i *) pos);
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8 (
+            _mm256_cmpeq_epi8 (chars, vc));
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_char_sse2 (pos, end, c);
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+find_char2_avx2 (const char *pos, const char *end, char c1, char c2)
+{
+    __m256i vc1 = _mm256_set1_epi8 (c1);
+    __m256i vc2 = _mm256_set1_epi8 (c2);
+    for (; end - pos >= 32; pos += 32)
+    {
+        __m256i chars = _mm256_loadu_si256 ((const __m256i *) pos);
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8 (_mm256_or_si256 (
+            _mm256_cmpeq_epi8 (chars, vc1), _mm256_cmpeq_epi8 (chars, vc2)));
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_char2_sse2 (pos, end, c1, c2);
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+find_non_space_avx2 (const char *pos, const char *end)
+{
+    for (; end - pos >= 32; pos += 32)
+    {
+        __m256i chars = _mm256_loadu_si256 ((const __m256i *) pos);
+        uint32_t mask =
+            ~(uint32_t) _mm256_movemask_epi8 (space_mask_avx2 (chars));
+        if (mask)
+            return pos + __builtin_ctz (mask);
+    }
+    return find_non_space_sse2 (pos, end);
+}
+
+#endif /* SCAN_X86 */
+
+/** The kernels for each \ref scan_isa, \c NULL if not compiled in. */
+static const struct scan_kernels all_kernels[SCAN_NUM_ISAS] = {
+    [SCAN_SCALAR] = {
+        find_char_scalar, find_char2_scalar, find_non_space_scalar},
+#if SCAN_X86
+    [SCAN_SSE2] = {find_char_sse2, find_char2_sse2, find_non_space_sse2},
+    [SCAN_AVX2] = {find_char_avx2, find_char2_avx2, find_non_space_avx2},
+#endif
+};
+
+/** The kernels in use.  Set by \ref init_scan_kernels before \c main. */
+static struct scan_kernels kernels = {
+    find_char_scalar, find_char2_scalar, find_non_space_scalar};
+
+/** Whether the CPU supports \a isa and its kernels are compiled in. */
+static bool
+isa_supported (enum scan_isa isa)
+{
+    switch (isa)
+    {
+        case SCAN_SCALAR:
+            return true;
+#if SCAN_X86
+        case SCAN_SSE2:
+            return __builtin_cpu_supports ("sse2");
+        case SCAN_AVX2:
+            return __builtin_cpu_supports ("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+/** The fastest \ref scan_isa supported by this CPU. */
+enum scan_isa
+scan_best_isa (void)
+{
+    enum scan_isa best = SCAN_SCALAR;
+    for (int isa = SCAN_SCALAR; isa < SCAN_NUM_ISAS; ++isa)
+        if (isa_supported (isa))
+            best = isa;
+
+    return best;
+}
+
+/** Use the kernels for \a isa from now on.  Meant for testing: there must
+ *  not be a concurrent search.
+ *
+ *  \returns Whether \a isa is supported.  The kernels are unchanged if
+ *      not.
+ */
+bool
+scan_select_isa (enum scan_isa isa)
+{
+    if (isa < 0 || isa >= SCAN_NUM_ISAS || !isa_supported (isa))
+        return false;
+
+    kernels = all_kernels[isa];
+    return true;
+}
+
+/** Pick the kernels of \ref scan_best_isa when the program is loaded. */
+__attribute__ ((constructor))
+static void
+init_scan_kernels (void)
+{
+#if SCAN_X86
+    __builtin_cpu_init ();
+#endif
+    scan_select_isa (scan_best_isa ());
+}
+
+/** Find the first \a c in [\a pos, \a end).
+ *
+ *  \returns The position of the match or \a end.
+ */
+const char *
+scan_find_char (const char *pos, const char *end, char c)
+{
+    return kernels.find_char (pos, end, c);
+}
+
+/** Find the first \a c1 or \a c2 in [\a pos, \a end).
+ *
+ *  \returns The position of the match or \a end.
+ */
+const char *
+scan_find_char2 (const char *pos, const char *end, char c1, char c2)
+{
+    return kernels.find_char2 (pos, end, c1, c2);
+}
+
+/** Find the first char in [\a pos, \a end) which is no white space in the
+ *  "C" locale.
+ *
+ *  \returns The position of the match or \a end.
+ */
+const char *
+scan_find_non_space (const char *pos, const char *end)
+{
+    return kernels.find_non_space (pos, end);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
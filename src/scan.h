@@ -0,0 +1,45 @@
+/** \file
+ * Search for the chars which end a comment, literal or white space.
+ *
+ * The kernels are picked at runtime depending on the CPU: AVX2 and SSE2
+ * versions search 32 or 16 chars at a time, the scalar version one.
+ */
+
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stdbool.h>
+
+/** Instruction sets with an implementation of the scan kernels. */
+enum scan_isa
+{
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_NUM_ISAS
+};
+
+const char *scan_find_char (const char *pos, const char *end, char c);
+const char *scan_find_char2 (const char *pos, const char *end, char c1, char c2);
+const char *scan_find_non_space (const char *pos, const char *end);
+
+bool scan_select_isa (enum scan_isa isa);
+enum scan_isa scan_best_isa (void);
+
+#endif /* not SCAN_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
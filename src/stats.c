@@ -0,0 +1,358 @@
+/** \file
+ * Counters and timings of a run of the program for \c --stats.
+ *
+ * The phases of a run are timed by the main thread.  The input files are
+ * reported by the jobs which process them, so the totals are guarded by a
+ * mutex.  Only the slowest files are kept by name.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/** \struct slow_file
+ *  \brief An input file among the slowest ones.
+ */
+struct slow_file
+{
+    char *name;
+    unsigned long long bytes;
+    double seconds;
+};
+
+/** \struct run_stats
+ *  \brief The counters of a run.
+ *
+ *  \var enum run_phase run_stats::phase
+ *      The phase which is running, started at \a phase_wall and
+ *      \a phase_cpu.
+ *  \var double run_stats::wall
+ *      The elapsed time of each phase.
+ *  \var double run_stats::cpu
+ *      The processor time of each phase summed over all threads.
+ *  \var unsigned long run_stats::duplicate_files
+ *      The input files skipped by \c --dedupe, of \a duplicate_bytes
+ *      chars.
+ *  \var struct clutter_stats run_stats::clutter
+ *      The chars read and removed by stripping, excluding cached files.
+ *  \var double run_stats::open_seconds
+ *      The time spent opening input files summed over all jobs.
+ *  \var struct slow_file *run_stats::slow_files
+ *      The \a num_slow_files slowest files, the slowest first.
+ */
+struct run_stats
+{
+    pthread_mutex_t lock;
+    enum run_phase phase;
+    double phase_wall;
+    double phase_cpu;
+    double wall[NUM_PHASES];
+    double cpu[NUM_PHASES];
+    unsigned long files;
+    unsigned long skipped_files;
+    unsigned long cached_files;
+    unsigned long duplicate_files;
+    unsigned long long duplicate_bytes;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    struct clutter_stats clutter;
+    double open_seconds;
+    int max_slow_files;
+    int num_slow_files;
+    struct slow_file *slow_files;
+};
+
+static const char *const phase_names[NUM_PHASES] = {
+    "setup", "input", "merge", "output"
+};
+
+/** The seconds since some fixed point in time of \a clock. */
+static double
+clock_seconds (clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime (clock, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+/** The current wall time in seconds for timing parts of a run. */
+double
+run_stats_now (void)
+{
+    return clock_seconds (CLOCK_MONOTONIC);
+}
+
+/** Create the counters of a run which starts with \ref PHASE_SETUP now
+ *  and keeps the \a max_slow_files slowest input files.
+ *
+ *  \returns The counters or \c NULL if out of memory.
+ */
+struct run_stats *
+run_stats_new (int max_slow_files)
+{
+    struct run_stats *stats = calloc (1, sizeof (*stats));
+    if (!stats)
+        return NULL;
+
+    stats->slow_files = calloc ((size_t) max_slow_files + 1,
+                                sizeof (*stats->slow_files));
+    if (!stats->slow_files)
+    {
+        free (stats);
+        return NULL;
+    }
+
+    pthread_mutex_init (&stats->lock, NULL);
+    stats->max_slow_files = max_slow_files;
+    stats->phase = PHASE_SETUP;
+    stats->phase_wall = run_stats_now ();
+    stats->phase_cpu = clock_seconds (CLOCK_PROCESS_CPUTIME_ID);
+    return stats;
+}
+
+/** Free \a stats. */
+void
+run_stats_free (struct run_stats *stats)
+{
+    if (!stats)
+        return;
+
+    for (int file = 0; file < stats->num_slow_files; ++file)
+        free (stats->slow_files[file].name);
+    free (stats->slow_files);
+    pthread_mutex_destroy (&stats->lock);
+    free (stats);
+}
+
+/** End the running phase of \a stats and start \a phase.  Phases which
+ *  are skipped keep a time of 0. */
+void
+run_stats_phase (struct run_stats *stats, enum run_phase phase)
+{
+    double wall = run_stats_now ();
+    double cpu = clock_seconds (CLOCK_PROCESS_CPUTIME_ID);
+
+    stats->wall[stats->phase] += wall - stats->phase_wall;
+    stats->cpu[stats->phase] += cpu - stats->phase_cpu;
+    stats->phase = phase;
+    stats->phase_wall = wall;
+    stats->phase_cpu = cpu;
+}
+
+/** Keep \a file_name among the slowest files of \a stats if it took
+ *  \a seconds.  Has to be called with the lock held.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+add_slow_file (
+    struct run_stats *stats, const char *file_name,
+    unsigned long long bytes, double seconds)
+{
+    int pos = stats->num_slow_files;
+    while (pos > 0 && stats->slow_files[pos - 1].seconds < seconds)
+        --pos;
+    if (pos >= stats->max_slow_files)
+        return 0;
+
+    char *name = strdup (file_name);
+    if (!name)
+        return ENOMEM;
+
+    /* The array has room for one more file than kept. */
+    memmove (stats->slow_files + pos + 1, stats->slow_files + pos,
+             (size_t) (stats->num_slow_files - pos)
+                 * sizeof (*stats->slow_files));
+    stats->slow_files[pos].name = name;
+    stats->slow_files[pos].bytes = bytes;
+    stats->slow_files[pos].seconds = seconds;
+
+    if (stats->num_slow_files < stats->max_slow_files)
+        ++stats->num_slow_files;
+    else
+        free (stats->slow_files[stats->num_slow_files].name);
+    return 0;
+}
+
+/** Add the processed input file \a file_name to \a stats.  May be called
+ *  by several threads at once.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+int
+run_stats_add_file (
+    struct run_stats *stats, const char *file_name,
+    const struct file_stats *file)
+{
+    pthread_mutex_lock (&stats->lock);
+
+    ++stats->files;
+    stats->bytes_in += file->clutter.bytes_in;
+    stats->bytes_out += file->bytes_out;
+    if (file->cached)
+        ++stats->cached_files;
+    else
+        clutter_stats_add (&stats->clutter, &file->clutter);
+    stats->open_seconds += file->open_seconds;
+    int res = add_slow_file (
+        stats, file_name, file->clutter.bytes_in, file->seconds);
+
+    pthread_mutex_unlock (&stats->lock);
+    return res;
+}
+
+/** Count an input file which couldn't be processed.  May be called by
+ *  several threads at once. */
+void
+run_stats_skip_file (struct run_stats *stats)
+{
+    pthread_mutex_lock (&stats->lock);
+    ++stats->skipped_files;
+    pthread_mutex_unlock (&stats->lock);
+}
+
+/** Count an input file of \a bytes chars which was skipped as duplicate.
+ *  May be called by several threads at once. */
+void
+run_stats_skip_duplicate (struct run_stats *stats, unsigned long long bytes)
+{
+    pthread_mutex_lock (&stats->lock);
+    ++stats->duplicate_files;
+    stats->duplicate_bytes += bytes;
+    pthread_mutex_unlock (&stats->lock);
+}
+
+/** The throughput of \a bytes in \a seconds in MB/s. */
+static double
+mb_per_s (unsigned long long bytes, double seconds)
+{
+    return seconds > 0 ? (double) bytes / seconds / 1e6 : 0;
+}
+
+/** Write \a text as JSON string to \a ostr.  Quotes, backslashes and
+ *  control chars are escaped. */
+void
+print_json_string (const char *text, FILE *ostr)
+{
+    fputc ('"', ostr);
+    for (const char *cur = text; *cur; ++cur)
+    {
+        if (*cur == '"' || *cur == '\\')
+            fprintf (ostr, "\\%c", *cur);
+        else if ((unsigned char) *cur < 0x20)
+            fprintf (ostr, "\\u%04x", (unsigned) *cur);
+        else
+            fputc (*cur, ostr);
+    }
+    fputc ('"', ostr);
+}
+
+/** Write \a stats as JSON object to \a ostr. */
+static void
+print_json (const struct run_stats *stats, FILE *ostr)
+{
+    fprintf (ostr,
+             "{\n  \"files\": {\"processed\": %lu, \"skipped\": %lu, "
+             "\"cached\": %lu, \"duplicates\": %lu},\n"
+             "  \"bytes\": {\"in\": %llu, \"out\": %llu, \"comments\": %llu, "
+             "\"strings\": %llu, \"white_space\": %llu, "
+             "\"duplicates\": %llu},\n"
+             "  \"open_seconds\": %.6f,\n  \"phases\": [",
+             stats->files, stats->skipped_files, stats->cached_files,
+             stats->duplicate_files, stats->bytes_in, stats->bytes_out,
+             stats->clutter.comment_bytes, stats->clutter.string_bytes,
+             stats->clutter.white_space_bytes, stats->duplicate_bytes,
+             stats->open_seconds);
+
+    for (int phase = 0; phase < NUM_PHASES; ++phase)
+        fprintf (ostr,
+                 "%s\n    {\"name\": \"%s\", \"wall_seconds\": %.6f, "
+                 "\"cpu_seconds\": %.6f}",
+                 phase ? "," : "", phase_names[phase], stats->wall[phase],
+                 stats->cpu[phase]);
+
+    fputs ("\n  ],\n  \"slowest_files\": [", ostr);
+    for (int file = 0; file < stats->num_slow_files; ++file)
+    {
+        const struct slow_file *slow = &stats->slow_files[file];
+        fputs (file ? ",\n    {\"file\": " : "\n    {\"file\": ", ostr);
+        print_json_string (slow->name, ostr);
+        fprintf (ostr, ", \"bytes\": %llu, \"seconds\": %.6f, "
+                 "\"mb_per_s\": %.2f}",
+                 slow->bytes, slow->seconds,
+                 mb_per_s (slow->bytes, slow->seconds));
+    }
+    fputs (stats->num_slow_files ? "\n  ]\n}\n" : "]\n}\n", ostr);
+}
+
+/** Write \a stats for humans to \a ostr. */
+static void
+print_text (const struct run_stats *stats, FILE *ostr)
+{
+    fprintf (ostr,
+             "Files:        %lu processed, %lu skipped, %lu from cache\n"
+             "Duplicates:   %lu files of %llu bytes skipped\n"
+             "Bytes in:     %llu\n"
+             "Bytes out:    %llu\n"
+             "Removed:      %llu comments, %llu strings, %llu white space\n"
+             "Opening:      %.3f s summed over all jobs\n\n"
+             "Phase        wall [s]     cpu [s]\n",
+             stats->files, stats->skipped_files, stats->cached_files,
+             stats->duplicate_files, stats->duplicate_bytes,
+             stats->bytes_in, stats->bytes_out, stats->clutter.comment_bytes,
+             stats->clutter.string_bytes, stats->clutter.white_space_bytes,
+             stats->open_seconds);
+
+    double total_wall = 0;
+    double total_cpu = 0;
+    for (int phase = 0; phase < NUM_PHASES; ++phase)
+    {
+        fprintf (ostr, "%-8s %12.3f %11.3f\n", phase_names[phase],
+                 stats->wall[phase], stats->cpu[phase]);
+        total_wall += stats->wall[phase];
+        total_cpu += stats->cpu[phase];
+    }
+    fprintf (ostr, "%-8s %12.3f %11.3f\n", "total", total_wall, total_cpu);
+
+    if (stats->num_slow_files)
+        fputs ("\nSlowest files   seconds        MB/s  file\n", ostr);
+    for (int file = 0; file < stats->num_slow_files; ++file)
+    {
+        const struct slow_file *slow = &stats->slow_files[file];
+        fprintf (ostr, "%25.3f %11.2f  %s\n", slow->seconds,
+                 mb_per_s (slow->bytes, slow->seconds), slow->name);
+    }
+}
+
+/** End the running phase of \a stats and write all counters to \a ostr,
+ *  as JSON object if \a json is true. */
+void
+run_stats_print (struct run_stats *stats, bool json, FILE *ostr)
+{
+    run_stats_phase (stats, stats->phase);
+
+    if (json)
+        print_json (stats, ostr);
+    else
+        print_text (stats, ostr);
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
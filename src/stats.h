@@ -0,0 +1,78 @@
+/** \file
+ * Counters and timings of a run of the program for \c --stats.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "domaincloud.h"
+
+/** Phases of a run in the order in which they happen. */
+enum run_phase
+{
+    PHASE_SETUP,        /**< Options, output and cache are opened. */
+    PHASE_INPUT,        /**< The input files are stripped or counted. */
+    PHASE_MERGE,        /**< The word counts of the jobs are merged. */
+    PHASE_OUTPUT,       /**< The result is drawn or written. */
+    NUM_PHASES
+};
+
+/** \struct file_stats
+ *  \brief What happened to one input file.
+ *
+ *  \var struct clutter_stats file_stats::clutter
+ *      The read and removed chars.  Only \a bytes_in is set for files
+ *      found in the cache.
+ *  \var unsigned long long file_stats::bytes_out
+ *      Number of chars of the stripped text.
+ *  \var bool file_stats::cached
+ *      Whether the stripped text was taken from the cache.
+ *  \var double file_stats::open_seconds
+ *      Time spent opening the file.
+ *  \var double file_stats::seconds
+ *      Time spent on the file including \a open_seconds.
+ */
+struct file_stats
+{
+    struct clutter_stats clutter;
+    unsigned long long bytes_out;
+    bool cached;
+    double open_seconds;
+    double seconds;
+};
+
+struct run_stats;
+
+struct run_stats *run_stats_new (int max_slow_files);
+void run_stats_free (struct run_stats *stats);
+double run_stats_now (void);
+void run_stats_phase (struct run_stats *stats, enum run_phase phase);
+int run_stats_add_file (
+    struct run_stats *stats, const char *file_name,
+    const struct file_stats *file);
+void run_stats_skip_file (struct run_stats *stats);
+void run_stats_skip_duplicate (
+    struct run_stats *stats, unsigned long long bytes);
+void run_stats_print (struct run_stats *stats, bool json, FILE *ostr);
+void print_json_string (const char *text, FILE *ostr);
+
+#endif /* not STATS_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,141 @@
+/** \file
+ * Bump allocation of the strings of a \ref string_pool. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_pool.h"
+
+/** Chunks grow by doubling up to this size. */
+#define MAX_CHUNK_SIZE (16 * 1024 * 1024)
+/** Initial number of ids. */
+#define MIN_IDS 1024
+
+/** \struct pool_chunk
+ *  \brief A block of strings of a \ref string_pool, followed by its
+ *      bytes.
+ *
+ *  \var struct pool_chunk *pool_chunk::prev
+ *      The chunk allocated before or \c NULL.
+ */
+struct pool_chunk
+{
+    struct pool_chunk *prev;
+};
+
+/** Initialize the empty \a pool whose first chunk has \a chunk_size
+ *  bytes.  Nothing is allocated before the first string is added. */
+void
+string_pool_init (struct string_pool *pool, size_t chunk_size)
+{
+    pool->chunks = NULL;
+    pool->chunk_used = 0;
+    pool->chunk_size = chunk_size;
+    pool->strings = NULL;
+    pool->num_ids = 1;
+    pool->max_ids = 0;
+}
+
+/** Free all strings of \a pool at once.  \a pool is empty afterwards. */
+void
+string_pool_release (struct string_pool *pool)
+{
+    while (pool->chunks)
+    {
+        struct pool_chunk *prev = pool->chunks->prev;
+        free (pool->chunks);
+        pool->chunks = prev;
+    }
+    free (pool->strings);
+    string_pool_init (pool, pool->chunk_size);
+}
+
+/** Add a new chunk of at least \a size bytes to \a pool.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+add_chunk (struct string_pool *pool, size_t size)
+{
+    size_t chunk_size = pool->chunks && pool->chunk_size < MAX_CHUNK_SIZE
+        ? 2 * pool->chunk_size : pool->chunk_size;
+    if (chunk_size < size)
+        chunk_size = size;
+
+    struct pool_chunk *chunk = malloc (sizeof (*chunk) + chunk_size);
+    if (!chunk)
+        return ENOMEM;
+
+    chunk->prev = pool->chunks;
+    pool->chunks = chunk;
+    pool->chunk_used = 0;
+    pool->chunk_size = chunk_size;
+    return 0;
+}
+
+/** Copy the \a len chars of \a str with a terminating \c NUL into
+ *  \a pool.  At least \a reserve bytes are kept for the string, so that
+ *  \ref string_pool_set can replace it by strings of up to \a reserve - 1
+ *  chars.
+ *
+ *  \param id Set to the id of the new string, which is not 0.
+ *  \returns \c ENOMEM if out of memory or ids, else 0.
+ */
+int
+string_pool_add (
+    struct string_pool *pool, const char *str, size_t len, size_t reserve,
+    uint32_t *id)
+{
+    if (pool->num_ids >= pool->max_ids)
+    {
+        if (pool->max_ids > UINT32_MAX / 2)
+            return ENOMEM;
+        uint32_t max_ids = pool->max_ids ? 2 * pool->max_ids : MIN_IDS;
+        char **strings = realloc (pool->strings, max_ids * sizeof (*strings));
+        if (!strings)
+            return ENOMEM;
+        pool->strings = strings;
+        pool->max_ids = max_ids;
+    }
+
+    size_t size = len + 1 > reserve ? len + 1 : reserve;
+    if ((!pool->chunks || size > pool->chunk_size - pool->chunk_used)
+        && add_chunk (pool, size))
+        return ENOMEM;
+
+    char *copy = (char *) (pool->chunks + 1) + pool->chunk_used;
+    pool->chunk_used += size;
+    memcpy (copy, str, len);
+    copy[len] = '\0';
+
+    *id = pool->num_ids++;
+    pool->strings[*id] = copy;
+    return 0;
+}
+
+/** Replace the string with \a id in \a pool by the \a len chars of
+ *  \a str.  \a len has to be below the bytes reserved for the string. */
+void
+string_pool_set (
+    struct string_pool *pool, uint32_t id, const char *str, size_t len)
+{
+    memcpy (pool->strings[id], str, len);
+    pool->strings[id][len] = '\0';
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,73 @@
+/** \file
+ * An arena of zero terminated strings referred to by 32 bit ids.
+ *
+ * Strings are copied behind each other into large chunks, so adding one
+ * costs no \c malloc and releasing the pool frees only its chunks, not
+ * every string.  Each \ref word_counts table, and so each job, has its
+ * own pool.
+ */
+
+#ifndef STRING_POOL_H_
+#define STRING_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \struct string_pool
+ *  \brief The strings of an arena.
+ *
+ *  \var struct pool_chunk *string_pool::chunks
+ *      The chunk strings are added to, which links to the full ones.
+ *  \var size_t string_pool::chunk_used
+ *      The number of used bytes of the current chunk.
+ *  \var size_t string_pool::chunk_size
+ *      The number of bytes of the current chunk.
+ *  \var char **string_pool::strings
+ *      Each string by its id.  Id 0 is no string.
+ *  \var uint32_t string_pool::num_ids
+ *      The number of ids including 0.
+ *  \var uint32_t string_pool::max_ids
+ *      The number of entries of \a strings.
+ */
+struct string_pool
+{
+    struct pool_chunk *chunks;
+    size_t chunk_used;
+    size_t chunk_size;
+    char **strings;
+    uint32_t num_ids;
+    uint32_t max_ids;
+};
+
+void string_pool_init (struct string_pool *pool, size_t chunk_size);
+void string_pool_release (struct string_pool *pool);
+int string_pool_add (
+    struct string_pool *pool, const char *str, size_t len, size_t reserve,
+    uint32_t *id);
+void string_pool_set (
+    struct string_pool *pool, uint32_t id, const char *str, size_t len);
+
+/** The string with \a id in \a pool. */
+static inline const char *
+string_pool_get (const struct string_pool *pool, uint32_t id)
+{
+    return pool->strings[id];
+}
+
+#endif /* not STRING_POOL_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,254 @@
+/** \file
+ * Spans of the work of each thread in the Chrome Trace Event Format for
+ * \c --trace.
+ *
+ * Each thread appends its spans to a buffer of its own, so recording a
+ * span takes no lock.  The buffer of a thread is created with its first
+ * span and pushed onto a global list with an atomic compare and swap.
+ * The spans are written by \ref trace_write after all threads have
+ * finished; they can be viewed with \c chrome://tracing or Perfetto.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "trace.h"
+
+/** Number of spans in each block of a \ref trace_buffer. */
+#define TRACE_BLOCK_SPANS 1024
+
+/** \struct trace_span
+ *  \brief One timed piece of work.  Times are in nanoseconds since
+ *      \ref trace_start.
+ *
+ *  \var const char *trace_span::name
+ *      What was done.  A string literal.
+ *  \var char *trace_span::detail
+ *      The file worked on or \c NULL.
+ */
+struct trace_span
+{
+    const char *name;
+    char *detail;
+    uint64_t start;
+    uint64_t duration;
+    unsigned long long bytes;
+};
+
+/** \struct trace_block
+ *  \brief A part of the spans of a thread. */
+struct trace_block
+{
+    struct trace_block *next;
+    int num_spans;
+    struct trace_span spans[TRACE_BLOCK_SPANS];
+};
+
+/** \struct trace_buffer
+ *  \brief The spans of one thread.
+ *
+ *  \var struct trace_buffer *trace_buffer::next
+ *      The buffer of the thread created before.
+ *  \var struct trace_block *trace_buffer::last
+ *      The block which is filled.
+ */
+struct trace_buffer
+{
+    struct trace_buffer *next;
+    long tid;
+    struct trace_block *first;
+    struct trace_block *last;
+};
+
+/** Whether spans are recorded.  Set by \ref trace_start before any threads
+ *  are created. */
+bool trace_enabled;
+
+/** The time of \ref trace_start. */
+static uint64_t trace_origin;
+
+/** The thread which called \ref trace_start. */
+static long main_tid;
+
+/** The buffers of all threads, the latest first. */
+static struct trace_buffer *trace_buffers;
+
+/** The buffer of the calling thread or \c NULL if it has recorded no
+ *  span yet. */
+static __thread struct trace_buffer *thread_buffer;
+
+/** The current time of the monotonic clock in nanoseconds. */
+static uint64_t
+now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/** The kernel id of the calling thread as shown by tools like \c perf. */
+static long
+thread_id (void)
+{
+    return syscall (SYS_gettid);
+}
+
+/** Record spans from now on. */
+void
+trace_start (void)
+{
+    trace_origin = now_ns ();
+    main_tid = thread_id ();
+    trace_enabled = true;
+}
+
+/** The start time of a span which is ended by \ref trace_end, or 0 if no
+ *  spans are recorded. */
+uint64_t
+trace_begin (void)
+{
+    return trace_enabled ? now_ns () - trace_origin : 0;
+}
+
+/** Create the buffer of the calling thread and add it to
+ *  \ref trace_buffers.
+ *
+ *  \returns The buffer or \c NULL if out of memory.
+ */
+static struct trace_buffer *
+new_thread_buffer (void)
+{
+    struct trace_buffer *buffer = calloc (1, sizeof (*buffer));
+    if (!buffer)
+        return NULL;
+
+    buffer->tid = thread_id ();
+    buffer->next = __atomic_load_n (&trace_buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n (
+               &trace_buffers, &buffer->next, buffer, true,
+               __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    return buffer;
+}
+
+/** Record the span \a name of the calling thread which started at
+ *  \a start, as returned by \ref trace_begin, and ends now.
+ *
+ *  \param name What was done.  Has to be a string literal.
+ *  \param bytes Number of bytes processed in the span.
+ *  \param detail The file worked on or \c NULL.  Copied.
+ *
+ *  Spans are dropped if out of memory.
+ */
+void
+trace_end (
+    const char *name, uint64_t start, unsigned long long bytes,
+    const char *detail)
+{
+    if (!trace_enabled)
+        return;
+
+    uint64_t end = now_ns () - trace_origin;
+    if (!thread_buffer && !(thread_buffer = new_thread_buffer ()))
+        return;
+
+    struct trace_block *block = thread_buffer->last;
+    if (!block || block->num_spans == TRACE_BLOCK_SPANS)
+    {
+        if (!(block = malloc (sizeof (*block))))
+            return;
+        block->next = NULL;
+        block->num_spans = 0;
+        if (thread_buffer->last)
+            thread_buffer->last->next = block;
+        else
+            thread_buffer->first = block;
+        thread_buffer->last = block;
+    }
+
+    struct trace_span *span = &block->spans[block->num_spans++];
+    span->name = name;
+    span->detail = detail ? strdup (detail) : NULL;
+    span->start = start;
+    span->duration = end - start;
+    span->bytes = bytes;
+}
+
+/** Write all recorded spans to \a ostr as trace and free them.  Has to be
+ *  called after all other threads have finished.
+ *
+ *  \returns \a errno if writing failed else 0.
+ */
+int
+trace_write (FILE *ostr)
+{
+    int pid = (int) getpid ();
+    fprintf (ostr, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+             "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+             "\"tid\": %ld, \"args\": {\"name\": \"main\"}}",
+             pid, main_tid);
+
+    struct trace_buffer *buffer = trace_buffers;
+    while (buffer)
+    {
+        struct trace_block *block = buffer->first;
+        while (block)
+        {
+            for (int pos = 0; pos < block->num_spans; ++pos)
+            {
+                struct trace_span *span = &block->spans[pos];
+                fprintf (ostr,
+                         ",\n{\"name\": \"%s\", \"cat\": \"domaincloud\", "
+                         "\"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                         "\"pid\": %d, \"tid\": %ld, \"args\": "
+                         "{\"bytes\": %llu",
+                         span->name, (double) span->start / 1e3,
+                         (double) span->duration / 1e3, pid, buffer->tid,
+                         span->bytes);
+                if (span->detail)
+                {
+                    fputs (", \"file\": ", ostr);
+                    print_json_string (span->detail, ostr);
+                }
+                fputs ("}}", ostr);
+                free (span->detail);
+            }
+
+            struct trace_block *next_block = block->next;
+            free (block);
+            block = next_block;
+        }
+
+        struct trace_buffer *next = buffer->next;
+        free (buffer);
+        buffer = next;
+    }
+    trace_buffers = NULL;
+    thread_buffer = NULL;
+    trace_enabled = false;
+
+    fputs ("\n]}\n", ostr);
+    return ferror (ostr) ? (errno ? errno : EIO) : 0;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
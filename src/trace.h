@@ -0,0 +1,38 @@
+/** \file
+ * Spans of the work of each thread in the Chrome Trace Event Format for
+ * \c --trace.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+extern bool trace_enabled;
+
+void trace_start (void);
+uint64_t trace_begin (void);
+void trace_end (
+    const char *name, uint64_t start, unsigned long long bytes,
+    const char *detail);
+int trace_write (FILE *ostr);
+
+#endif /* not TRACE_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,684 @@
+/** \file
+ * A pool of worker threads which share a stack of directories to read
+ * and a queue of files to process.  A worker reading a directory pushes
+ * its entries onto them, where idle workers pick them up, so walking and
+ * processing overlap and no list of all files is built.  The walk stays
+ * \ref INPUT_LOADER_DEPTH files ahead of the processing, and the queued
+ * files are read ahead by an \ref input_loader.
+ *
+ * Each file is processed into its own memory buffer, which is written to
+ * the output stream as a whole once the file is done.  The order of the
+ * files in the output is unspecified.
+ *
+ * \c .gitignore support covers blank lines, comments, negation with
+ * <tt>!</tt>, directory only patterns ending with <tt>/</tt> and patterns
+ * anchored by a <tt>/</tt>.  Only \c .gitignore files inside the walked
+ * directories are read.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "loader.h"
+#include "trace.h"
+#include "walk.h"
+
+/** \struct ignore_pattern
+ *  \brief A line of a \c .gitignore file.
+ *
+ *  \var char *ignore_pattern::glob
+ *      The pattern without leading <tt>!</tt> and <tt>/</tt> and trailing
+ *      <tt>/</tt>.
+ *  \var bool ignore_pattern::anchored
+ *      Whether \a glob is matched against the path relative to the
+ *      directory of the \c .gitignore file instead of the file name.
+ */
+struct ignore_pattern
+{
+    char *glob;
+    bool negate;
+    bool dir_only;
+    bool anchored;
+};
+
+/** \struct ignore_rules
+ *  \brief The patterns of the \c .gitignore file of one directory.
+ *
+ *  \var const struct ignore_rules *ignore_rules::parent
+ *      The rules of the closest directory above with a \c .gitignore file
+ *      or \c NULL.
+ *  \var size_t ignore_rules::base_len
+ *      Length of the path of the directory relative to the walked
+ *      directory including a trailing <tt>/</tt>.
+ *  \var struct ignore_rules *ignore_rules::next
+ *      The next rules read during the walk.  All are freed at its end.
+ */
+struct ignore_rules
+{
+    const struct ignore_rules *parent;
+    size_t base_len;
+    struct ignore_pattern *patterns;
+    size_t num_patterns;
+    struct ignore_rules *next;
+};
+
+/** \struct walk_item
+ *  \brief A directory on the stack or a file in the queue of the walk.
+ *
+ *  \var char *walk_item::path
+ *      The path to open.
+ *  \var size_t walk_item::root_len
+ *      Length of the prefix of \a path which is not relative to the
+ *      walked directory.
+ *  \var const struct ignore_rules *walk_item::ignores
+ *      The \c .gitignore rules of the directory containing the item.
+ *  \var struct input_load *walk_item::load
+ *      The load of a file which is read ahead or \c NULL.
+ */
+struct walk_item
+{
+    char *path;
+    size_t root_len;
+    bool is_dir;
+    const struct ignore_rules *ignores;
+    struct input_load *load;
+    struct walk_item *next;
+};
+
+/** \struct file_walk
+ *  \brief The state shared by the workers of \ref walk_files_parallel.
+ *      All members after \a lock are protected by it.
+ *
+ *  \var struct walk_item *file_walk::stack
+ *      The directories to read.
+ *  \var struct walk_item *file_walk::files
+ *      The files to process, oldest first.
+ *  \var struct walk_item *file_walk::next_load
+ *      The first file in \a files which isn't read ahead yet.
+ *  \var int file_walk::num_loads
+ *      Number of loads which aren't released yet.
+ *  \var int file_walk::num_busy
+ *      Number of workers processing an item.  They may push new items.
+ */
+struct file_walk
+{
+    const struct walk_filter *filter;
+    FILE *ostr;
+    input_file_processor *process;
+    struct input_loader *loader;
+
+    pthread_mutex_t lock;
+    pthread_cond_t items_changed;
+    struct walk_item *stack;
+    struct walk_item *files;
+    struct walk_item **files_tail;
+    struct walk_item *next_load;
+    int num_files;
+    int num_loads;
+    int num_busy;
+    struct ignore_rules *all_ignores;
+    int write_error;
+};
+
+/** \struct walk_worker
+ *  \brief Argument of \ref walk_files_worker. */
+struct walk_worker
+{
+    struct file_walk *walk;
+    void *data;
+    pthread_t thread;
+};
+
+/** The part of \a path after the last <tt>/</tt>. */
+static const char *
+base_name (const char *path)
+{
+    const char *slash = strrchr (path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/** Whether \a rel_path, the path relative to the walked directory, or
+ *  its file name match one of the \a num_patterns \a patterns as described
+ *  for \ref walk_filter. */
+static bool
+matches_any (char **patterns, int num_patterns, const char *rel_path)
+{
+    for (int pattern = 0; pattern < num_patterns; ++pattern)
+    {
+        const char *subject = strchr (patterns[pattern], '/')
+            ? rel_path : base_name (rel_path);
+        if (!fnmatch (patterns[pattern], subject, 0))
+            return true;
+    }
+
+    return false;
+}
+
+/** Whether the file at \a path passes the include and exclude patterns
+ *  of \a filter.  The \c .gitignore files are not looked at. */
+bool
+walk_filter_selects (const struct walk_filter *filter, const char *path)
+{
+    return !matches_any (filter->exclude, filter->num_exclude, path)
+        && (!filter->num_include
+            || matches_any (filter->include, filter->num_include, path));
+}
+
+/** Whether \a rel_path is ignored by the \c .gitignore \a rules.  The
+ *  last matching pattern of the deepest \c .gitignore file decides. */
+static bool
+is_ignored (
+    const struct ignore_rules *rules, const char *rel_path, bool is_dir)
+{
+    for (; rules; rules = rules->parent)
+        for (size_t pos = rules->num_patterns; pos > 0; --pos)
+        {
+            const struct ignore_pattern *pattern = &rules->patterns[pos - 1];
+            if (pattern->dir_only && !is_dir)
+                continue;
+
+            const char *subject = pattern->anchored
+                ? rel_path + rules->base_len : base_name (rel_path);
+            int flags = strstr (pattern->glob, "**") ? 0 : FNM_PATHNAME;
+            if (!fnmatch (pattern->glob, subject, flags))
+                return !pattern->negate;
+        }
+
+    return false;
+}
+
+/** Add the pattern in \a line of a \c .gitignore file to \a rules.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+add_ignore_pattern (struct ignore_rules *rules, char *line)
+{
+    size_t len = strcspn (line, "\r\n");
+    while (len > 0 && line[len - 1] == ' ')
+        --len;
+    line[len] = '\0';
+    if (!len || line[0] == '#')
+        return 0;
+
+    struct ignore_pattern pattern = {NULL, false, false, false};
+    if (line[0] == '!')
+    {
+        pattern.negate = true;
+        ++line;
+        --len;
+    }
+    if (len > 0 && line[len - 1] == '/')
+    {
+        pattern.dir_only = true;
+        line[--len] = '\0';
+    }
+    pattern.anchored = strchr (line, '/') != NULL;
+    if (line[0] == '/')
+        ++line;
+    if (!*line)
+        return 0;
+
+    struct ignore_pattern *patterns = realloc (
+        rules->patterns, (rules->num_patterns + 1) * sizeof (*patterns));
+    if (!patterns)
+        return ENOMEM;
+    rules->patterns = patterns;
+
+    if (!(pattern.glob = strdup (line)))
+        return ENOMEM;
+    rules->patterns[rules->num_patterns++] = pattern;
+
+    return 0;
+}
+
+/** Read the \c .gitignore file of the directory \a item.
+ *
+ *  \returns Its rules or the rules of \a item if there is none.
+ */
+static const struct ignore_rules *
+read_ignore_rules (struct file_walk *walk, const struct walk_item *item)
+{
+    char *ignore_file;
+    if (asprintf (&ignore_file, "%s/.gitignore", item->path) < 0)
+        return item->ignores;
+
+    FILE *istr = fopen (ignore_file, "r");
+    free (ignore_file);
+    if (!istr)
+        return item->ignores;
+
+    struct ignore_rules *rules = calloc (1, sizeof (*rules));
+    if (!rules)
+    {
+        fclose (istr);
+        return item->ignores;
+    }
+
+    size_t path_len = strlen (item->path);
+    size_t rel_len = path_len > item->root_len ? path_len - item->root_len : 0;
+    rules->parent = item->ignores;
+    rules->base_len = rel_len ? rel_len + 1 : 0;
+
+    char *line = NULL;
+    size_t line_size = 0;
+    while (getline (&line, &line_size, istr) > 0)
+        if (add_ignore_pattern (rules, line))
+            break;
+    free (line);
+    fclose (istr);
+
+    pthread_mutex_lock (&walk->lock);
+    rules->next = walk->all_ignores;
+    walk->all_ignores = rules;
+    pthread_mutex_unlock (&walk->lock);
+
+    return rules;
+}
+
+/** Queue the loads of the next files of \a walk until
+ *  \ref INPUT_LOADER_DEPTH are in flight.  Has to be called with the lock
+ *  held. */
+static void
+load_files_ahead (struct file_walk *walk)
+{
+    while (walk->loader && walk->num_loads < INPUT_LOADER_DEPTH
+           && walk->next_load)
+    {
+        struct walk_item *item = walk->next_load;
+        walk->next_load = item->next;
+        if (input_loader_skips (item->path))
+            continue;
+        item->load = input_loader_add (walk->loader, item->path);
+        if (item->load)
+            ++walk->num_loads;
+    }
+}
+
+/** Push a new item for \a path onto the stack of \a walk if it is a
+ *  directory, else append it to the files.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.  \a path is freed on
+ *      error.
+ */
+static int
+push_item (
+    struct file_walk *walk, char *path, size_t root_len, bool is_dir,
+    const struct ignore_rules *ignores)
+{
+    struct walk_item *item = malloc (sizeof (*item));
+    if (!item)
+    {
+        free (path);
+        return ENOMEM;
+    }
+    *item = (struct walk_item) {path, root_len, is_dir, ignores, NULL, NULL};
+
+    pthread_mutex_lock (&walk->lock);
+    if (is_dir)
+    {
+        item->next = walk->stack;
+        walk->stack = item;
+    }
+    else
+    {
+        *walk->files_tail = item;
+        walk->files_tail = &item->next;
+        if (!walk->next_load)
+            walk->next_load = item;
+        ++walk->num_files;
+        load_files_ahead (walk);
+    }
+    pthread_cond_signal (&walk->items_changed);
+    pthread_mutex_unlock (&walk->lock);
+
+    return 0;
+}
+
+/** Whether \a name in the directory \a dir is a regular file after
+ *  following symbolic links. */
+static bool
+is_file_at (DIR *dir, const char *name)
+{
+    struct stat file_stat;
+    return !fstatat (dirfd (dir), name, &file_stat, 0)
+        && S_ISREG (file_stat.st_mode);
+}
+
+/** Whether the directory entry \a entry in the directory \a dir is a
+ *  directory or a regular file.  Symbolic links to files are followed,
+ *  those to directories are not, so the walk can't loop.
+ *
+ *  \returns Whether \a entry is a directory or a regular file.  Which one
+ *      is put into \a is_dir.
+ */
+static bool
+classify_entry (DIR *dir, const struct dirent *entry, bool *is_dir)
+{
+    struct stat entry_stat;
+    *is_dir = false;
+
+    switch (entry->d_type)
+    {
+        case DT_DIR:
+            *is_dir = true;
+            return true;
+
+        case DT_REG:
+            return true;
+
+        case DT_LNK:
+            return is_file_at (dir, entry->d_name);
+
+        case DT_UNKNOWN:
+            if (fstatat (
+                    dirfd (dir), entry->d_name, &entry_stat,
+                    AT_SYMLINK_NOFOLLOW))
+                return false;
+            if (S_ISLNK (entry_stat.st_mode))
+                return is_file_at (dir, entry->d_name);
+            *is_dir = S_ISDIR (entry_stat.st_mode);
+            return *is_dir || S_ISREG (entry_stat.st_mode);
+
+        default:
+            return false;
+    }
+}
+
+/** Whether the file or directory at \a rel_path, the path relative to the
+ *  walked directory, passes the filter of \a walk and the \c .gitignore
+ *  \a ignores. */
+static bool
+passes_filter (
+    const struct file_walk *walk, const struct ignore_rules *ignores,
+    const char *rel_path, bool is_dir)
+{
+    const struct walk_filter *filter = walk->filter;
+    if (filter->gitignore && is_ignored (ignores, rel_path, is_dir))
+        return false;
+    if (!is_dir)
+        return walk_filter_selects (filter, rel_path);
+
+    /* With a trailing slash the directory itself matches patterns which
+     * end in "/" followed by "**". */
+    char *dir_path;
+    if (asprintf (&dir_path, "%s/", rel_path) < 0)
+        return true;
+    bool excluded = matches_any (filter->exclude, filter->num_exclude, rel_path)
+        || matches_any (filter->exclude, filter->num_exclude, dir_path);
+    free (dir_path);
+
+    return !excluded;
+}
+
+/** Push the files and subdirectories of the directory \a item which pass
+ *  the filter of \a walk onto its stack.  Skip \c .git directories. */
+static void
+walk_dir (struct file_walk *walk, const struct walk_item *item)
+{
+    uint64_t start = trace_begin ();
+    DIR *dir = opendir (item->path);
+    if (!dir)
+    {
+        error (0, errno, "Can't open directory '%s'!", item->path);
+        return;
+    }
+
+    const struct ignore_rules *ignores = walk->filter->gitignore
+        ? read_ignore_rules (walk, item) : NULL;
+    size_t path_len = strlen (item->path);
+    bool has_slash = path_len > 0 && item->path[path_len - 1] == '/';
+
+    struct dirent *entry;
+    while ((entry = readdir (dir)))
+    {
+        const char *name = entry->d_name;
+        bool is_dir;
+        if (!strcmp (name, ".") || !strcmp (name, "..")
+            || !classify_entry (dir, entry, &is_dir)
+            || (is_dir && !strcmp (name, ".git")))
+            continue;
+
+        char *path;
+        if (asprintf (&path, "%s%s%s", item->path, has_slash ? "" : "/", name)
+            < 0)
+            break;
+
+        if (!passes_filter (walk, ignores, path + item->root_len, is_dir))
+            free (path);
+        else if (push_item (walk, path, item->root_len, is_dir, ignores))
+            break;
+    }
+
+    closedir (dir);
+    trace_end ("read_dir", start, 0, item->path);
+}
+
+/** Process the file \a item with the processor of \a walk and release
+ *  its load. */
+static void
+walk_file (struct walk_worker *worker, const struct walk_item *item)
+{
+    struct file_walk *walk = worker->walk;
+    char *text = NULL;
+    size_t len = 0;
+    FILE *buffer = NULL;
+
+    int buffer_error = 0;
+
+    if (walk->ostr && !(buffer = open_memstream (&text, &len)))
+        buffer_error = errno;
+    if (buffer || !walk->ostr)
+        walk->process (
+            item->path, item->load ? input_load_wait (item->load) : NULL,
+            buffer, worker->data);
+    if (buffer)
+        fclose (buffer);
+    input_load_release (item->load);
+
+    pthread_mutex_lock (&walk->lock);
+    if (item->load)
+    {
+        --walk->num_loads;
+        load_files_ahead (walk);
+    }
+    if (buffer_error)
+        walk->write_error = buffer_error;
+    else if (buffer && !walk->write_error && len
+             && fwrite (text, 1, len, walk->ostr) != len)
+        walk->write_error = errno ? errno : EIO;
+    pthread_mutex_unlock (&walk->lock);
+    free (text);
+}
+
+/** Take the next item of \a walk: a directory while fewer than
+ *  \ref INPUT_LOADER_DEPTH files are queued, so that the loader has work,
+ *  else a file.  Has to be called with the lock held.
+ *
+ *  \returns The item or \c NULL if there is none.
+ */
+static struct walk_item *
+take_item (struct file_walk *walk)
+{
+    struct walk_item *item;
+    if (walk->files && (!walk->stack || walk->num_files >= INPUT_LOADER_DEPTH))
+    {
+        item = walk->files;
+        walk->files = item->next;
+        if (!walk->files)
+            walk->files_tail = &walk->files;
+        if (walk->next_load == item)
+            walk->next_load = item->next;
+        --walk->num_files;
+    }
+    else if ((item = walk->stack))
+        walk->stack = item->next;
+
+    return item;
+}
+
+/** Thread function: take items from the stack until it is empty and no
+ *  other worker can push new ones. */
+static void *
+walk_files_worker (void *worker_arg)
+{
+    struct walk_worker *worker = worker_arg;
+    struct file_walk *walk = worker->walk;
+
+    pthread_mutex_lock (&walk->lock);
+    while (walk->stack || walk->files || walk->num_busy > 0)
+    {
+        struct walk_item *item = take_item (walk);
+        if (!item)
+        {
+            pthread_cond_wait (&walk->items_changed, &walk->lock);
+            continue;
+        }
+
+        ++walk->num_busy;
+        pthread_mutex_unlock (&walk->lock);
+
+        if (item->is_dir)
+            walk_dir (walk, item);
+        else
+            walk_file (worker, item);
+        free (item->path);
+        free (item);
+
+        pthread_mutex_lock (&walk->lock);
+        if (!--walk->num_busy && !walk->stack)
+            pthread_cond_broadcast (&walk->items_changed);
+    }
+    pthread_mutex_unlock (&walk->lock);
+
+    return NULL;
+}
+
+/** Call \a process for the \a num_roots \a roots which are no directories
+ *  and for all files below those which are on \a num_jobs threads.  Only
+ *  files passing \a filter are processed.  Each file is processed into its
+ *  own memory buffer, which is written to \a ostr in one piece.
+ *
+ *  If \a ostr is \c NULL, \a process gets \c NULL as stream.  If
+ *  \a worker_data is not \c NULL, it has \a num_jobs entries and
+ *  \a process gets a different entry on each thread.
+ *
+ *  \returns \a errno if a buffer couldn't be allocated or written to
+ *      \a ostr, \c ENOMEM if out of memory else 0.
+ */
+int
+walk_files_parallel (
+    char **roots, int num_roots, const struct walk_filter *filter,
+    FILE *ostr, int num_jobs, input_file_processor *process,
+    void **worker_data)
+{
+    if (num_jobs < 1)
+        num_jobs = 1;
+
+    struct file_walk walk = {
+        .filter = filter, .ostr = ostr, .process = process};
+    walk.files_tail = &walk.files;
+    struct walk_worker *workers = calloc ((size_t) num_jobs, sizeof (*workers));
+    if (!workers)
+        return ENOMEM;
+
+    /* Without a loader each file is read by its worker. */
+    walk.loader = input_loader_new ();
+
+    pthread_mutex_init (&walk.lock, NULL);
+    pthread_cond_init (&walk.items_changed, NULL);
+
+    int res = 0;
+    for (int root = 0; root < num_roots && !res; ++root)
+    {
+        struct stat root_stat;
+        bool is_dir = !stat (roots[root], &root_stat)
+            && S_ISDIR (root_stat.st_mode);
+        size_t root_len = strlen (roots[root]);
+        char *path = strdup (roots[root]);
+
+        if (is_dir && root_len > 0 && roots[root][root_len - 1] != '/')
+            ++root_len;
+        res = path ? push_item (&walk, path, root_len, is_dir, NULL) : ENOMEM;
+    }
+
+    /* Reversed so the directories are taken in order like the files. */
+    struct walk_item *dirs = NULL;
+    while (walk.stack)
+    {
+        struct walk_item *item = walk.stack;
+        walk.stack = item->next;
+        item->next = dirs;
+        dirs = item;
+    }
+    walk.stack = dirs;
+
+    int started = 0;
+    for (; !res && started < num_jobs; ++started)
+    {
+        workers[started].walk = &walk;
+        workers[started].data = worker_data ? worker_data[started] : NULL;
+        if (num_jobs == 1 || pthread_create (
+                &workers[started].thread, NULL, walk_files_worker,
+                &workers[started]))
+            break;
+    }
+
+    /* Without any thread the calling one does all the work. */
+    if (!res && !started)
+        walk_files_worker (&workers[0]);
+
+    for (int worker = 0; worker < started; ++worker)
+        pthread_join (workers[worker].thread, NULL);
+
+    while (walk.stack || walk.files)
+    {
+        struct walk_item *item = walk.stack ? walk.stack : walk.files;
+        if (item == walk.stack)
+            walk.stack = item->next;
+        else
+            walk.files = item->next;
+        input_load_release (item->load);
+        free (item->path);
+        free (item);
+    }
+    input_loader_free (walk.loader);
+    while (walk.all_ignores)
+    {
+        struct ignore_rules *rules = walk.all_ignores;
+        walk.all_ignores = rules->next;
+        for (size_t pattern = 0; pattern < rules->num_patterns; ++pattern)
+            free (rules->patterns[pattern].glob);
+        free (rules->patterns);
+        free (rules);
+    }
+
+    pthread_cond_destroy (&walk.items_changed);
+    pthread_mutex_destroy (&walk.lock);
+    free (workers);
+
+    return res ? res : walk.write_error;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
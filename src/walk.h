@@ -0,0 +1,62 @@
+/** \file
+ * Walk directory trees on several threads and process the files in them
+ * while walking.
+ */
+
+#ifndef WALK_H_
+#define WALK_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "jobs.h"
+
+/** \struct walk_filter
+ *  \brief Which files in the directory trees are processed.
+ *
+ *  Patterns are shell wildcards as used by \c fnmatch.  A pattern
+ *  containing a <tt>/</tt> is matched against the path relative to the
+ *  directory given on the command line, where <tt>*</tt> also matches
+ *  <tt>/</tt>, else against the file name.
+ *
+ *  \var char **walk_filter::include
+ *      If not empty, only files matching one of these patterns are
+ *      processed.
+ *  \var char **walk_filter::exclude
+ *      Files and directories matching one of these patterns are skipped.
+ *  \var bool walk_filter::gitignore
+ *      Whether files ignored by \c .gitignore files in the walked
+ *      directories are skipped.
+ */
+struct walk_filter
+{
+    char **include;
+    int num_include;
+    char **exclude;
+    int num_exclude;
+    bool gitignore;
+};
+
+bool walk_filter_selects (const struct walk_filter *filter, const char *path);
+int walk_files_parallel (
+    char **roots, int num_roots, const struct walk_filter *filter,
+    FILE *ostr, int num_jobs, input_file_processor *process,
+    void **worker_data);
+
+#endif /* not WALK_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,784 @@
+/** \file
+ * Split the stripped text into words and count them in a hash table with
+ * open addressing.
+ *
+ * A table created by \ref word_counts_new_bounded keeps at most a fixed
+ * number of words with the Space-Saving algorithm: a new word replaces
+ * the word with the lowest count, which is found in a min-heap over the
+ * slots, and starts with its count.  The replaced count is the error of
+ * the new word, by which its count may exceed the true count.
+ *
+ * The words are kept in a \ref string_pool and referred to by their id,
+ * so a table is released without freeing each word.  The hash of a word
+ * is computed once and stored with it. */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "char_class.h"
+#include "domaincloud.h"
+#include "string_pool.h"
+#include "word_filter.h"
+
+/** Initial number of slots of a \ref word_counts table. */
+#define WORD_COUNTS_MIN_CAPACITY 1024
+/** Size of the first chunk of words of an unbounded table. */
+#define WORD_COUNTS_CHUNK_SIZE (64 * 1024)
+
+/** \struct word_entry
+ *  \brief A slot of the \ref word_counts table.  Unused if \a id is 0.
+ *
+ *  \var uint32_t word_entry::id
+ *      The id of the word in \ref word_counts::pool.
+ *  \var unsigned long word_entry::error
+ *      By how much \a count may exceed the true count in a bounded table.
+ *  \var size_t word_entry::heap_pos
+ *      The index of the slot in \ref word_counts::heap.
+ */
+struct word_entry
+{
+    uint64_t hash;
+    uint32_t id;
+    uint32_t len;
+    unsigned long count;
+    unsigned long error;
+    size_t heap_pos;
+};
+
+/** \struct word_counts
+ *  \brief Hash table from words to their number of occurrences.  Uses
+ *      linear probing in a power of two sized array of slots.
+ *
+ *  \var size_t word_counts::size
+ *      Number of used slots.
+ *  \var size_t word_counts::max_words
+ *      The number of words kept by a bounded table, else 0.
+ *  \var size_t *word_counts::heap
+ *      The used slots of a bounded table as min-heap by their count.
+ *      \c NULL if the table is not bounded.
+ *  \var struct string_pool word_counts::pool
+ *      The words.  A bounded table reserves \ref WORD_MAX_LEN chars for
+ *      each word, so a new word replaces a removed one in place.
+ */
+struct word_counts
+{
+    struct word_entry *entries;
+    size_t capacity;
+    size_t size;
+    size_t max_words;
+    size_t *heap;
+    struct string_pool pool;
+};
+
+/** FNV-1a hash of the \a len chars of \a word. */
+static uint64_t
+hash_word (const char *word, size_t len)
+{
+    uint64_t hash = UINT64_C (14695981039346656037);
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        hash ^= (unsigned char) word[pos];
+        hash *= UINT64_C (1099511628211);
+    }
+    return hash;
+}
+
+/** Allocate an empty table.
+ *
+ *  \returns The new table or \c NULL if out of memory.  Release with
+ *      \ref word_counts_free.
+ */
+struct word_counts *
+word_counts_new (void)
+{
+    struct word_counts *counts = malloc (sizeof (*counts));
+    if (!counts)
+        return NULL;
+
+    counts->capacity = WORD_COUNTS_MIN_CAPACITY;
+    counts->size = 0;
+    counts->max_words = 0;
+    counts->heap = NULL;
+    string_pool_init (&counts->pool, WORD_COUNTS_CHUNK_SIZE);
+    counts->entries = calloc (counts->capacity, sizeof (*counts->entries));
+    if (!counts->entries)
+    {
+        free (counts);
+        return NULL;
+    }
+
+    return counts;
+}
+
+/** Allocate an empty table which keeps at most \a max_words words.  Its
+ *  memory doesn't grow after the first \a max_words words.  The counts
+ *  of words added later are approximated, see
+ *  \ref word_counts_error_bound.
+ *
+ *  \returns The new table or \c NULL if out of memory or \a max_words is
+ *      0.  Release with \ref word_counts_free.
+ */
+struct word_counts *
+word_counts_new_bounded (size_t max_words)
+{
+    if (!max_words)
+        return NULL;
+
+    struct word_counts *counts = malloc (sizeof (*counts));
+    if (!counts)
+        return NULL;
+
+    /* Keep the load factor at most 3/4 without growing. */
+    counts->capacity = WORD_COUNTS_MIN_CAPACITY;
+    while (4 * max_words > 3 * counts->capacity)
+        counts->capacity *= 2;
+    counts->size = 0;
+    counts->max_words = max_words;
+    string_pool_init (&counts->pool, max_words * (WORD_MAX_LEN + 1));
+    counts->entries = calloc (counts->capacity, sizeof (*counts->entries));
+    counts->heap = malloc (max_words * sizeof (*counts->heap));
+    if (!counts->entries || !counts->heap)
+    {
+        free (counts->entries);
+        free (counts->heap);
+        free (counts);
+        return NULL;
+    }
+
+    return counts;
+}
+
+/** The number of words a table of \ref word_counts_new_bounded may keep
+ *  in at most \a mem_limit bytes including the words themselves. */
+size_t
+word_counts_max_words (size_t mem_limit)
+{
+    /* A slot, the share of free slots, the heap index and the longest
+     * word with its pointer in the pool. */
+    const size_t word_size = 3 * sizeof (struct word_entry) + sizeof (size_t)
+        + sizeof (char *) + WORD_MAX_LEN + 1;
+    if (mem_limit < sizeof (struct word_counts))
+        return 0;
+    return (mem_limit - sizeof (struct word_counts)) / word_size;
+}
+
+/** Release \a counts and all its words.  \a counts may be \c NULL. */
+void
+word_counts_free (struct word_counts *counts)
+{
+    if (!counts)
+        return;
+
+    string_pool_release (&counts->pool);
+    free (counts->entries);
+    free (counts->heap);
+    free (counts);
+}
+
+/** The slot of \a counts for the word with \a hash and the \a len chars
+ *  of \a word.  This is either the slot with the word or the empty slot
+ *  where it belongs. */
+static struct word_entry *
+find_slot (
+    const struct word_counts *counts, const char *word, size_t len,
+    uint64_t hash)
+{
+    size_t mask = counts->capacity - 1;
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        struct word_entry *entry = &counts->entries[slot];
+        if (!entry->id
+            || (entry->hash == hash && entry->len == len
+                && !memcmp (string_pool_get (&counts->pool, entry->id),
+                            word, len)))
+            return entry;
+    }
+}
+
+/** Exchange the slots at the positions \a lhs and \a rhs of the heap of
+ *  \a counts. */
+static void
+swap_heap (struct word_counts *counts, size_t lhs, size_t rhs)
+{
+    size_t slot = counts->heap[lhs];
+    counts->heap[lhs] = counts->heap[rhs];
+    counts->heap[rhs] = slot;
+    counts->entries[counts->heap[lhs]].heap_pos = lhs;
+    counts->entries[counts->heap[rhs]].heap_pos = rhs;
+}
+
+/** The count of the slot at position \a pos of the heap of \a counts. */
+static unsigned long
+heap_count (const struct word_counts *counts, size_t pos)
+{
+    return counts->entries[counts->heap[pos]].count;
+}
+
+/** Move the slot at \a pos of the heap of \a counts down until its
+ *  children have no lower count. */
+static void
+sift_down (struct word_counts *counts, size_t pos)
+{
+    for (;;)
+    {
+        size_t least = pos;
+        for (size_t child = 2 * pos + 1; child <= 2 * pos + 2; ++child)
+            if (child < counts->size
+                && heap_count (counts, child) < heap_count (counts, least))
+                least = child;
+        if (least == pos)
+            break;
+        swap_heap (counts, pos, least);
+        pos = least;
+    }
+}
+
+/** Restore the heap of \a counts after the count at \a pos changed. */
+static void
+fix_heap (struct word_counts *counts, size_t pos)
+{
+    while (pos > 0 && heap_count (counts, pos) < heap_count (counts, (pos - 1) / 2))
+    {
+        swap_heap (counts, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    sift_down (counts, pos);
+}
+
+/** The lowest count of the bounded table \a counts if it is full, else
+ *  0. */
+static unsigned long
+min_count (const struct word_counts *counts)
+{
+    if (!counts->max_words || counts->size < counts->max_words)
+        return 0;
+    return heap_count (counts, 0);
+}
+
+/** Empty \a slot of \a counts and move the following slots of its probe
+ *  sequence back, so that all words are still found.  The word of the
+ *  slot stays in the pool. */
+static void
+remove_slot (struct word_counts *counts, size_t slot)
+{
+    size_t mask = counts->capacity - 1;
+    size_t hole = slot;
+    for (size_t cur = (slot + 1) & mask; counts->entries[cur].id;
+         cur = (cur + 1) & mask)
+    {
+        /* The word may only move back if its home slot isn't between the
+         * hole and its slot. */
+        size_t home = counts->entries[cur].hash & mask;
+        if (((cur - home) & mask) < ((cur - hole) & mask))
+            continue;
+
+        counts->entries[hole] = counts->entries[cur];
+        if (counts->heap)
+            counts->heap[counts->entries[hole].heap_pos] = hole;
+        hole = cur;
+    }
+    counts->entries[hole].id = 0;
+}
+
+/** Double the capacity of the unbounded table \a counts.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+grow_word_counts (struct word_counts *counts)
+{
+    size_t capacity = counts->capacity * 2;
+    size_t mask = capacity - 1;
+    struct word_entry *entries = calloc (capacity, sizeof (*entries));
+    if (!entries)
+        return ENOMEM;
+
+    /* The words are distinct, so each goes into the first free slot. */
+    for (size_t slot = 0; slot < counts->capacity; ++slot)
+    {
+        const struct word_entry *entry = &counts->entries[slot];
+        if (!entry->id)
+            continue;
+        size_t free_slot = entry->hash & mask;
+        while (entries[free_slot].id)
+            free_slot = (free_slot + 1) & mask;
+        entries[free_slot] = *entry;
+    }
+
+    free (counts->entries);
+    counts->entries = entries;
+    counts->capacity = capacity;
+    return 0;
+}
+
+/** Add \a count occurrences of the \a len chars of \a word with \a hash
+ *  and the \a error of \a count to \a counts.  A new word replaces the
+ *  word with the lowest count of a full bounded table.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+static int
+add_word_count (
+    struct word_counts *counts, const char *word, size_t len, uint64_t hash,
+    unsigned long count, unsigned long error)
+{
+    struct word_entry *entry = find_slot (counts, word, len, hash);
+
+    if (!entry->id)
+    {
+        /* The replaced word may have occurred as often as the new word
+         * before. */
+        bool replace = counts->max_words && counts->size == counts->max_words;
+        unsigned long floor = min_count (counts);
+        size_t heap_pos = counts->size;
+        uint32_t id;
+        if (replace)
+        {
+            size_t slot = counts->heap[0];
+            id = counts->entries[slot].id;
+            string_pool_set (&counts->pool, id, word, len);
+            remove_slot (counts, slot);
+            heap_pos = 0;
+            --counts->size;
+        }
+        else if (string_pool_add (
+                     &counts->pool, word, len,
+                     counts->max_words ? WORD_MAX_LEN + 1 : 0, &id))
+            return ENOMEM;
+        /* Keep the load factor at most 3/4. */
+        else if (4 * (counts->size + 1) > 3 * counts->capacity
+                 && grow_word_counts (counts))
+            return ENOMEM;
+
+        entry = find_slot (counts, word, len, hash);
+        *entry = (struct word_entry) {
+            hash, id, (uint32_t) len, floor, floor, heap_pos};
+        if (counts->heap)
+            counts->heap[heap_pos] = (size_t) (entry - counts->entries);
+        ++counts->size;
+    }
+
+    entry->count += count;
+    entry->error += error;
+    if (counts->heap)
+        fix_heap (counts, entry->heap_pos);
+    return 0;
+}
+
+/** Add \a count occurrences of the \a len chars of \a word to \a counts.
+ *  Longer words are cut to \ref WORD_MAX_LEN chars.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+int
+word_counts_add (
+    struct word_counts *counts, const char *word, size_t len,
+    unsigned long count)
+{
+    if (len > WORD_MAX_LEN)
+        len = WORD_MAX_LEN;
+    return add_word_count (
+        counts, word, len, hash_word (word, len), count, 0);
+}
+
+/** Add all words of \a from to \a into.  If \a from is a full bounded
+ *  table, the words of \a into which it doesn't keep may have occurred
+ *  as often as its lowest count, which is added to their count and
+ *  error.
+ *
+ *  \returns \c ENOMEM if out of memory else 0.
+ */
+int
+word_counts_merge (struct word_counts *into, const struct word_counts *from)
+{
+    unsigned long floor = min_count (from);
+    if (floor)
+    {
+        for (size_t slot = 0; slot < into->capacity; ++slot)
+        {
+            struct word_entry *entry = &into->entries[slot];
+            if (entry->id
+                && !find_slot (
+                    from, string_pool_get (&into->pool, entry->id),
+                    entry->len, entry->hash)->id)
+            {
+                entry->count += floor;
+                entry->error += floor;
+            }
+        }
+        for (size_t pos = into->size / 2 + 1; into->heap && pos-- > 0; )
+            sift_down (into, pos);
+    }
+
+    for (size_t slot = 0; slot < from->capacity; ++slot)
+    {
+        const struct word_entry *entry = &from->entries[slot];
+        if (entry->id
+            && add_word_count (
+                into, string_pool_get (&from->pool, entry->id), entry->len,
+                entry->hash, entry->count, entry->error))
+            return ENOMEM;
+    }
+
+    return 0;
+}
+
+/** Whether \a counts approximates the counts, see
+ *  \ref word_counts_new_bounded. */
+bool
+word_counts_is_bounded (const struct word_counts *counts)
+{
+    return counts->max_words;
+}
+
+/** The highest count a word which is not in \a counts may have.  This is
+ *  the lowest count of a full bounded table, else 0. */
+unsigned long
+word_counts_error_bound (const struct word_counts *counts)
+{
+    return min_count (counts);
+}
+
+/** The number of different words in \a counts. */
+size_t
+word_counts_size (const struct word_counts *counts)
+{
+    return counts->size;
+}
+
+/** Order \ref word_count by descending count and then by word. */
+static int
+compare_word_counts (const void *lhs_arg, const void *rhs_arg)
+{
+    const struct word_count *lhs = lhs_arg;
+    const struct word_count *rhs = rhs_arg;
+
+    if (lhs->count != rhs->count)
+        return lhs->count < rhs->count ? 1 : -1;
+    return strcmp (lhs->word, rhs->word);
+}
+
+/** All words of \a counts, the most frequent first.  Words with the same
+ *  count are sorted alphabetically.
+ *
+ *  \returns An array of \ref word_counts_size entries or \c NULL if out of
+ *      memory.  The array has to be freed; the words belong to \a counts.
+ */
+struct word_count *
+word_counts_sorted (const struct word_counts *counts)
+{
+    struct word_count *sorted =
+        malloc ((counts->size ? counts->size : 1) * sizeof (*sorted));
+    if (!sorted)
+        return NULL;
+
+    size_t num_words = 0;
+    for (size_t slot = 0; slot < counts->capacity; ++slot)
+    {
+        const struct word_entry *entry = &counts->entries[slot];
+        if (entry->id)
+            sorted[num_words++] = (struct word_count) {
+                string_pool_get (&counts->pool, entry->id), entry->len,
+                entry->count, entry->error};
+    }
+
+    qsort (sorted, num_words, sizeof (*sorted), compare_word_counts);
+    return sorted;
+}
+
+/** Write the \a max_words most frequent words of \a counts to \a ostr,
+ *  one word per line followed by a tab and its count.  Write all words if
+ *  \a max_words is 0.  For bounded tables the error of the count follows
+ *  after another tab.
+ *
+ *  \returns \a errno if some I/O error occurred, \c ENOMEM if out of
+ *      memory else 0.
+ */
+int
+word_counts_print (
+    const struct word_counts *counts, size_t max_words, FILE *ostr)
+{
+    struct word_count *sorted = word_counts_sorted (counts);
+    if (!sorted)
+        return ENOMEM;
+
+    if (!max_words || max_words > counts->size)
+        max_words = counts->size;
+
+    for (size_t word = 0; word < max_words; ++word)
+        if (counts->max_words)
+            fprintf (ostr, "%s\t%lu\t%lu\n", sorted[word].word,
+                     sorted[word].count, sorted[word].error);
+        else
+            fprintf (ostr, "%s\t%lu\n", sorted[word].word, sorted[word].count);
+    free (sorted);
+
+    if (fflush (ostr) || ferror (ostr))
+        return errno ? errno : EIO;
+    return 0;
+}
+
+/** Whether \a cur can be part of a word.  Bytes of multibyte UTF-8
+ *  sequences count as letters. */
+static inline bool
+is_word_char (char cur)
+{
+    return char_is (cur, CHAR_IDENT);
+}
+
+/** A word sink of \ref word_tokenizer which counts the word in the
+ *  \ref word_counts passed as \a counts. */
+static int
+add_word (const char *word, size_t len, void *counts)
+{
+    return word_counts_add (counts, word, len, 1);
+}
+
+/** Initialize \a tokenizer to count the words into \a counts. */
+void
+word_tokenizer_init (
+    struct word_tokenizer *tokenizer, struct word_counts *counts)
+{
+    word_tokenizer_init_sink (tokenizer, add_word, counts);
+}
+
+/** Initialize \a tokenizer to pass each word to \a word_sink with
+ *  \a sink_data. */
+void
+word_tokenizer_init_sink (
+    struct word_tokenizer *tokenizer, clutter_sink *word_sink,
+    void *sink_data)
+{
+    tokenizer->word_sink = word_sink;
+    tokenizer->sink_data = sink_data;
+    tokenizer->keywords = NULL;
+    tokenizer->stopwords = NULL;
+    tokenizer->split = false;
+    tokenizer->len = 0;
+    tokenizer->in_word = false;
+}
+
+/** Drop the words of \a keywords and \a stopwords instead of passing
+ *  them to the word sink of \a tokenizer.  Either may be \c NULL. */
+void
+word_tokenizer_set_filters (
+    struct word_tokenizer *tokenizer, const struct word_filter *keywords,
+    const struct word_filter *stopwords)
+{
+    tokenizer->keywords = keywords;
+    tokenizer->stopwords = stopwords;
+}
+
+/** Split the words of \a tokenizer into the parts of identifiers if
+ *  \a split, e.g. \c parseCliOptions and \c parse_cli_options into
+ *  \c parse, \c cli and \c options. */
+void
+word_tokenizer_set_split (struct word_tokenizer *tokenizer, bool split)
+{
+    tokenizer->split = split;
+}
+
+/** Whether the word from \a start to \a end is counted at all: it is
+ *  long enough, doesn't start with a digit and isn't filtered. */
+static inline bool
+is_counted (
+    const struct word_tokenizer *tokenizer, const char *start, size_t len)
+{
+    return len >= WORD_MIN_LEN && char_is (*start, CHAR_IDENT_START)
+        && !word_filter_lookup (tokenizer->keywords, start, len)
+        && !word_filter_lookup (tokenizer->stopwords, start, len);
+}
+
+/** Whether \a cur is a letter which is not a capital. */
+static inline bool
+is_lower (char cur)
+{
+    return char_is (cur, CHAR_IDENT_START) && !char_is (cur, CHAR_UPPER)
+        && cur != '_';
+}
+
+/** Whether a part of an identifier starts at \a pos, which is preceded
+ *  by a char of the same part and followed by \a end.  Parts change
+ *  between letters and digits and start at a capital after a small
+ *  letter or at the last capital of an acronym before a small letter. */
+static inline bool
+starts_part (const char *pos, const char *end)
+{
+    char prev = pos[-1];
+    char cur = *pos;
+    if (char_is (prev, CHAR_IDENT_START) != char_is (cur, CHAR_IDENT_START))
+        return true;
+    if (!char_is (cur, CHAR_UPPER))
+        return false;
+    return is_lower (prev)
+        || (char_is (prev, CHAR_UPPER) && pos + 1 < end && is_lower (pos[1]));
+}
+
+/** Pass the part of an identifier from \a start to \a end in small
+ *  letters to the word sink of \a tokenizer if it is counted.  Parts
+ *  without capitals are passed as they are, others are copied to
+ *  \ref word_tokenizer::part. */
+static int
+count_part (
+    struct word_tokenizer *tokenizer, const char *start, const char *end)
+{
+    size_t len = (size_t) (end - start);
+    if (len > WORD_MAX_LEN)
+        len = WORD_MAX_LEN;
+
+    const char *part = start;
+    for (size_t i = 0; i < len; ++i)
+        if (char_is (start[i], CHAR_UPPER))
+        {
+            memcpy (tokenizer->part, start, i);
+            for (; i < len; ++i)
+                tokenizer->part[i] = char_is (start[i], CHAR_UPPER)
+                    ? (char) (start[i] | 0x20) : start[i];
+            part = tokenizer->part;
+        }
+
+    if (!is_counted (tokenizer, part, len))
+        return 0;
+    return tokenizer->word_sink (part, len, tokenizer->sink_data);
+}
+
+/** Pass the parts of the identifier from \a start to \a end to
+ *  \ref count_part.  Underscores separate parts and are dropped. */
+static int
+split_word (
+    struct word_tokenizer *tokenizer, const char *start, const char *end)
+{
+    const char *part = start;
+    int res = 0;
+
+    for (const char *pos = start; pos < end && !res; ++pos)
+        if (*pos == '_')
+        {
+            res = count_part (tokenizer, part, pos);
+            part = pos + 1;
+        }
+        else if (pos > part && starts_part (pos, end))
+        {
+            res = count_part (tokenizer, part, pos);
+            part = pos;
+        }
+
+    if (!res)
+        res = count_part (tokenizer, part, end);
+    return res;
+}
+
+/** Pass the word from \a start to \a end to the word sink if it is
+ *  counted, split into parts if \ref word_tokenizer::split is set.
+ *  Longer words are cut to \ref WORD_MAX_LEN chars, like the words
+ *  split between texts by \ref append_word_part. */
+static int
+count_word (
+    struct word_tokenizer *tokenizer, const char *start, const char *end)
+{
+    size_t len = (size_t) (end - start);
+    if (len > WORD_MAX_LEN)
+        len = WORD_MAX_LEN;
+    if (!is_counted (tokenizer, start, len))
+        return 0;
+    if (tokenizer->split)
+        return split_word (tokenizer, start, start + len);
+    return tokenizer->word_sink (start, len, tokenizer->sink_data);
+}
+
+/** Append the chars from \a start to \a end to the word collected by
+ *  \a tokenizer.  Chars beyond \ref WORD_MAX_LEN are dropped. */
+static void
+append_word_part (
+    struct word_tokenizer *tokenizer, const char *start, const char *end)
+{
+    size_t len = (size_t) (end - start);
+    if (len > WORD_MAX_LEN - tokenizer->len)
+        len = WORD_MAX_LEN - tokenizer->len;
+
+    memcpy (tokenizer->word + tokenizer->len, start, len);
+    tokenizer->len += len;
+    tokenizer->in_word = true;
+}
+
+/** A \ref clutter_sink which counts the words of \a text in the
+ *  \ref word_tokenizer passed as \a tokenizer_arg.  A word is a run of
+ *  letters, digits and underscores of at least \ref WORD_MIN_LEN chars
+ *  which doesn't start with a digit.  Words may be split between calls.
+ *
+ *  \returns The first error of the word sink, e.g. \c ENOMEM if out of
+ *      memory, else 0.
+ */
+int
+count_words (const char *text, size_t len, void *tokenizer_arg)
+{
+    struct word_tokenizer *tokenizer = tokenizer_arg;
+    const char *pos = text;
+    const char *end = text + len;
+    int res = 0;
+
+    while (pos < end && !res)
+    {
+        if (!tokenizer->in_word)
+        {
+            while (pos < end && !is_word_char (*pos))
+                ++pos;
+            if (pos == end)
+                break;
+        }
+
+        const char *start = pos;
+        while (pos < end && is_word_char (*pos))
+            ++pos;
+
+        if (!tokenizer->in_word && pos < end)
+            res = count_word (tokenizer, start, pos);
+        else
+        {
+            /* Keep the start of a word which may continue in the next
+             * text. */
+            append_word_part (tokenizer, start, pos);
+            if (pos < end)
+                res = word_tokenizer_end (tokenizer);
+        }
+    }
+
+    return res;
+}
+
+/** Count the word at the end of the text passed to \ref count_words.
+ *
+ *  \returns The error of the word sink, e.g. \c ENOMEM if out of memory,
+ *      else 0.
+ */
+int
+word_tokenizer_end (struct word_tokenizer *tokenizer)
+{
+    int res = 0;
+    if (tokenizer->in_word)
+        res = count_word (
+            tokenizer, tokenizer->word, tokenizer->word + tokenizer->len);
+
+    tokenizer->len = 0;
+    tokenizer->in_word = false;
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,347 @@
+/** \file
+ * Build and look up the minimal perfect hashes of \ref word_filter.
+ *
+ * The words are distributed into as many buckets as there are words by a
+ * first hash.  Starting with the largest bucket, the words of each bucket
+ * are placed into free slots by a second hash whose seed is searched and
+ * stored for the bucket.  Words alone in their bucket take the remaining
+ * free slots directly.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "word_filter.h"
+
+/** Seeds tried for a bucket before the words are assumed not to be
+ *  distinct. */
+#define MAX_SEED (1 << 20)
+
+/** Try to place the words of the bucket \a words, linked by \a next, with
+ *  \a seed into the slots which are not \a used.
+ *
+ *  \returns Whether all words got distinct free slots, which are then
+ *      put into \a slots.
+ */
+static bool
+try_seed (
+    const char *const *words, const uint16_t *lens, uint32_t num_words,
+    uint32_t first, const uint32_t *next, uint32_t seed,
+    const bool *used, uint32_t *slots)
+{
+    for (uint32_t word = first; word != UINT32_MAX; word = next[word])
+    {
+        uint32_t slot = word_filter_hash (seed, words[word], lens[word])
+            % num_words;
+        if (used[slot])
+            return false;
+        for (uint32_t prev = first; prev != word; prev = next[prev])
+            if (slots[prev] == slot)
+                return false;
+        slots[word] = slot;
+    }
+    return true;
+}
+
+/** Compute the minimal perfect hash of \a num_words distinct words.
+ *
+ *  \param lens The length of each word.
+ *  \param displacements Set to the \a num_words values of
+ *      \ref word_filter::displacements.
+ *  \param slots Set to the slot of each word.
+ *  \returns 0, \c ENOMEM if out of memory or \c EINVAL if the words are
+ *      not distinct.
+ */
+int
+word_filter_place (
+    const char *const *words, const uint16_t *lens, uint32_t num_words,
+    int32_t *displacements, uint32_t *slots)
+{
+    uint32_t *first = malloc (num_words * sizeof (*first));
+    uint32_t *next = malloc (num_words * sizeof (*next));
+    uint32_t *sizes = calloc (num_words, sizeof (*sizes));
+    bool *used = calloc (num_words, sizeof (*used));
+    int res = first && next && sizes && used ? 0 : ENOMEM;
+    uint32_t max_size = 0;
+
+    for (uint32_t bucket = 0; !res && bucket < num_words; ++bucket)
+    {
+        first[bucket] = UINT32_MAX;
+        displacements[bucket] = 0;
+    }
+    for (uint32_t word = 0; !res && word < num_words; ++word)
+    {
+        uint32_t bucket = word_filter_hash (0, words[word], lens[word])
+            % num_words;
+        next[word] = first[bucket];
+        first[bucket] = word;
+        if (++sizes[bucket] > max_size)
+            max_size = sizes[bucket];
+    }
+
+    for (uint32_t size = max_size; !res && size > 1; --size)
+        for (uint32_t bucket = 0; !res && bucket < num_words; ++bucket)
+        {
+            if (sizes[bucket] != size)
+                continue;
+
+            uint32_t seed = 1;
+            while (seed < MAX_SEED && !try_seed (
+                       words, lens, num_words, first[bucket], next, seed,
+                       used, slots))
+                ++seed;
+            if (seed == MAX_SEED)
+                res = EINVAL;
+
+            displacements[bucket] = (int32_t) seed;
+            for (uint32_t word = first[bucket]; word != UINT32_MAX;
+                 word = next[word])
+                used[slots[word]] = true;
+        }
+
+    uint32_t free_slot = 0;
+    for (uint32_t bucket = 0; !res && bucket < num_words; ++bucket)
+    {
+        if (sizes[bucket] != 1)
+            continue;
+
+        while (used[free_slot])
+            ++free_slot;
+        used[free_slot] = true;
+        slots[first[bucket]] = free_slot;
+        displacements[bucket] = -(int32_t) free_slot - 1;
+    }
+
+    free (first);
+    free (next);
+    free (sizes);
+    free (used);
+    return res;
+}
+
+/** Whether the \a len chars of \a word are in \a filter.  Never if
+ *  \a filter is \c NULL. */
+bool
+word_filter_contains (
+    const struct word_filter *filter, const char *word, size_t len)
+{
+    return word_filter_lookup (filter, word, len);
+}
+
+/** \struct filter_word
+ *  \brief A word given to \ref word_filter_new while it is sorted.
+ */
+struct filter_word
+{
+    const char *word;
+    uint16_t len;
+};
+
+static int
+compare_filter_words (const void *lhs_arg, const void *rhs_arg)
+{
+    const struct filter_word *lhs = lhs_arg;
+    const struct filter_word *rhs = rhs_arg;
+    if (lhs->len != rhs->len)
+        return lhs->len < rhs->len ? -1 : 1;
+    return memcmp (lhs->word, rhs->word, lhs->len);
+}
+
+/** Round \a size up to the alignment of pointers. */
+static size_t
+align_size (size_t size)
+{
+    const size_t align = sizeof (void *);
+    return (size + align - 1) / align * align;
+}
+
+/** Create the set of the \a num_words zero terminated \a words.  Words
+ *  may repeat and are cut to \ref WORD_MAX_LEN chars like the words of
+ *  \ref count_words.
+ *
+ *  \returns The set, which is released with \ref word_filter_free, or
+ *      \c NULL with \a errno set.
+ */
+struct word_filter *
+word_filter_new (const char *const *words, size_t num_words)
+{
+    if (num_words >= INT32_MAX)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct filter_word *sorted = malloc (
+        (num_words ? num_words : 1) * sizeof (*sorted));
+    if (!sorted)
+        return NULL;
+
+    for (size_t i = 0; i < num_words; ++i)
+    {
+        size_t len = strlen (words[i]);
+        sorted[i].word = words[i];
+        sorted[i].len = (uint16_t) (len < WORD_MAX_LEN ? len : WORD_MAX_LEN);
+    }
+    qsort (sorted, num_words, sizeof (*sorted), compare_filter_words);
+
+    uint32_t num_unique = 0;
+    size_t chars_size = 0;
+    for (size_t i = 0; i < num_words; ++i)
+        if (!num_unique
+            || compare_filter_words (&sorted[num_unique - 1], &sorted[i]))
+        {
+            sorted[num_unique++] = sorted[i];
+            chars_size += sorted[i].len;
+        }
+
+    /* The filter and its arrays are one block. */
+    size_t displacements_offset = align_size (sizeof (struct word_filter));
+    size_t words_offset = align_size (
+        displacements_offset + num_unique * sizeof (int32_t));
+    size_t lens_offset = words_offset + num_unique * sizeof (char *);
+    size_t chars_offset = lens_offset + num_unique * sizeof (uint16_t);
+    char *block = malloc (chars_offset + chars_size);
+    const char **unique_words = malloc (
+        (num_unique ? num_unique : 1) * sizeof (*unique_words));
+    uint16_t *unique_lens = malloc (
+        (num_unique ? num_unique : 1) * sizeof (*unique_lens));
+    uint32_t *slots = malloc ((num_unique ? num_unique : 1) * sizeof (*slots));
+    int res = block && unique_words && unique_lens && slots ? 0 : ENOMEM;
+
+    struct word_filter *filter = (struct word_filter *) block;
+    if (!res)
+    {
+        for (uint32_t i = 0; i < num_unique; ++i)
+        {
+            unique_words[i] = sorted[i].word;
+            unique_lens[i] = sorted[i].len;
+        }
+        res = word_filter_place (
+            unique_words, unique_lens, num_unique,
+            (int32_t *) (block + displacements_offset), slots);
+    }
+
+    if (!res)
+    {
+        const char **slot_words = (const char **) (block + words_offset);
+        uint16_t *slot_lens = (uint16_t *) (block + lens_offset);
+        char *chars = block + chars_offset;
+        filter->num_words = num_unique;
+        filter->max_len = 0;
+        filter->displacements = (const int32_t *) (block + displacements_offset);
+        filter->words = slot_words;
+        filter->lens = slot_lens;
+
+        for (uint32_t i = 0; i < num_unique; ++i)
+        {
+            memcpy (chars, unique_words[i], unique_lens[i]);
+            slot_words[slots[i]] = chars;
+            slot_lens[slots[i]] = unique_lens[i];
+            if (unique_lens[i] > filter->max_len)
+                filter->max_len = unique_lens[i];
+            chars += unique_lens[i];
+        }
+    }
+
+    free (sorted);
+    free (unique_words);
+    free (unique_lens);
+    free (slots);
+    if (res)
+    {
+        free (block);
+        errno = res;
+        return NULL;
+    }
+    return filter;
+}
+
+/** Release \a filter created by \ref word_filter_new. */
+void
+word_filter_free (struct word_filter *filter)
+{
+    free (filter);
+}
+
+/** Read the words separated by white space from the file \a file_name
+ *  into a new set.  A \c # starts a comment up to the end of the line.
+ *
+ *  \param filter Set to the new set, which is released with
+ *      \ref word_filter_free.
+ *  \returns \a errno if the file can't be read, \c ENOMEM if out of
+ *      memory, else 0.
+ */
+int
+word_filter_read (const char *file_name, struct word_filter **filter)
+{
+    FILE *istr = fopen (file_name, "r");
+    if (!istr)
+        return errno;
+
+    char **words = NULL;
+    size_t num_words = 0;
+    size_t capacity = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    int res = 0;
+
+    while (!res && getline (&line, &line_size, istr) > 0)
+    {
+        line[strcspn (line, "#")] = '\0';
+        char *save = NULL;
+        for (char *word = strtok_r (line, " \t\n\v\f\r", &save);
+             word && !res; word = strtok_r (NULL, " \t\n\v\f\r", &save))
+        {
+            if (num_words == capacity)
+            {
+                size_t new_capacity = capacity ? 2 * capacity : 64;
+                char **new_words = realloc (
+                    words, new_capacity * sizeof (*words));
+                if (!new_words)
+                {
+                    res = ENOMEM;
+                    break;
+                }
+                words = new_words;
+                capacity = new_capacity;
+            }
+            if (!(words[num_words] = strdup (word)))
+                res = ENOMEM;
+            else
+                ++num_words;
+        }
+    }
+    if (!res && ferror (istr))
+        res = errno ? errno : EIO;
+    fclose (istr);
+    free (line);
+
+    if (!res && !(*filter = word_filter_new (
+                      (const char *const *) words, num_words)))
+        res = errno;
+
+    for (size_t i = 0; i < num_words; ++i)
+        free (words[i]);
+    free (words);
+    return res;
+}
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,99 @@
+/** \file
+ * Sets of words which are not counted, looked up with a minimal perfect
+ * hash.
+ *
+ * The built-in keyword sets of the languages are placed at build time by
+ * gen_lang_tables, sets read from files by \ref word_filter_new.  Both use
+ * \ref word_filter_place, so a lookup costs at most two hashes and one
+ * comparison.
+ */
+
+#ifndef WORD_FILTER_H_
+#define WORD_FILTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** \struct word_filter
+ *  \brief A set of words.
+ *
+ *  A word is looked up in slot \c word_filter_hash(d, word) % num_words
+ *  with <tt>d = displacements[word_filter_hash(0, word) % num_words]</tt>
+ *  if \c d is not negative, else in slot <tt>-d - 1</tt>.
+ *
+ *  \var uint16_t word_filter::max_len
+ *      The length of the longest word, longer words are rejected without
+ *      hashing.
+ *  \var const int32_t *word_filter::displacements
+ *      The seed or slot for each first hash.
+ *  \var const char *const *word_filter::words
+ *      The word in each slot.
+ *  \var const uint16_t *word_filter::lens
+ *      The length of the word in each slot.
+ */
+struct word_filter
+{
+    uint32_t num_words;
+    uint16_t max_len;
+    const int32_t *displacements;
+    const char *const *words;
+    const uint16_t *lens;
+};
+
+/** The hash of the \a len chars of \a word with \a seed: FNV-1a followed
+ *  by a final mix, so that the seeds give independent hashes. */
+static inline uint32_t
+word_filter_hash (uint32_t seed, const char *word, size_t len)
+{
+    uint32_t hash = UINT32_C (2166136261) ^ (seed * UINT32_C (0x9E3779B9));
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned char) word[i]) * UINT32_C (16777619);
+
+    hash ^= hash >> 16;
+    hash *= UINT32_C (0x85EBCA6B);
+    hash ^= hash >> 13;
+    return hash;
+}
+
+/** \ref word_filter_contains for the tokenizer, which inlines it. */
+static inline bool
+word_filter_lookup (
+    const struct word_filter *filter, const char *word, size_t len)
+{
+    if (!filter || !filter->num_words || len > filter->max_len)
+        return false;
+
+    int32_t displacement = filter->displacements[
+        word_filter_hash (0, word, len) % filter->num_words];
+    uint32_t slot = displacement < 0
+        ? (uint32_t) (-displacement - 1)
+        : word_filter_hash ((uint32_t) displacement, word, len)
+            % filter->num_words;
+
+    return filter->lens[slot] == len
+        && !memcmp (filter->words[slot], word, len);
+}
+
+int word_filter_place (
+    const char *const *words, const uint16_t *lens, uint32_t num_words,
+    int32_t *displacements, uint32_t *slots);
+
+#endif /* not WORD_FILTER_H_ */
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,249 @@
+/** \file
+ * Tests for reading the members of tar and zip archives. */
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "cminitests.h"
+
+/** \struct member_log
+ *  \brief What the visitor of the tests has seen.
+ *
+ *  \var const char *member_log::skip
+ *      Members matching this pattern are not selected.
+ *  \var char member_log::text[]
+ *      For each member its name, a colon, its text and a semicolon.
+ */
+struct member_log
+{
+    const char *skip;
+    int begun;
+    int ended;
+    size_t len;
+    char text[4096];
+};
+
+bool
+log_select (const char *name, void *log_data)
+{
+    struct member_log *log = log_data;
+    return !log->skip || fnmatch (log->skip, name, 0);
+}
+
+int
+log_append (const char *text, size_t len, void *log_data)
+{
+    struct member_log *log = log_data;
+    if (log->len + len >= sizeof (log->text))
+        return ENOSPC;
+    memcpy (log->text + log->len, text, len);
+    log->len += len;
+    log->text[log->len] = '\0';
+    return 0;
+}
+
+int
+log_begin (const char *name, void *log_data)
+{
+    struct member_log *log = log_data;
+    ++log->begun;
+    int res = log_append (name, strlen (name), log);
+    return res ? res : log_append (":", 1, log);
+}
+
+int
+log_end (void *log_data)
+{
+    struct member_log *log = log_data;
+    ++log->ended;
+    return log_append (";", 1, log);
+}
+
+/** The content of \a file_name or \c NULL.  Release with \c free. */
+char *
+read_whole_file (const char *file_name, size_t *len)
+{
+    int fd = open (file_name, O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat (fd, &file_stat))
+        return NULL;
+
+    *len = (size_t) file_stat.st_size;
+    char *data = malloc (*len + 1);
+    if (data && read (fd, data, *len) != (ssize_t) *len)
+    {
+        free (data);
+        data = NULL;
+    }
+    close (fd);
+    return data;
+}
+
+/** Create the archive \a archive_name in a new directory of sources by
+ *  the shell \a command, which is run inside the directory, and read its
+ *  members into \a log.
+ *
+ *  \param truncate If not 0, read only the first \a truncate chars.
+ *  \returns The result of \ref archive_read or -1 if the archive can't
+ *      be created.
+ */
+int
+read_new_archive (
+    const char *archive_name, const char *command, size_t truncate,
+    struct member_log *log)
+{
+    char dir[] = "/tmp/test_archiveXXXXXX";
+    if (!mkdtemp (dir))
+        return -1;
+
+    char *script;
+    if (asprintf (
+            &script, "cd '%s' && mkdir -p src/sub && "
+            "echo 'int alpha;' >src/a.c && "
+            "printf 'beta\\n' >src/sub/b.py && "
+            "printf '\\377\\330binary' >src/logo.png && %s", dir, command) < 0)
+        return -1;
+    int status = system (script);
+    free (script);
+
+    char *archive_file;
+    if (asprintf (&archive_file, "%s/%s", dir, archive_name) < 0)
+        return -1;
+    size_t len = 0;
+    char *archive = status ? NULL : read_whole_file (archive_file, &len);
+    free (archive_file);
+
+    int res = -1;
+    if (archive)
+    {
+        struct archive_visitor visitor = {
+            log_select, log_begin, log_append, log_end, log};
+        res = archive_read (
+            archive_format_for_file (archive_name), archive,
+            truncate ? truncate : len, &visitor);
+    }
+    free (archive);
+
+    char *cleanup;
+    if (asprintf (&cleanup, "rm -rf '%s'", dir) > 0)
+        system (cleanup);
+    free (cleanup);
+    return res;
+}
+
+char *
+Archives_are_known_by_their_suffix (void)
+{
+    require (archive_format_for_file ("a/release.tar") == ARCHIVE_TAR,)
+    require (archive_format_for_file ("release.tar.gz") == ARCHIVE_TAR,)
+    require (archive_format_for_file ("release.tgz") == ARCHIVE_TAR,)
+    require (archive_format_for_file ("release.tar.xz") == ARCHIVE_TAR,)
+    require (archive_format_for_file ("release.zip") == ARCHIVE_ZIP,)
+    require (archive_format_for_file ("main.c") == ARCHIVE_NONE,)
+    require (archive_format_for_file ("main.c.gz") == ARCHIVE_NONE,)
+    require (archive_format_for_file (".tar") == ARCHIVE_NONE,)
+    return NULL;
+}
+
+char *
+Tar_members_are_read_in_order (void)
+{
+    struct member_log log = {"*.png", 0, 0, 0, ""};
+    int res = read_new_archive (
+        "src.tar", "tar cf src.tar src/a.c src/logo.png src/sub", 0, &log);
+    require (res == 0, "%d", res)
+    require_streq (log.text, "src/a.c:int alpha;\n;src/sub/b.py:beta\n;")
+    require (log.begun == 2 && log.ended == 2,)
+    return NULL;
+}
+
+char *
+Compressed_tar_members_with_long_names_are_read (void)
+{
+    struct member_log log = {NULL, 0, 0, 0, ""};
+    const char *command =
+        "d=src/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+        "/bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        " && mkdir -p $d && echo gamma >$d/c.sh && "
+        "tar --format=gnu -czf src.tgz ./src/a.c $d";
+    int res = read_new_archive ("src.tgz", command, 0, &log);
+    require (res == 0, "%d", res)
+    require (!strncmp (log.text, "src/a.c:int alpha;\n;src/aaaa", 28),
+             "%s", log.text)
+    require (strstr (log.text, "bbbb/c.sh:gamma\n;"), "%s", log.text)
+
+    struct member_log pax_log = {NULL, 0, 0, 0, ""};
+    command =
+        "d=src/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+        "/bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+        "/cccc && mkdir -p $d && echo gamma >$d/c.sh && "
+        "tar --format=pax -cf src.tar $d";
+    res = read_new_archive ("src.tar", command, 0, &pax_log);
+    require (res == 0, "%d", res)
+    require (strstr (pax_log.text, "bbbb/cccc/c.sh:gamma\n;"),
+             "%s", pax_log.text)
+    return NULL;
+}
+
+char *
+Zip_members_are_read_without_inflating_skipped_ones (void)
+{
+    struct member_log log = {"*.png", 0, 0, 0, ""};
+    int res = read_new_archive ("src.zip", "zip -qr src.zip src", 0, &log);
+    require (res == 0, "%d", res)
+    require (strstr (log.text, "src/a.c:int alpha;\n;"), "%s", log.text)
+    require (strstr (log.text, "src/sub/b.py:beta\n;"), "%s", log.text)
+    require (log.begun == 2 && log.ended == 2,)
+
+    struct member_log stored_log = {NULL, 0, 0, 0, ""};
+    res = read_new_archive (
+        "src.zip", "zip -q0 src.zip src/a.c src/logo.png", 0, &stored_log);
+    require (res == 0, "%d", res)
+    require_streq (
+        stored_log.text, "src/a.c:int alpha;\n;src/logo.png:\377\330binary;")
+    return NULL;
+}
+
+char *
+Truncated_archives_are_invalid (void)
+{
+    struct member_log log = {NULL, 0, 0, 0, ""};
+    require (read_new_archive (
+                 "src.tar", "tar cf src.tar src", 700, &log) == EINVAL,)
+    require (read_new_archive (
+                 "src.zip", "zip -qr src.zip src", 100, &log) == EINVAL,)
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Archives_are_known_by_their_suffix,)
+    CMT_TEST_CASE (Tar_members_are_read_in_order,)
+    CMT_TEST_CASE (Compressed_tar_members_with_long_names_are_read,)
+    CMT_TEST_CASE (Zip_members_are_read_without_inflating_skipped_ones,)
+    CMT_TEST_CASE (Truncated_archives_are_invalid,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
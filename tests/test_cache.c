@@ -0,0 +1,107 @@
+/** \file
+ * Tests for the cache of stripped text. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "cminitests.h"
+
+/** A fake \c stat of a file with \a size bytes and the inode \a ino. */
+struct stat
+fake_stat (size_t size, ino_t ino)
+{
+    struct stat file_stat;
+    memset (&file_stat, 0, sizeof (file_stat));
+    file_stat.st_ino = ino;
+    file_stat.st_size = (off_t) size;
+    file_stat.st_mtim.tv_sec = 1500000000;
+    return file_stat;
+}
+
+char *
+Text_is_found_by_stat_and_by_content (void)
+{
+    char dir[] = "/tmp/test_cache_XXXXXX";
+    require (mkdtemp (dir),)
+    struct file_cache *cache = file_cache_open (dir);
+    require (cache,)
+
+    const char content[] = "int /* foo */ bar;";
+    const char stripped[] = "int bar;";
+    struct stat file_stat = fake_stat (sizeof (content) - 1, 42);
+    char *text = NULL;
+    size_t text_len = 0;
+
+    require (file_cache_find_stat (cache, &file_stat, "c", &text, &text_len)
+             == ENOENT,)
+    require (file_cache_add (
+                 cache, &file_stat, "c", content, sizeof (content) - 1,
+                 stripped, sizeof (stripped) - 1) == 0,)
+
+    require (file_cache_find_stat (cache, &file_stat, "c", &text, &text_len) == 0,)
+    require (text_len == sizeof (stripped) - 1,)
+    require (!memcmp (text, stripped, text_len),)
+    free (text);
+
+    /* A touched copy of the file is found by its content only. */
+    struct stat copy_stat = fake_stat (sizeof (content) - 1, 43);
+    copy_stat.st_mtim.tv_sec++;
+    require (file_cache_find_stat (cache, &copy_stat, "c", &text, &text_len)
+             == ENOENT,)
+    require (file_cache_find_content (
+                 cache, &copy_stat, "c", content, sizeof (content) - 1,
+                 &text, &text_len) == 0,)
+    require (!memcmp (text, stripped, text_len),)
+    free (text);
+    require (file_cache_find_stat (cache, &copy_stat, "c", &text, &text_len) == 0,)
+    free (text);
+
+    /* The text of another language is not found. */
+    require (file_cache_find_stat (cache, &copy_stat, "python", &text, &text_len)
+             == ENOENT,)
+    require (file_cache_find_content (
+                 cache, &copy_stat, "python", content, sizeof (content) - 1,
+                 &text, &text_len) == ENOENT,)
+
+    /* Changed files are not found. */
+    const char changed[] = "int /* foo */ baz;";
+    file_stat.st_mtim.tv_nsec++;
+    require (file_cache_find_stat (cache, &file_stat, "c", &text, &text_len)
+             == ENOENT,)
+    require (file_cache_find_content (
+                 cache, &file_stat, "c", changed, sizeof (changed) - 1,
+                 &text, &text_len) == ENOENT,)
+
+    file_cache_close (cache);
+    char *cmd;
+    require (asprintf (&cmd, "rm -r '%s'", dir) > 0,)
+    require (system (cmd) == 0,)
+    free (cmd);
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Text_is_found_by_stat_and_by_content,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,69 @@
+/** \file
+ * Tests for the locale independent byte classes. */
+#include <ctype.h>
+#include <locale.h>
+
+#include "char_class.h"
+#include "cminitests.h"
+
+char *
+ASCII_classes_match_the_C_locale (void)
+{
+    require (setlocale (LC_CTYPE, "C"),)
+
+    for (int byte = 0; byte < 0x80; ++byte)
+    {
+        char cur = (char) byte;
+        require (char_is (cur, CHAR_SPACE) == !!isspace (byte),)
+        require (char_is (cur, CHAR_IDENT_START)
+                 == (isalpha (byte) || byte == '_'),)
+        require (char_is (cur, CHAR_IDENT)
+                 == (isalnum (byte) || byte == '_'),)
+        require (char_is (cur, CHAR_QUOTE) == (byte == '"' || byte == '\''),)
+        require (char_is (cur, CHAR_SLASH) == (byte == '/'),)
+        require (char_is (cur, CHAR_STAR) == (byte == '*'),)
+        require (char_is (cur, CHAR_BACKSLASH) == (byte == '\\'),)
+        require (char_is (cur, CHAR_UPPER) == !!isupper (byte),)
+    }
+
+    return NULL;
+}
+
+char *
+Non_ASCII_bytes_are_letters (void)
+{
+    for (int byte = 0x80; byte < 0x100; ++byte)
+    {
+        require (char_is ((char) byte, CHAR_IDENT_START),)
+        require (char_is ((char) byte, CHAR_IDENT),)
+        require (!char_is (
+                     (char) byte, CHAR_SPACE | CHAR_CLUTTER_START | CHAR_UPPER),)
+    }
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (ASCII_classes_match_the_C_locale,)
+    CMT_TEST_CASE (Non_ASCII_bytes_are_letters,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -51,6 +51,26 @@ echo "/* skip */some words" | "$prog" -S -o - - | grep -q "some words"
 test_exit=$?
 evaluate_test
 
+test_case="Program reads named pipes like files"
+fifo="`mktemp -u`"
+mkfifo "$fifo"
+echo "/* skip */some words" >"$fifo" &
+"$prog" -S -o - "$fifo" | grep -q "^some words"
+test_exit=$?
+wait
+rm -f "$fifo"
+evaluate_test
+
+test_case="Program strips compressed files by their inner extension"
+gz_file="`mktemp -u`.py.gz"
+printf '# skip\nsome words\n' | gzip >"$gz_file"
+"$prog" -S -o - "$gz_file" >"$output_file"
+res=$?
+grep -q "some words" "$output_file" && ! grep -q "skip" "$output_file"
+test_exit=`expr $res + $?`
+rm -f "$gz_file"
+evaluate_test
+
 test_case="Program writes output to given file"
 echo "some words" >"$input_file"
 : > "$output_file"
@@ -60,8 +80,263 @@ cat "$output_file" | grep -q "some words"
 test_exit=`expr $res + $?`
 evaluate_test
 
-# TODO Create a mock for word_cloud_cli.py: Tests without -S options require
-# this program which also needs a lot of time
+test_case="Parallel jobs write the output in the order of the input files"
+input_file2="`mktemp`"
+echo "first /* skip */ words" >"$input_file"
+echo "second 'skip' words" >"$input_file2"
+"$prog" -S -j 4 "$input_file" "$input_file2" "$input_file" >"$output_file"
+res=$?
+"$prog" -S "$input_file" "$input_file2" "$input_file" | cmp -s - "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -f "$input_file2"
+
+test_case="Parallel jobs read '-' from standard input"
+dash_dir="`mktemp -d`"
+echo "file_word" >"$dash_dir/-"
+echo "stdin_word" >"$dash_dir/a.c"
+echo "stdin_word" | (cd "$dash_dir" && "$prog" -S -j 2 - a.c) >"$output_file"
+res=$?
+test "`grep -o stdin_word "$output_file" | wc -l`" -eq 2 \
+    && ! grep -q file_word "$output_file"
+test_exit=`expr $res + $?`
+rm -rf "$dash_dir"
+evaluate_test
+
+test_case="Program fails for an invalid number of jobs"
+! "$prog" -S -j -1 "$input_file" >/dev/null 2>&1
+test_exit=$?
+evaluate_test
+
+test_case="Program counts words with --counts"
+echo "int foo (int bar) /* int */ { return bar; }" >"$input_file"
+"$prog" --counts "$input_file" "$input_file" | head -n 2 | tr '\t\n' ':,' | \
+    grep -q "^bar:4,foo:2,$"
+test_exit=$?
+evaluate_test
+
+test_case="Program counts keywords with --keep-keywords"
+"$prog" --counts --keep-keywords "$input_file" | head -n 2 | tr '\t\n' ':,' | \
+    grep -q "^bar:2,int:2,$"
+test_exit=$?
+evaluate_test
+
+test_case="Program doesn't count the words of --stopwords"
+stop_file="`mktemp`"
+printf '# noise\nfoo\n' >"$stop_file"
+"$prog" --counts --stopwords="$stop_file" "$input_file" | tr '\t\n' ':,' | \
+    grep -q "^bar:2,$"
+res=$?
+! "$prog" --counts --stopwords="Not a file 1" "$input_file" >/dev/null 2>&1
+test_exit=`expr $res + $?`
+evaluate_test
+rm -f "$stop_file"
+
+test_case="Program counts the parts of identifiers with --split-identifiers"
+echo "parse_cli_options (parseOptions); HTTPServer2" >"$input_file"
+"$prog" --counts --split-identifiers "$input_file" | tr '\t\n' ':,' | \
+    grep -q "^options:2,parse:2,cli:1,http:1,server:1,$"
+test_exit=$?
+evaluate_test
+
+test_case="Program counts approximately in bounded memory with --approx-top"
+echo "alpha beta alpha gamma alpha beta delta" >"$input_file"
+"$prog" --counts --approx-top=2 "$input_file" | tr '\t\n' ':,' | \
+    grep -q "^alpha:3:0,beta:2:0,$"
+res=$?
+"$prog" --counts --approx-top=2 --mem-limit=1K "$input_file" | \
+    tr '\t\n' ':,' | grep -q "^delta:4:3,alpha:3:0,$"
+res=`expr $res + $?`
+! "$prog" --counts --approx-top=100 --mem-limit=1K "$input_file" \
+    >/dev/null 2>&1
+test_exit=`expr $res + $?`
+evaluate_test
+
+test_case="Program output is the same with a cache"
+cache_dir="`mktemp -d`"
+echo "int foo; /* bar */ 'baz'" >"$input_file"
+"$prog" -S --cache-dir="$cache_dir" "$input_file" >"$output_file"
+res=$?
+"$prog" -S --cache-dir="$cache_dir" "$input_file" | cmp -s - "$output_file"
+res=`expr $res + $?`
+"$prog" -S "$input_file" | cmp -s - "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+
+test_case="Program strips changed files again despite the cache"
+echo "int bazz; /* bar */" >"$input_file"
+"$prog" -S --cache-dir="$cache_dir" "$input_file" | grep -q "int bazz;"
+test_exit=$?
+evaluate_test
+rm -rf "$cache_dir"
+
+test_case="Program walks directories recursively with filters"
+tree_dir="`mktemp -d`"
+mkdir -p "$tree_dir/src/sub" "$tree_dir/third_party"
+echo "int alpha; // skip" >"$tree_dir/src/a.c"
+echo "int beta; /* skip */" >"$tree_dir/src/sub/b.h"
+echo "gamma = 1 # skip" >"$tree_dir/src/c.py"
+echo "int delta;" >"$tree_dir/third_party/d.c"
+"$prog" -S -r -j 2 --include '*.c,*.h' --exclude 'third_party/*' \
+    "$tree_dir" | tr ' ' '\n' | sort | tr '\n' ' ' | \
+    grep -q "^ alpha; beta; int int $"
+test_exit=$?
+evaluate_test
+rm -rf "$tree_dir"
+
+test_case="Program strips the members of archives with filters"
+tree_dir="`mktemp -d`"
+mkdir -p "$tree_dir/src" "$tree_dir/third_party"
+echo "int alpha; // skip" >"$tree_dir/src/a.c"
+echo "gamma = 1 # skip" >"$tree_dir/src/c.py"
+echo "int delta;" >"$tree_dir/third_party/d.c"
+(cd "$tree_dir" && tar czf src.tar.gz src third_party)
+"$prog" -c --exclude 'third_party/*' "$tree_dir/src.tar.gz" | \
+    tr '\t\n' ':,' | grep -q "^alpha:1,gamma:1,$"
+test_exit=$?
+evaluate_test
+rm -rf "$tree_dir"
+
+test_case="Merged tables have the counts of all input files"
+table_dir="`mktemp -d`"
+echo "int foo (int bar) /* int */ { return bar; }" >"$input_file"
+echo "int baz;" >"$output_file"
+"$prog" --emit-table="$table_dir/1.dct" "$input_file" && \
+    "$prog" --emit-table="$table_dir/2.dct" "$input_file" "$output_file" && \
+    "$prog" merge -o "$table_dir/all.dct" "$table_dir/1.dct" "$table_dir/2.dct"
+res=$?
+"$prog" --counts "$table_dir/all.dct" >"$table_dir/all.txt"
+res=`expr $res + $?`
+"$prog" --counts "$input_file" "$input_file" "$output_file" | \
+    cmp -s - "$table_dir/all.txt"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -rf "$table_dir"
+
+test_case="Program fails for --emit-table with -o"
+table_dir="`mktemp -d`"
+! "$prog" --emit-table="$table_dir/a.dct" -o "$table_dir/b" "$input_file" \
+    2>/dev/null
+res=$?
+test ! -e "$table_dir/a.dct" && test ! -e "$table_dir/b"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -rf "$table_dir"
+
+test_case="Program draws the word cloud as PNG image by default"
+"$prog" -o "$output_file" "$input_file"
+res=$?
+head -c 8 "$output_file" | od -An -tx1 | \
+    grep -q "89 50 4e 47 0d 0a 1a 0a"
+test_exit=`expr $res + $?`
+evaluate_test
+
+test_case="Program fails for an unknown renderer"
+! "$prog" --renderer=gnuplot "$input_file" >/dev/null 2>&1
+test_exit=$?
+evaluate_test
+
+test_case="Program passes the word counts to the Python renderer"
+echo "int foo (int bar) /* int */ { return bar; }" >"$input_file"
+mock_dir="`mktemp -d`"
+cat >"$mock_dir/wordcloud.py" <<EOF
+class WordCloud:
+    def __init__(self, width, height):
+        self.size = (width, height)
+    def generate_from_frequencies(self, words):
+        self.words = words
+        return self
+    def to_image(self):
+        return self
+    def save(self, out, fmt):
+        with open(out, "w") as ostr:
+            ostr.write(str(self.size) + str(sorted(self.words.items())))
+            ostr.write("\\n")
+EOF
+PYTHONPATH="$mock_dir" "$prog" --renderer=python -o "$output_file" \
+    "$input_file"
+res=$?
+echo "(1500, 1000)[('bar', 2), ('foo', 1)]" | \
+    cmp -s - "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -rf "$mock_dir"
+
+test_case="Program writes statistics of the removed bytes with --stats"
+printf 'int a; /* bc */ "d"\n\n  e;' >"$input_file"
+"$prog" -S --stats=json "$input_file" "Not a file 1" 2>"$output_file" | \
+    grep -q "^int a;   e;$"
+res=$?
+grep -q '"processed": 1, "skipped": 1' "$output_file" && \
+    grep -q '"in": 25, "out": 11, "comments": 8, "strings": 3, "white_space": 3' \
+        "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+
+test_case="Program skips duplicate input files with --dedupe"
+tree_dir="`mktemp -d`"
+echo "int alpha; // skip" >"$tree_dir/a.c"
+cp "$tree_dir/a.c" "$tree_dir/copy.c"
+ln "$tree_dir/a.c" "$tree_dir/link.c"
+"$prog" --counts --dedupe --stats=json "$tree_dir/a.c" "$tree_dir/copy.c" \
+    "$tree_dir/link.c" "$tree_dir/a.c" 2>"$output_file" | \
+    tr '\t\n' ':,' | grep -q "^alpha:1,$"
+res=$?
+grep -q '"duplicates": 3}' "$output_file" && \
+    grep -q '"duplicates": 57}' "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -rf "$tree_dir"
+
+test_case="Parallel jobs keep the first of duplicate input files"
+tree_dir="`mktemp -d`"
+echo "first_copy" >"$tree_dir/a.c"
+echo "other_file" >"$tree_dir/b.c"
+cp "$tree_dir/a.c" "$tree_dir/copy.c"
+"$prog" -S --dedupe "$tree_dir/a.c" "$tree_dir/b.c" "$tree_dir/copy.c" \
+    >"$output_file"
+test_exit=$?
+for run in 1 2 3 4 5; do
+    "$prog" -S -j 3 --dedupe "$tree_dir/a.c" "$tree_dir/b.c" \
+        "$tree_dir/copy.c" | cmp -s - "$output_file"
+    test_exit=`expr $test_exit + $?`
+done
+grep -q "first_copy.*other_file" "$output_file"
+test_exit=`expr $test_exit + $?`
+evaluate_test
+rm -rf "$tree_dir"
+
+test_case="Program fails for an unknown statistics format"
+! "$prog" --stats=xml "$input_file" >/dev/null 2>&1
+test_exit=$?
+evaluate_test
+
+test_case="Program writes a span for each input file with --trace"
+echo "int foo;" >"$input_file"
+"$prog" -S -j 2 --trace="$output_file" "$input_file" "$input_file" \
+    >/dev/null
+res=$?
+test `grep -o '"name": "process_input_file"' "$output_file" | wc -l` = 2 && \
+    grep -q '"name": "write_output"' "$output_file"
+test_exit=`expr $res + $?`
+evaluate_test
+
+test_case="Program strips files by the language of their extension or --lang"
+py_dir="`mktemp -d`"
+printf 'x = 1 # comment\ns = """doc"""\n' >"$py_dir/a.py"
+"$prog" -S "$py_dir/a.py" | grep -q "^x = 1 s =  $"
+res=$?
+"$prog" -S --lang=python - <"$py_dir/a.py" | grep -q "^x = 1 s =  $"
+res=`expr $res + $?`
+"$prog" -S --lang=c "$py_dir/a.py" | grep -q "^x = 1 # comment s =  $"
+test_exit=`expr $res + $?`
+evaluate_test
+rm -rf "$py_dir"
+
+test_case="Program fails for an unknown language"
+! "$prog" --lang=cobol "$input_file" >/dev/null 2>&1
+test_exit=$?
+evaluate_test
 
 rm -f "$input_file" "$output_file"
 
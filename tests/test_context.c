@@ -0,0 +1,199 @@
+/** \file
+ * Tests for pushing input in buffers through a \ref dc_ctx. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "cminitests.h"
+
+/** A callback of \ref dc_ctx which appends \a text to the memory stream
+ *  \a ostr. */
+int
+collect_text (const char *text, size_t len, void *ostr)
+{
+    fwrite (text, 1, len, ostr);
+    return 0;
+}
+
+/** Like \ref collect_text but writes one word per line. */
+int
+collect_word (const char *word, size_t len, void *ostr)
+{
+    fwrite (word, 1, len, ostr);
+    fputc ('\n', ostr);
+    return 0;
+}
+
+/** A callback of \ref dc_ctx which fails. */
+int
+fail (const char *text, size_t len, void *data)
+{
+    (void) text; (void) len; (void) data;
+    return ENOSPC;
+}
+
+char *
+Chunk_boundaries_do_not_change_the_text (void)
+{
+    const char input[] =
+        "int a = b / c; // line \\\n comment\n"
+        "char *s = \"/* no comment */\";   /* block * / */ x='\\'';\n"
+        "return a/b;/";
+    const char *expected =
+        "int a = b / c; char *s = ;  x=; return a/b;/";
+
+    for (size_t part_len = 1; part_len <= sizeof (input); ++part_len)
+    {
+        char *output = NULL;
+        size_t output_len = 0;
+        FILE *ostr = open_memstream (&output, &output_len);
+        struct dc_ctx *ctx = dc_ctx_new (DC_OUTPUT_TEXT, collect_text, ostr);
+        require (ctx,)
+
+        size_t len = sizeof (input) - 1;
+        for (size_t pos = 0; pos < len; pos += part_len)
+            require (dc_feed (
+                         ctx, input + pos,
+                         len - pos < part_len ? len - pos : part_len) == 0,)
+        require (dc_finish (ctx) == 0,)
+        dc_ctx_free (ctx);
+        fclose (ostr);
+
+        require_streq (expected, output,)
+        free (output);
+    }
+
+    return NULL;
+}
+
+char *
+Words_are_passed_once_across_chunks (void)
+{
+    const char input[] = "foo_bar /* baz */ qux1 2ab x\nlast";
+    const char *expected = "foo_bar\nqux1\nlast\n";
+
+    for (size_t part_len = 1; part_len <= sizeof (input); ++part_len)
+    {
+        char *output = NULL;
+        size_t output_len = 0;
+        FILE *ostr = open_memstream (&output, &output_len);
+        struct dc_ctx *ctx = dc_ctx_new (DC_OUTPUT_WORDS, collect_word, ostr);
+        require (ctx,)
+
+        /* The context is reusable after dc_finish. */
+        for (int run = 0; run < 2; ++run)
+        {
+            size_t len = sizeof (input) - 1;
+            for (size_t pos = 0; pos < len; pos += part_len)
+                require (dc_feed (
+                             ctx, input + pos,
+                             len - pos < part_len ? len - pos : part_len)
+                         == 0,)
+            require (dc_finish (ctx) == 0,)
+        }
+        dc_ctx_free (ctx);
+        fclose (ostr);
+
+        size_t expected_len = strlen (expected);
+        require (output_len == 2 * expected_len,)
+        require (!strncmp (output, expected, expected_len),)
+        require_streq (expected, output + expected_len,)
+        free (output);
+    }
+
+    return NULL;
+}
+
+char *
+Inputs_are_stripped_as_the_set_language (void)
+{
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *ostr = open_memstream (&output, &output_len);
+    struct dc_ctx *ctx = dc_ctx_new (DC_OUTPUT_TEXT, collect_text, ostr);
+    require (ctx,)
+
+    dc_ctx_set_lang (ctx, clutter_lang_find ("python"));
+    require (dc_feed (ctx, "a # b\n'''c", 10) == 0,)
+    require (dc_feed (ctx, "''' d /", 7) == 0,)
+    require (dc_finish (ctx) == 0,)
+    dc_ctx_set_lang (ctx, NULL);
+    require (dc_feed (ctx, "# e /", 5) == 0,)
+    require (dc_finish (ctx) == 0,)
+    dc_ctx_free (ctx);
+    fclose (ostr);
+
+    require_streq ("a  d /# e /", output,)
+    free (output);
+    return NULL;
+}
+
+char *
+Keywords_are_dropped_from_the_words (void)
+{
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *ostr = open_memstream (&output, &output_len);
+    struct dc_ctx *ctx = dc_ctx_new (DC_OUTPUT_WORDS, collect_word, ostr);
+    require (ctx,)
+
+    const struct clutter_lang *python = clutter_lang_find ("python");
+    dc_ctx_set_lang (ctx, python);
+    dc_ctx_set_filters (ctx, clutter_lang_keywords (python), NULL);
+    for (int run = 0; run < 2; ++run)
+    {
+        require (dc_feed (ctx, "def area(self): ret", 19) == 0,)
+        require (dc_feed (ctx, "urn self.width", 14) == 0,)
+        require (dc_finish (ctx) == 0,)
+    }
+    dc_ctx_free (ctx);
+    fclose (ostr);
+
+    require_streq ("area\nwidth\narea\nwidth\n", output,)
+    free (output);
+    return NULL;
+}
+
+char *
+Callback_errors_stop_the_input (void)
+{
+    struct dc_ctx *ctx = dc_ctx_new (DC_OUTPUT_WORDS, fail, NULL);
+    require (ctx,)
+
+    require (dc_feed (ctx, "foo ", 4) == ENOSPC,)
+    require (dc_feed (ctx, "bar ", 4) == ENOSPC,)
+    require (dc_finish (ctx) == ENOSPC,)
+    require (dc_finish (ctx) == 0,)
+
+    dc_ctx_free (ctx);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Chunk_boundaries_do_not_change_the_text,)
+    CMT_TEST_CASE (Words_are_passed_once_across_chunks,)
+    CMT_TEST_CASE (Inputs_are_stripped_as_the_set_language,)
+    CMT_TEST_CASE (Keywords_are_dropped_from_the_words,)
+    CMT_TEST_CASE (Callback_errors_stop_the_input,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
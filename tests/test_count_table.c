@@ -0,0 +1,232 @@
+/** \file
+ * Tests for the binary tables of word counts. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "cminitests.h"
+
+/** Directory of the table files of the tests. */
+static char table_dir[] = "/tmp/test_count_table_XXXXXX";
+
+/** Write \a counts as table to the file \a name in \ref table_dir.
+ *
+ *  \returns The path of the file.  Has to be freed.
+ */
+char *
+write_table (const struct word_counts *counts, const char *name)
+{
+    char *path;
+    if (asprintf (&path, "%s/%s", table_dir, name) < 0)
+        return NULL;
+
+    FILE *os = fopen (path, "w");
+    if (!os || word_counts_write_table (counts, os))
+        cmt_error ("Can't write table '%s'", path);
+    if (os)
+        fclose (os);
+
+    return path;
+}
+
+/** The output of \ref word_counts_print for \a counts.  Has to be freed. */
+char *
+print_counts (const struct word_counts *counts)
+{
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *os = open_memstream (&output, &output_len);
+
+    word_counts_print (counts, 0, os);
+    fclose (os);
+
+    return output;
+}
+
+char *
+Tables_keep_the_counts (void)
+{
+    struct word_counts *counts = word_counts_new ();
+    struct word_counts *read = word_counts_new ();
+    char long_word[WORD_MAX_LEN];
+    memset (long_word, 'x', sizeof (long_word));
+
+    require (word_counts_add (counts, "foo_bar", 7, 3) == 0,)
+    require (word_counts_add (counts, "foo", 3, 1) == 0,)
+    require (word_counts_add (counts, "zoo", 3, 123456789) == 0,)
+    require (word_counts_add (counts, long_word, WORD_MAX_LEN, 2) == 0,)
+
+    char *table = write_table (counts, "counts.dct");
+    require (word_counts_read_table (read, table) == 0,)
+    char *expected = print_counts (counts);
+    char *output = print_counts (read);
+    require_streq (expected, output,)
+
+    free (output);
+    free (expected);
+    free (table);
+    word_counts_free (read);
+    word_counts_free (counts);
+
+    return NULL;
+}
+
+char *
+Merged_tables_sum_up_the_counts (void)
+{
+    struct word_counts *first = word_counts_new ();
+    struct word_counts *second = word_counts_new ();
+    struct word_counts *empty = word_counts_new ();
+    struct word_counts *merged = word_counts_new ();
+    const char *expected = "foo\t5\nbar\t2\nbaz\t1\nfoobar\t1\n";
+
+    require (word_counts_add (first, "foo", 3, 2) == 0,)
+    require (word_counts_add (first, "bar", 3, 2) == 0,)
+    require (word_counts_add (second, "foo", 3, 3) == 0,)
+    require (word_counts_add (second, "foobar", 6, 1) == 0,)
+    require (word_counts_add (second, "baz", 3, 1) == 0,)
+
+    char *tables[] = {
+        write_table (first, "first.dct"), write_table (empty, "empty.dct"),
+        write_table (second, "second.dct"), NULL};
+    char *merged_table;
+    require (asprintf (&merged_table, "%s/merged.dct", table_dir) > 0,)
+
+    FILE *os = fopen (merged_table, "w");
+    int bad_table = -1;
+    require (merge_count_tables (tables, 3, os, &bad_table) == 0,)
+    fclose (os);
+
+    require (word_counts_read_table (merged, merged_table) == 0,)
+    char *output = print_counts (merged);
+    require_streq (expected, output,)
+
+    /* Text is no table. */
+    tables[3] = tables[2];
+    tables[2] = "/dev/null";
+    require (merge_count_tables (tables + 2, 2, stdout, &bad_table) == EINVAL,)
+    require (bad_table == 0,)
+
+    free (output);
+    free (merged_table);
+    free (tables[0]);
+    free (tables[1]);
+    free (tables[3]);
+    word_counts_free (merged);
+    word_counts_free (empty);
+    word_counts_free (second);
+    word_counts_free (first);
+
+    return NULL;
+}
+
+/** Merge \a num_tables tables of pseudo random words from \a seed and
+ *  compare the result to counting all words in one table.  The smallest
+ *  word of each table is larger than that of the next table.
+ *
+ *  \returns An error message or \c NULL.
+ */
+char *
+check_merge (int num_tables, unsigned seed)
+{
+    struct word_counts *direct = word_counts_new ();
+    struct word_counts *merged = word_counts_new ();
+    char **tables = calloc ((size_t) num_tables, sizeof (*tables));
+    unsigned state = seed;
+    require (tables,)
+
+    for (int table = 0; table < num_tables; ++table)
+    {
+        struct word_counts *counts = word_counts_new ();
+        for (int word = 0; word < 20 + 10 * table; ++word)
+        {
+            state = state * 1103515245 + 12345;
+            char text[3] = {
+                (char) ('a' + num_tables - table + (state >> 16) % 4),
+                (char) ('a' + (state >> 20) % 9), 'x'};
+            size_t len = 2 + (state >> 24) % 2;
+            require (word_counts_add (counts, text, len, 1) == 0,)
+            require (word_counts_add (direct, text, len, 1) == 0,)
+        }
+
+        char name[16];
+        snprintf (name, sizeof (name), "%d.dct", table);
+        tables[table] = write_table (counts, name);
+        word_counts_free (counts);
+    }
+
+    char *merged_table;
+    require (asprintf (&merged_table, "%s/all.dct", table_dir) > 0,)
+    FILE *os = fopen (merged_table, "w");
+    int bad_table = -1;
+    require (merge_count_tables (tables, num_tables, os, &bad_table) == 0,)
+    fclose (os);
+
+    require (word_counts_read_table (merged, merged_table) == 0,
+             "%d tables, seed %u", num_tables, seed)
+    char *expected = print_counts (direct);
+    char *output = print_counts (merged);
+    require (!strcmp (expected, output), "%d tables, seed %u", num_tables, seed)
+
+    free (output);
+    free (expected);
+    free (merged_table);
+    for (int table = 0; table < num_tables; ++table)
+        free (tables[table]);
+    free (tables);
+    word_counts_free (merged);
+    word_counts_free (direct);
+
+    return NULL;
+}
+
+char *
+Many_merged_tables_count_like_one (void)
+{
+    for (int num_tables = 5; num_tables <= 9; ++num_tables)
+        for (unsigned seed = 1; seed <= 10; ++seed)
+        {
+            char *msg = check_merge (num_tables, seed);
+            require (!msg, msg)
+        }
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    if (!mkdtemp (table_dir))
+        return;
+
+    CMT_TEST_CASE (Tables_keep_the_counts,)
+    CMT_TEST_CASE (Merged_tables_sum_up_the_counts,)
+    CMT_TEST_CASE (Many_merged_tables_count_like_one,)
+
+    char *cmd;
+    if (asprintf (&cmd, "rm -r '%s'", table_dir) > 0)
+    {
+        if (system (cmd))
+            cmt_error ("Can't remove '%s'", table_dir);
+        free (cmd);
+    }
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,197 @@
+/** \file
+ * Tests for the decompression of compressed input. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "decompress.h"
+#include "cminitests.h"
+
+/** Pipe \a len chars of \a text through the shell command \a filter and
+ *  return its output.
+ *
+ *  \param out_len Set to the length of the output.
+ *  \returns The output or \c NULL on error.  Release with \c free.
+ */
+char *
+run_filter (const char *filter, const char *text, size_t len, size_t *out_len)
+{
+    char in_name[] = "/tmp/test_decompressXXXXXX";
+    int fd = mkstemp (in_name);
+    if (fd < 0)
+        return NULL;
+    bool written = write (fd, text, len) == (ssize_t) len;
+    close (fd);
+
+    char *cmd = NULL;
+    char *out = NULL;
+    FILE *istr = NULL;
+    if (written && asprintf (&cmd, "%s <'%s'", filter, in_name) > 0
+        && (istr = popen (cmd, "r")))
+    {
+        size_t capacity = len + 1024;
+        out = malloc (capacity);
+        *out_len = 0;
+        size_t read_len;
+        while (out && (read_len = fread (
+                           out + *out_len, 1, capacity - *out_len, istr)) > 0)
+            if ((*out_len += read_len) == capacity)
+                out = realloc (out, capacity *= 2);
+        pclose (istr);
+    }
+    free (cmd);
+    unlink (in_name);
+    return out;
+}
+
+/** Decompress the \a len chars at \a in and compare them to \a expected.
+ *
+ *  \returns An error message or \c NULL.
+ */
+char *
+check_decompress (
+    const char *in, size_t len, const char *expected, size_t expected_len)
+{
+    struct decompressor *decompressor = NULL;
+    require (decompressor_start (
+                 input_compression (in, len), in, len, &decompressor) == 0,)
+
+    size_t pos = 0;
+    const char *block;
+    size_t block_len;
+    int res;
+    while (!(res = decompressor_next (decompressor, &block, &block_len))
+           && block_len)
+    {
+        require (pos + block_len <= expected_len,)
+        require (!memcmp (block, expected + pos, block_len), "at %zu", pos)
+        pos += block_len;
+    }
+    decompressor_free (decompressor);
+
+    require (res == 0, "%s", strerror (res))
+    require (pos == expected_len, "%zu of %zu chars", pos, expected_len)
+    return NULL;
+}
+
+/** Text of several blocks, which compresses well but not too well. */
+char *
+make_text (size_t len)
+{
+    char *text = malloc (len);
+    unsigned state = 1;
+    for (size_t pos = 0; text && pos < len; ++pos)
+    {
+        state = state * 1103515245 + 12345;
+        text[pos] = "abcdefgh \n"[(state >> 16) % 10];
+    }
+    return text;
+}
+
+char *
+Compressions_are_detected_by_magic_bytes (void)
+{
+    require (input_compression ("\x1F\x8B\x08", 3) == COMPRESSION_GZIP,)
+    require (input_compression ("\x28\xB5\x2F\xFD", 4) == COMPRESSION_ZSTD,)
+    require (input_compression ("\xFD" "7zXZ", 6) == COMPRESSION_XZ,)
+    require (input_compression ("\xFD" "7zX", 4) == COMPRESSION_NONE,)
+    require (input_compression ("\x1F", 1) == COMPRESSION_NONE,)
+    require (input_compression ("int main", 8) == COMPRESSION_NONE,)
+    require (input_compression ("", 0) == COMPRESSION_NONE,)
+
+    struct decompressor *decompressor = NULL;
+    require (decompressor_start (
+                 COMPRESSION_NONE, "", 0, &decompressor) == ENOTSUP,)
+    return NULL;
+}
+
+char *
+Gzip_input_is_decompressed (void)
+{
+    size_t len = 3 * 1024 * 1024 + 17;
+    char *text = make_text (len);
+    require (text,)
+
+    size_t gz_len = 0;
+    char *gz = run_filter ("gzip -c", text, len, &gz_len);
+    require (gz && gz_len > 2 && gz_len < len,)
+    char *msg = check_decompress (gz, gz_len, text, len);
+    require (!msg, msg)
+
+    /* Members following each other, as from cat a.gz b.gz. */
+    char *twice = malloc (2 * gz_len);
+    char *double_text = malloc (2 * len);
+    require (twice && double_text,)
+    memcpy (twice, gz, gz_len);
+    memcpy (twice + gz_len, gz, gz_len);
+    memcpy (double_text, text, len);
+    memcpy (double_text + len, text, len);
+    msg = check_decompress (twice, 2 * gz_len, double_text, 2 * len);
+    require (!msg, msg)
+
+    /* Truncated input gives the text decompressed so far and an error. */
+    struct decompressor *decompressor = NULL;
+    require (decompressor_start (
+                 COMPRESSION_GZIP, gz, gz_len / 2, &decompressor) == 0,)
+    const char *block;
+    size_t block_len;
+    size_t pos = 0;
+    int res;
+    while (!(res = decompressor_next (decompressor, &block, &block_len))
+           && block_len)
+        pos += block_len;
+    decompressor_free (decompressor);
+    require (res == EINVAL,)
+    require (pos > 0 && pos < len,)
+
+    free (double_text);
+    free (twice);
+    free (gz);
+    free (text);
+    return NULL;
+}
+
+char *
+Xz_input_is_decompressed (void)
+{
+    size_t len = 1024 * 1024 + 3;
+    char *text = make_text (len);
+    require (text,)
+
+    size_t xz_len = 0;
+    char *xz = run_filter ("xz -c", text, len, &xz_len);
+    require (xz && xz_len > 6,)
+    char *msg = check_decompress (xz, xz_len, text, len);
+    require (!msg, msg)
+
+    free (xz);
+    free (text);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Compressions_are_detected_by_magic_bytes,)
+    CMT_TEST_CASE (Gzip_input_is_decompressed,)
+    CMT_TEST_CASE (Xz_input_is_decompressed,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
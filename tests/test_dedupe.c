@@ -0,0 +1,87 @@
+/** \file
+ * Tests for finding duplicate input files. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dedupe.h"
+#include "cminitests.h"
+
+char *
+Files_are_known_by_device_and_inode (void)
+{
+    struct dedupe_set *set = dedupe_set_new ();
+    require (set,)
+
+    struct stat file_stat;
+    memset (&file_stat, 0, sizeof (file_stat));
+    file_stat.st_dev = 3;
+    bool added = false;
+    for (ino_t ino = 1; ino <= 5000; ++ino)
+    {
+        file_stat.st_ino = ino;
+        require (dedupe_add_file (set, &file_stat, &added) == 0,)
+        require (added, "inode %lu", (unsigned long) ino)
+    }
+
+    file_stat.st_ino = 4711;
+    require (dedupe_add_file (set, &file_stat, &added) == 0,)
+    require (!added,)
+    file_stat.st_dev = 4;
+    require (dedupe_add_file (set, &file_stat, &added) == 0,)
+    require (added,)
+
+    dedupe_set_free (set);
+    return NULL;
+}
+
+char *
+Copies_are_known_by_their_content (void)
+{
+    struct dedupe_set *set = dedupe_set_new ();
+    require (set,)
+
+    const char text[] = "int main (void) { return 0; }\n";
+    char copy[sizeof (text)];
+    memcpy (copy, text, sizeof (text));
+    bool added = false;
+    require (dedupe_add_content (set, text, strlen (text), &added) == 0,)
+    require (added,)
+    require (dedupe_add_content (set, copy, strlen (copy), &added) == 0,)
+    require (!added,)
+
+    copy[4] = 'x';
+    require (dedupe_add_content (set, copy, strlen (copy), &added) == 0,)
+    require (added,)
+    require (dedupe_add_content (set, text, strlen (text) - 1, &added) == 0,)
+    require (added,)
+
+    dedupe_set_free (set);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Files_are_known_by_device_and_inode,)
+    CMT_TEST_CASE (Copies_are_known_by_their_content,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,84 @@
+/** \file
+ * Tests for mapping and reading whole input files. */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "cminitests.h"
+
+char *
+Regular_files_are_mapped (void)
+{
+    char file_name[] = "/tmp/test_inputXXXXXX";
+    int fd = mkstemp (file_name);
+    require (fd >= 0,)
+    const char text[] = "int main (void) { return 0; } // done\n";
+    require (write (fd, text, strlen (text)) == (ssize_t) strlen (text),)
+
+    struct input_buf buf;
+    require (input_buf_map (fd, strlen (text), &buf) == 0,)
+    require (buf.mapped,)
+    require (buf.len == strlen (text) && !memcmp (buf.data, text, buf.len),)
+    input_buf_release (&buf);
+    require (!buf.data && !buf.len,)
+
+    /* Empty files can't be mapped and are read. */
+    require (ftruncate (fd, 0) == 0,)
+    require (input_buf_map (fd, 0, &buf) == 0,)
+    require (!buf.mapped && buf.len == 0,)
+    input_buf_release (&buf);
+
+    close (fd);
+    unlink (file_name);
+    return NULL;
+}
+
+char *
+Pipes_are_read_until_their_end (void)
+{
+    int fds[2];
+    require (pipe (fds) == 0,)
+    char text[3000];
+    for (size_t i = 0; i < sizeof (text); ++i)
+        text[i] = (char) ('a' + i % 26);
+    require (write (fds[1], text, sizeof (text)) == (ssize_t) sizeof (text),)
+    close (fds[1]);
+
+    /* The size of a pipe is unknown, so the buffer has to grow. */
+    struct input_buf buf;
+    require (input_buf_read (fds[0], 0, &buf) == 0,)
+    require (!buf.mapped,)
+    require (buf.len == sizeof (text) && !memcmp (buf.data, text, buf.len),)
+    input_buf_release (&buf);
+    close (fds[0]);
+
+    require (input_buf_read (fds[0], 10, &buf) != 0,)
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Regular_files_are_mapped,)
+    CMT_TEST_CASE (Pipes_are_read_until_their_end,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
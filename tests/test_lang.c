@@ -0,0 +1,283 @@
+/** \file
+ * Tests for the lexers compiled from the language descriptions. */
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "lang.h"
+#include "cminitests.h"
+
+/** A \ref clutter_sink which appends \a text to the memory stream
+ *  \a ostr. */
+int
+collect_text (const char *text, size_t len, void *ostr)
+{
+    fwrite (text, 1, len, ostr);
+    return 0;
+}
+
+/** Strip the \a len chars of \a input as code of \a lang in parts of
+ *  \a part_len chars.
+ *
+ *  \returns The allocated text or \c NULL if stripping failed.
+ */
+char *
+strip (
+    const struct clutter_lang *lang, const char *input, size_t len,
+    size_t part_len, struct clutter_stats *stats)
+{
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *ostr = open_memstream (&output, &output_len);
+    unsigned state = 0;
+    int res = 0;
+
+    for (size_t pos = 0; pos < len && !res; pos += part_len)
+        res = remove_clutter_lang_buf (
+            lang, input + pos, len - pos < part_len ? len - pos : part_len,
+            &state, stats, collect_text, ostr);
+    if (!res)
+        res = remove_clutter_lang_end (lang, &state, stats, collect_text, ostr);
+    fclose (ostr);
+
+    if (res)
+    {
+        free (output);
+        return NULL;
+    }
+    return output;
+}
+
+/** Whether stripping \a input as \a lang_name gives \a expected. */
+bool
+strips_to (const char *lang_name, const char *input, const char *expected)
+{
+    const struct clutter_lang *lang = clutter_lang_find (lang_name);
+    if (!lang)
+        return false;
+
+    char *output = strip (lang, input, strlen (input), strlen (input) + 1, NULL);
+    bool equal = output && !strcmp (output, expected);
+    if (!equal)
+        fprintf (stderr, "%s: '%s' -> '%s'\n", lang_name, input, output);
+    free (output);
+    return equal;
+}
+
+char *
+Python_comments_and_triple_quotes_are_stripped (void)
+{
+    require (strips_to (
+                 "python",
+                 "x = 1 # comment \"\n"
+                 "y = \"\"\"doc\n'''\"\"\" + 'a\\'' + \"\" + f\"{z}\"",
+                 "x = 1 y =  +  +  + f"),)
+    require (strips_to ("python", "s = '''a ' '' b'''c", "s = c"),)
+
+    return NULL;
+}
+
+char *
+Shell_comments_only_start_words (void)
+{
+    require (strips_to (
+                 "shell",
+                 "echo $# a#b ${#x} # comment\n"
+                 "ls 'it''s' \"q\\\"#\" \\# \\'x",
+                 "echo $# a#b ${#x} ls   \\# \\'x"),)
+
+    return NULL;
+}
+
+char *
+Rust_raw_strings_nested_comments_and_lifetimes (void)
+{
+    require (strips_to (
+                 "rust",
+                 "let r = r#\"a \" b\"#; let b = br\"\\\"; /* a /* b */ c */ d",
+                 "let r = ; let b = ;  d"),)
+    require (strips_to (
+                 "rust",
+                 "fn f<'a>(x: &'a str) -> char { ' ' } '\\'' 'x' bar\"s\"",
+                 "fn f<'a>(x: &'a str) -> char {  }  'x' bar"),)
+
+    return NULL;
+}
+
+char *
+Cpp_raw_strings_are_stripped (void)
+{
+    require (strips_to (
+                 "cpp",
+                 "auto s = R\"(a \" b)\"; u8R\"(x)\" LR\"(/*)\" u8\"z\" FOOR\"y\"",
+                 "auto s = ;   u8 FOOR"),)
+
+    return NULL;
+}
+
+char *
+Lua_long_brackets_are_stripped (void)
+{
+    require (strips_to (
+                 "lua",
+                 "a = [==[ x ]] ]==] -- c\n"
+                 "--[[ block\n]] b = t[ [1] ] - 1 --[=x\n"
+                 "c = [=",
+                 "a =   b = t[ [1] ] - 1 c = [="),)
+
+    return NULL;
+}
+
+char *
+Backquoted_strings_of_go_and_js (void)
+{
+    require (strips_to ("go", "a := `x\\` + b", "a :=  + b"),)
+    require (strips_to ("js", "a = `x\\` + b` + c", "a =  + c"),)
+    require (strips_to ("c", "a = `x` + b", "a = `x` + b"),)
+
+    return NULL;
+}
+
+char *
+Js_quotes_end_at_the_end_of_the_line (void)
+{
+    require (strips_to (
+                 "js",
+                 "let t = \"a\"; let r = /re\"g/; x\nmore 'b\\\nc' code",
+                 "let t = ; let r = /re more  code"),)
+    require (strips_to ("js", "a = `x\ny` + b", "a =  + b"),)
+
+    return NULL;
+}
+
+/** The xorshift generator of the tests, which is reproducible. */
+unsigned
+next_random (unsigned *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+char *
+C_tables_match_the_native_lexer (void)
+{
+    const char alphabet[] = "/*\"'\\\n \ta";
+    const struct clutter_lang *lang = clutter_lang_find ("c");
+    require (lang && lang->native,)
+    unsigned seed = 2017;
+
+    for (int round = 0; round < 2000; ++round)
+    {
+        char input[64];
+        size_t len = next_random (&seed) % sizeof (input);
+        for (size_t i = 0; i < len; ++i)
+            input[i] = alphabet[next_random (&seed) % (sizeof (alphabet) - 1)];
+
+        struct clutter_stats native_stats = {0, 0, 0, 0};
+        char *native = strip (lang, input, len, len + 1, &native_stats);
+
+        char *table = NULL;
+        size_t table_len = 0;
+        FILE *ostr = open_memstream (&table, &table_len);
+        struct clutter_stats table_stats = {0, 0, 0, 0};
+        unsigned state = 0;
+        require (lang_table_buf (
+                     lang, input, len, &state, &table_stats,
+                     collect_text, ostr) == 0,)
+        require (lang_table_end (
+                     lang, &state, &table_stats, collect_text, ostr) == 0,)
+        fclose (ostr);
+
+        require (native && table,)
+        require_streq (native, table,)
+        require (!memcmp (&native_stats, &table_stats, sizeof (table_stats)),)
+        free (native);
+        free (table);
+    }
+
+    return NULL;
+}
+
+char *
+Chunk_boundaries_and_stats_of_all_languages (void)
+{
+    const char input[] =
+        "a = b / c; // x \\\n y\n# z\ns = \"\"\"q\"\"\" r#\"t\"# '\\'' "
+        "`u` R\"(v)\" /* /* w */ */ -- [==[ x ]==] [[y]] --[[z]] $# e'f'";
+
+    for (int i = 0; i < num_clutter_langs; ++i)
+    {
+        const struct clutter_lang *lang = &clutter_langs[i];
+        size_t len = sizeof (input) - 1;
+        struct clutter_stats stats = {0, 0, 0, 0};
+        char *whole = strip (lang, input, len, len, &stats);
+        require (whole,)
+        require (stats.bytes_in == len,)
+        require (clutter_stats_bytes_out (&stats) == strlen (whole),
+                 "%s: %llu chars counted, %zu written",
+                 lang->name, clutter_stats_bytes_out (&stats), strlen (whole))
+
+        for (size_t part_len = 1; part_len < len; ++part_len)
+        {
+            struct clutter_stats part_stats = {0, 0, 0, 0};
+            char *parts = strip (lang, input, len, part_len, &part_stats);
+            require (parts,)
+            require_streq (whole, parts,)
+            require (!memcmp (&stats, &part_stats, sizeof (stats)),)
+            free (parts);
+        }
+        free (whole);
+    }
+
+    return NULL;
+}
+
+char *
+Languages_are_found_by_name_and_extension (void)
+{
+    require_streq ("python", clutter_lang_name (clutter_lang_for_file ("a/b.py")),)
+    require_streq ("rust", clutter_lang_name (clutter_lang_for_file ("lib.rs")),)
+    require_streq ("cpp", clutter_lang_name (clutter_lang_for_file ("x.hpp")),)
+    require_streq ("c", clutter_lang_name (clutter_lang_for_file ("x.tar")),)
+    require_streq ("c", clutter_lang_name (clutter_lang_for_file ("dir.py/file")),)
+    require_streq ("c", clutter_lang_name (clutter_lang_for_file ("Makefile")),)
+    require (clutter_lang_find ("lua") == clutter_lang_for_file ("init.lua"),)
+    require (!clutter_lang_find ("cobol"),)
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Python_comments_and_triple_quotes_are_stripped,)
+    CMT_TEST_CASE (Shell_comments_only_start_words,)
+    CMT_TEST_CASE (Rust_raw_strings_nested_comments_and_lifetimes,)
+    CMT_TEST_CASE (Cpp_raw_strings_are_stripped,)
+    CMT_TEST_CASE (Lua_long_brackets_are_stripped,)
+    CMT_TEST_CASE (Backquoted_strings_of_go_and_js,)
+    CMT_TEST_CASE (Js_quotes_end_at_the_end_of_the_line,)
+    CMT_TEST_CASE (C_tables_match_the_native_lexer,)
+    CMT_TEST_CASE (Chunk_boundaries_and_stats_of_all_languages,)
+    CMT_TEST_CASE (Languages_are_found_by_name_and_extension,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,138 @@
+/** \file
+ * Tests for reading input files ahead. */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loader.h"
+#include "cminitests.h"
+
+char dir[] = "/tmp/test_loaderXXXXXX";
+
+/** Write \a len chars of \a content to the file \a name in \ref dir.
+ *
+ *  \returns The path of the file.  Release with \c free.
+ */
+char *
+create_file (const char *name, const char *content, size_t len)
+{
+    char *path = NULL;
+    if (asprintf (&path, "%s/%s", dir, name) < 0)
+        return NULL;
+    FILE *ostr = fopen (path, "w");
+    if (ostr)
+    {
+        fwrite (content, 1, len, ostr);
+        fclose (ostr);
+    }
+    return path;
+}
+
+char *
+Small_files_are_loaded_in_order (void)
+{
+    enum { num_files = 200 };
+    char *paths[num_files];
+    require (mkdtemp (dir),)
+    for (int file = 0; file < num_files; ++file)
+    {
+        char name[16];
+        snprintf (name, sizeof (name), "f%d.c", file);
+        paths[file] = create_file (name, name, strlen (name));
+        require (paths[file],)
+    }
+
+    struct input_loader *loader = input_loader_new ();
+    require (loader,)
+    struct input_load *loads[num_files];
+    for (int file = 0; file < num_files; ++file)
+        require ((loads[file] = input_loader_add (loader, paths[file])),)
+
+    for (int file = 0; file < num_files; ++file)
+    {
+        const struct loaded_input *loaded = input_load_wait (loads[file]);
+        require (loaded, "%s wasn't loaded", paths[file])
+        const char *name = strrchr (paths[file], '/') + 1;
+        require (loaded->buf.len == strlen (name),)
+        require (!memcmp (loaded->buf.data, name, loaded->buf.len),)
+        require (S_ISREG (loaded->stat.st_mode),)
+        require (loaded->stat.st_size == (off_t) strlen (name),)
+        input_load_release (loads[file]);
+        unlink (paths[file]);
+        free (paths[file]);
+    }
+
+    input_loader_free (loader);
+    return NULL;
+}
+
+char *
+Other_files_are_left_to_the_caller (void)
+{
+    char *missing = create_file ("missing", "", 0);
+    require (missing,)
+    unlink (missing);
+
+    size_t large_len = INPUT_LOADER_MAX_SIZE + 1;
+    char *content = calloc (large_len, 1);
+    require (content,)
+    char *large = create_file ("large", content, large_len);
+    free (content);
+    require (large,)
+
+    /* Nobody writes to the pipe, so opening it must not wait. */
+    char *fifo = NULL;
+    require (asprintf (&fifo, "%s/fifo", dir) > 0,)
+    require (mkfifo (fifo, 0600) == 0,)
+
+    struct input_loader *loader = input_loader_new ();
+    require (loader,)
+    struct input_load *loads[] = {
+        input_loader_add (loader, missing), input_loader_add (loader, large),
+        input_loader_add (loader, fifo), input_loader_add (loader, dir)};
+    for (int load = 0; load < 4; ++load)
+    {
+        require (loads[load],)
+        require (!input_load_wait (loads[load]), "%d was loaded", load)
+        input_load_release (loads[load]);
+    }
+    input_loader_free (loader);
+
+    require (input_loader_add (NULL, large) == NULL,)
+    input_load_release (NULL);
+    input_loader_free (NULL);
+
+    unlink (large);
+    unlink (fifo);
+    rmdir (dir);
+    free (missing);
+    free (large);
+    free (fifo);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Small_files_are_loaded_in_order,)
+    CMT_TEST_CASE (Other_files_are_left_to_the_caller,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,179 @@
+/** \file
+ * Tests for writing PNG images and rendering word clouds. */
+#include <stdint.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "png.h"
+#include "cminitests.h"
+
+/** The PNG file signature. */
+static const unsigned char png_signature[] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+/** The big endian 32 bit number at \a bytes. */
+uint32_t
+read_u32 (const unsigned char *bytes)
+{
+    return (uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16
+        | (uint32_t) bytes[2] << 8 | bytes[3];
+}
+
+/** The CRC-32 of the \a len bytes at \a data as used by PNG. */
+uint32_t
+crc32 (const unsigned char *data, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        crc ^= data[pos];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = crc >> 1 ^ (crc & 1 ? 0xedb88320 : 0);
+    }
+    return crc ^ 0xffffffff;
+}
+
+/** The Adler-32 checksum of the \a len bytes at \a data as used by zlib. */
+uint32_t
+adler32 (const unsigned char *data, size_t len)
+{
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        a = (a + data[pos]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+/** Check that the \a len bytes at \a png are a PNG image of \a width times
+ *  \a height RGB pixels with valid chunks and put the compressed image data
+ *  into \a idat and \a idat_len.
+ *
+ *  \returns An error message or \c NULL.
+ */
+char *
+check_png (
+    const unsigned char *png, size_t len, unsigned width, unsigned height,
+    const unsigned char **idat, size_t *idat_len)
+{
+    require (len > sizeof (png_signature),)
+    require (!memcmp (png, png_signature, sizeof (png_signature)),)
+
+    *idat = NULL;
+    *idat_len = 0;
+    size_t pos = sizeof (png_signature);
+    const unsigned char *last_type = NULL;
+    while (pos + 12 <= len)
+    {
+        uint32_t chunk_len = read_u32 (png + pos);
+        const unsigned char *type = png + pos + 4;
+        require (pos + 12 + chunk_len <= len,)
+        require (crc32 (type, 4 + chunk_len) == read_u32 (type + 4 + chunk_len),)
+
+        if (!memcmp (type, "IHDR", 4))
+        {
+            require (chunk_len == 13,)
+            require (read_u32 (type + 4) == width,)
+            require (read_u32 (type + 8) == height,)
+            /* 8 bit depth and truecolor. */
+            require (type[12] == 8 && type[13] == 2,)
+        }
+        else if (!memcmp (type, "IDAT", 4))
+        {
+            *idat = type + 4;
+            *idat_len = chunk_len;
+        }
+
+        last_type = type;
+        pos += 12 + chunk_len;
+    }
+
+    require (pos == len,)
+    require (last_type && !memcmp (last_type, "IEND", 4),)
+    require (*idat && *idat_len > 6,)
+
+    return NULL;
+}
+
+char *
+PNG_image_has_valid_chunks_and_checksum (void)
+{
+    const unsigned width = 7, height = 5;
+    unsigned char pixels[7 * 5 * 3];
+    /* The rows with the filter type byte in front as compressed by PNG. */
+    unsigned char rows[5 * (1 + 7 * 3)];
+
+    for (size_t pos = 0; pos < sizeof (pixels); ++pos)
+        pixels[pos] = (unsigned char) (pos % 9 < 4 ? 0 : pos * 37);
+    for (unsigned row = 0; row < height; ++row)
+    {
+        rows[row * (1 + width * 3)] = 0;
+        memcpy (rows + row * (1 + width * 3) + 1, pixels + row * width * 3,
+                width * 3);
+    }
+
+    unsigned char *png = NULL;
+    size_t png_len = 0;
+    FILE *os = open_memstream ((char **) &png, &png_len);
+    require (png_write_rgb (os, pixels, width, height) == 0,)
+    fclose (os);
+
+    const unsigned char *idat;
+    size_t idat_len;
+    char *msg = check_png (png, png_len, width, height, &idat, &idat_len);
+    require (!msg, msg)
+    require (adler32 (rows, sizeof (rows)) == read_u32 (idat + idat_len - 4),)
+
+    free (png);
+
+    return NULL;
+}
+
+char *
+Word_cloud_is_a_PNG_image_of_the_given_size (void)
+{
+    const struct word_count words[] = {
+        {"const", 5, 40, 0}, {"char", 4, 30, 0}, {"size_t", 6, 10, 0},
+        {"a_very_long_word_which_might_not_fit_at_all", 43, 9, 0}};
+
+    unsigned char *png = NULL;
+    size_t png_len = 0;
+    FILE *os = open_memstream ((char **) &png, &png_len);
+    require (render_word_cloud (words, 4, 300, 200, os) == 0,)
+    fclose (os);
+
+    const unsigned char *idat;
+    size_t idat_len;
+    char *msg = check_png (png, png_len, 300, 200, &idat, &idat_len);
+    require (!msg, msg)
+
+    free (png);
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (PNG_image_has_valid_chunks_and_checksum,)
+    CMT_TEST_CASE (Word_cloud_is_a_PNG_image_of_the_given_size,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,121 @@
+/** \file
+ * Tests for the SIMD char search kernels. */
+#include <string.h>
+
+#include "scan.h"
+#include "cminitests.h"
+
+/** Length of the buffers searched by the tests. */
+#define SCAN_TEST_LEN 100
+
+/** Check for all supported instruction sets and all start positions in
+ *  \a text that the kernels find the same position as a plain loop. */
+char *
+check_all_kernels (const char *text, size_t len)
+{
+    for (int isa = SCAN_SCALAR; isa < SCAN_NUM_ISAS; ++isa)
+    {
+        if (!scan_select_isa (isa))
+            continue;
+
+        for (const char *pos = text; pos <= text + len; ++pos)
+        {
+            const char *end = text + len;
+            const char *star = pos;
+            while (star < end && *star != '*')
+                ++star;
+            const char *quote = pos;
+            while (quote < end && *quote != '"' && *quote != '\\')
+                ++quote;
+            const char *word = pos;
+            while (word < end && strchr (" \t\n\v\f\r", *word) && *word)
+                ++word;
+
+            require (scan_find_char (pos, end, '*') == star, isa)
+            require (scan_find_char2 (pos, end, '"', '\\') == quote, isa)
+            require (scan_find_non_space (pos, end) == word, isa)
+        }
+    }
+
+    scan_select_isa (scan_best_isa ());
+    return NULL;
+}
+
+char *
+Kernels_find_the_first_match (void)
+{
+    char text[SCAN_TEST_LEN];
+    const char chars[] = "ab*\"\\ \t\n\v\f\r\x80\xff";
+
+    for (size_t match = 0; match < sizeof (text); ++match)
+    {
+        memset (text, ' ', sizeof (text));
+        for (size_t i = 0; i < sizeof (chars) - 1; ++i)
+        {
+            text[match] = chars[i];
+            char *res = check_all_kernels (text, sizeof (text));
+            if (res)
+                return res;
+        }
+    }
+
+    return NULL;
+}
+
+char *
+Kernels_return_end_without_match (void)
+{
+    char text[SCAN_TEST_LEN];
+    memset (text, ' ', sizeof (text));
+
+    return check_all_kernels (text, sizeof (text));
+}
+
+char *
+Kernels_ignore_chars_after_end (void)
+{
+    char text[SCAN_TEST_LEN];
+    memset (text, '*', sizeof (text));
+
+    for (int isa = SCAN_SCALAR; isa < SCAN_NUM_ISAS; ++isa)
+    {
+        if (!scan_select_isa (isa))
+            continue;
+
+        for (size_t len = 0; len < sizeof (text); ++len)
+        {
+            memset (text, ' ', len);
+            require (scan_find_char (text, text + len, '*') == text + len,)
+            require (scan_find_char2 (text, text + len, '"', '*') == text + len,)
+        }
+    }
+
+    scan_select_isa (scan_best_isa ());
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Kernels_find_the_first_match,)
+    CMT_TEST_CASE (Kernels_return_end_without_match,)
+    CMT_TEST_CASE (Kernels_ignore_chars_after_end,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
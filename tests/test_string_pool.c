@@ -0,0 +1,91 @@
+/** \file
+ * Tests for the arena of strings. */
+#include <stdlib.h>
+#include <string.h>
+
+#include "string_pool.h"
+#include "cminitests.h"
+
+char *
+Strings_are_copied_with_distinct_ids (void)
+{
+    struct string_pool pool;
+    string_pool_init (&pool, 16);
+
+    uint32_t first = 0, second = 0;
+    require (string_pool_add (&pool, "domainXX", 6, 0, &first) == 0,)
+    require (string_pool_add (&pool, "cloud", 5, 0, &second) == 0,)
+    require (first == 1 && second == 2,)
+    require_streq ("domain", string_pool_get (&pool, first),)
+    require_streq ("cloud", string_pool_get (&pool, second),)
+
+    /* Strings longer than a chunk get a chunk of their own. */
+    char long_str[100];
+    memset (long_str, 'x', sizeof (long_str));
+    uint32_t ids[1000];
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        size_t len = i % sizeof (long_str);
+        require (string_pool_add (&pool, long_str, len, 0, &ids[i]) == 0,)
+        require (ids[i] == i + 3,)
+    }
+    for (uint32_t i = 0; i < 1000; ++i)
+        require (strlen (string_pool_get (&pool, ids[i])) == i % 100,)
+    require_streq ("domain", string_pool_get (&pool, first),)
+
+    string_pool_release (&pool);
+    require (!pool.chunks && !pool.strings,)
+    require (string_pool_add (&pool, "again", 5, 0, &first) == 0,)
+    require (first == 1,)
+    require_streq ("again", string_pool_get (&pool, first),)
+    string_pool_release (&pool);
+    return NULL;
+}
+
+char *
+Reserved_strings_are_replaced_in_place (void)
+{
+    struct string_pool pool;
+    string_pool_init (&pool, 64);
+
+    uint32_t first = 0, second = 0;
+    require (string_pool_add (&pool, "a", 1, 10, &first) == 0,)
+    require (string_pool_add (&pool, "b", 1, 10, &second) == 0,)
+    const char *str = string_pool_get (&pool, first);
+
+    string_pool_set (&pool, first, "replacing", 9);
+    require (string_pool_get (&pool, first) == str,)
+    require_streq ("replacing", string_pool_get (&pool, first),)
+    require_streq ("b", string_pool_get (&pool, second),)
+
+    string_pool_set (&pool, first, "re", 2);
+    require_streq ("re", string_pool_get (&pool, first),)
+
+    string_pool_release (&pool);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Strings_are_copied_with_distinct_ids,)
+    CMT_TEST_CASE (Reserved_strings_are_replaced_in_place,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -282,6 +282,152 @@ An_even_number_of_preceding_escapes_does_not_escape_the_delimiter (void)
     return NULL;
 }
 
+/** A \ref clutter_sink appending to the \c FILE passed as \a sink_data. */
+int
+write_to_stream (const char *text, size_t len, void *sink_data)
+{
+    fwrite (text, 1, len, sink_data);
+    return 0;
+}
+
+char *
+Output_does_not_depend_on_block_boundaries (void)
+{
+    char input[] =
+        "a /* b *\\/ c */ d //e\\\nf\n g \"h\\\"i\" 'j\\\\' k \t\n l / m /";
+    size_t input_len = sizeof (input) - 1;
+
+    rm_clutter_res expected = test_remove_clutter (input, input_len);
+    require (expected.res == 0, caller,)
+
+    struct clutter_stats first_stats = {0};
+    for (size_t block_len = 1; block_len <= input_len; ++block_len)
+    {
+        char *output = NULL;
+        size_t output_len = 0;
+        FILE *os = open_memstream (&output, &output_len);
+        enum clutter_state state = CLUTTER_CODE;
+        struct clutter_stats stats = {0};
+
+        for (size_t pos = 0; pos < input_len; pos += block_len)
+        {
+            size_t len = input_len - pos < block_len ? input_len - pos : block_len;
+            require (
+                remove_clutter_buf (
+                    input + pos, len, &state, &stats, write_to_stream, os)
+                == 0,)
+        }
+        require (remove_clutter_end (&state, write_to_stream, os) == 0,)
+        fclose (os);
+
+        require_streq (expected.output, output,)
+        require (stats.bytes_in == input_len,)
+        require (clutter_stats_bytes_out (&stats) == output_len,)
+        if (block_len == 1)
+            first_stats = stats;
+        require (!memcmp (&stats, &first_stats, sizeof (stats)),)
+        free (output);
+    }
+
+    free (expected.output);
+
+    return NULL;
+}
+
+/** Whether \ref remove_clutter_parallel strips the \a input_len chars
+ *  of \a input like \ref remove_clutter_buf on 1 to 4 jobs.
+ *
+ *  \returns \c NULL or the message of the failed requirement.
+ */
+char *
+strips_like_sequential (char *input, size_t input_len)
+{
+    rm_clutter_res expected = test_remove_clutter (input, input_len);
+    require (expected.res == 0, caller,)
+
+    for (int num_jobs = 1; num_jobs <= 4; ++num_jobs)
+    {
+        char *output = NULL;
+        size_t output_len = 0;
+        FILE *os = open_memstream (&output, &output_len);
+
+        struct clutter_stats stats = {0};
+
+        int res = remove_clutter_parallel (
+            input, input_len, num_jobs, &stats, write_to_stream, os);
+        fclose (os);
+
+        require (res == 0,)
+        require (output_len == strlen (expected.output),)
+        require (stats.bytes_in == input_len,)
+        require (clutter_stats_bytes_out (&stats) == output_len,)
+        require (!memcmp (expected.output, output, output_len),)
+        free (output);
+    }
+
+    free (expected.output);
+
+    return NULL;
+}
+
+char *
+Parallel_stripping_matches_sequential_stripping (void)
+{
+    const char pattern[] =
+        "int f (void) /* a \"b\" */ { return 'c' + g (\"d // e\\\"\");\n"
+        "}  // f \"g\n /* h */ '\\'' \t i / j;\n";
+    size_t input_len = 4 * 1024 * 1024;
+    char *input = malloc (input_len);
+    char *message = NULL;
+
+    /* The lines of the pattern in order, whose speculative scans
+     * converge, and its chars shuffled, whose scans don't. */
+    for (size_t shuffle = 0; shuffle < 2 && !message; ++shuffle)
+    {
+        for (size_t pos = 0; pos < input_len; ++pos)
+        {
+            size_t index = shuffle ? pos * 7 + pos / 1000 : pos;
+            input[pos] = pattern[index % (sizeof (pattern) - 1)];
+        }
+        message = strips_like_sequential (input, input_len);
+    }
+    free (input);
+
+    return message;
+}
+
+char *
+Parallel_stripping_of_chunk_spanning_literals (void)
+{
+    const char *openers[] = {"a /*", "b \"", "c '"};
+    const char *closers[] = {"*/ x\n", "\" y\n", "' z\n"};
+    size_t body_len = 4 * 1024 * 1024;
+    char *input = malloc (body_len + 16);
+
+    /* A comment, a string and a char literal over all chunks, in which
+     * the speculative scans from code and from inside of the literal
+     * never converge. */
+    for (int literal = 0; literal < 3; ++literal)
+    {
+        size_t len = strlen (openers[literal]);
+        memcpy (input, openers[literal], len);
+        for (; len < body_len; len += 4)
+            memcpy (input + len, "ab c", 4);
+        memcpy (input + len, closers[literal], strlen (closers[literal]));
+        len += strlen (closers[literal]);
+
+        char *message = strips_like_sequential (input, len);
+        if (message)
+        {
+            free (input);
+            return message;
+        }
+    }
+    free (input);
+
+    return NULL;
+}
+
 void
 all_tests (void)
 {
@@ -300,6 +446,9 @@ all_tests (void)
 
     CMT_TEST_CASE (Comments_are_ignored_inside_quoted_strings,)
     CMT_TEST_CASE (An_even_number_of_preceding_escapes_does_not_escape_the_delimiter,)
+    CMT_TEST_CASE (Output_does_not_depend_on_block_boundaries,)
+    CMT_TEST_CASE (Parallel_stripping_matches_sequential_stripping,)
+    CMT_TEST_CASE (Parallel_stripping_of_chunk_spanning_literals,)
 }
 
 CMT_RUN_TESTS (all_tests)
@@ -0,0 +1,90 @@
+/** \file
+ * Tests for recording spans in the Chrome Trace Event Format. */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "cminitests.h"
+
+/** Thread function: record a span of 100 bytes. */
+void *
+record_span (void *arg)
+{
+    uint64_t start = trace_begin ();
+    trace_end ("worker_span", start, 100, arg);
+    return NULL;
+}
+
+/** The number of occurrences of \a needle in \a text. */
+int
+count_matches (const char *text, const char *needle)
+{
+    int matches = 0;
+    for (const char *pos = text; (pos = strstr (pos, needle)); ++pos)
+        ++matches;
+    return matches;
+}
+
+char *
+Spans_of_all_threads_are_written (void)
+{
+    require (trace_begin () == 0,)
+    trace_end ("ignored_span", 0, 0, NULL);
+
+    trace_start ();
+    uint64_t start = trace_begin ();
+
+    pthread_t threads[3];
+    for (int thread = 0; thread < 3; ++thread)
+        require (!pthread_create (
+                     &threads[thread], NULL, record_span, "a \"b\".c"),)
+    for (int thread = 0; thread < 3; ++thread)
+        pthread_join (threads[thread], NULL);
+    trace_end ("main_span", start, 7, NULL);
+
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *os = open_memstream (&output, &output_len);
+    require (trace_write (os) == 0,)
+    fclose (os);
+
+    require (!strncmp (output, "{\"displayTimeUnit\"", 18),)
+    require (count_matches (output, "\"ph\": \"X\"") == 4,)
+    require (count_matches (output, "\"name\": \"worker_span\"") == 3,)
+    require (count_matches (output, "\"bytes\": 100, "
+                            "\"file\": \"a \\\"b\\\".c\"}") == 3,)
+    require (count_matches (output, "\"name\": \"main_span\"") == 1,)
+    require (!strstr (output, "ignored_span"),)
+    require (!strcmp (output + output_len - 4, "\n]}\n"),)
+    free (output);
+
+    /* Tracing stops with the write. */
+    require (trace_begin () == 0,)
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Spans_of_all_threads_are_written,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
@@ -0,0 +1,141 @@
+/** \file
+ * Tests for walking directory trees. */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "walk.h"
+#include "cminitests.h"
+
+/** Directory of the test tree. */
+static char tree[] = "/tmp/test_walk_XXXXXX";
+
+/** The names of the processed files relative to \ref tree, each followed
+ *  by a space. */
+static char found[1024];
+static pthread_mutex_t found_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** An \ref input_file_processor which appends \a input_file to
+ *  \ref found. */
+void
+record_file (
+    const char *input_file, const struct loaded_input *loaded, FILE *ostr,
+    void *worker_data)
+{
+    (void) loaded;
+    (void) ostr;
+    (void) worker_data;
+
+    pthread_mutex_lock (&found_lock);
+    strcat (found, input_file + strlen (tree) + 1);
+    strcat (found, " ");
+    pthread_mutex_unlock (&found_lock);
+}
+
+/** Create the file \a name below \ref tree including its directories. */
+void
+create_file (const char *name, const char *content)
+{
+    char *cmd;
+    if (asprintf (
+            &cmd, "mkdir -p \"$(dirname '%s/%s')\" && printf '%s' >'%s/%s'",
+            tree, name, content, tree, name) > 0)
+    {
+        if (system (cmd))
+            cmt_error ("Can't create '%s'", name);
+        free (cmd);
+    }
+}
+
+/** Walk \ref tree with \a filter on \a num_jobs threads and check that the
+ *  \a num_expected \a expected files were found. */
+char *
+check_walk (
+    const struct walk_filter *filter, int num_jobs,
+    const char **expected, int num_expected)
+{
+    found[0] = '\0';
+    char *roots[] = {tree};
+    require (walk_files_parallel (
+                 roots, 1, filter, NULL, num_jobs, record_file, NULL) == 0,)
+
+    int num_found = 0;
+    for (const char *pos = found; *pos; ++pos)
+        num_found += *pos == ' ';
+    require (num_found == num_expected, found)
+
+    for (int file = 0; file < num_expected; ++file)
+    {
+        char name[64];
+        snprintf (name, sizeof (name), "%s ", expected[file]);
+        require (strstr (found, name), expected[file])
+    }
+
+    return NULL;
+}
+
+char *
+Directories_are_walked_with_filters (void)
+{
+    require (mkdtemp (tree),)
+    create_file ("a.c", "");
+    create_file ("sub/b.h", "");
+    create_file ("sub/c.py", "");
+    create_file ("third_party/x/d.c", "");
+    create_file ("build/e.c", "");
+    create_file ("logs/f.log", "");
+    create_file ("logs/keep.log", "");
+    create_file (".git/HEAD", "");
+    create_file (".gitignore", "/build/\\n*.log\\n!keep.log\\n");
+
+    struct walk_filter all = {NULL, 0, NULL, 0, false};
+    const char *all_files[] = {
+        "a.c", "sub/b.h", "sub/c.py", "third_party/x/d.c", "build/e.c",
+        "logs/f.log", "logs/keep.log", ".gitignore"};
+    char *msg = check_walk (&all, 3, all_files, 8);
+    require (!msg, msg)
+
+    char *include[] = {"*.c", "*.h"};
+    char *exclude[] = {"third_party/**"};
+    struct walk_filter sources = {include, 2, exclude, 1, false};
+    const char *source_files[] = {"a.c", "sub/b.h", "build/e.c"};
+    msg = check_walk (&sources, 1, source_files, 3);
+    require (!msg, msg)
+
+    struct walk_filter gitignore = {NULL, 0, exclude, 1, true};
+    const char *unignored_files[] = {
+        "a.c", "sub/b.h", "sub/c.py", "logs/keep.log", ".gitignore"};
+    msg = check_walk (&gitignore, 2, unignored_files, 5);
+    require (!msg, msg)
+
+    char *cmd;
+    require (asprintf (&cmd, "rm -r '%s'", tree) > 0,)
+    require (system (cmd) == 0,)
+    free (cmd);
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Directories_are_walked_with_filters,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
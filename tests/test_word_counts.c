@@ -0,0 +1,321 @@
+/** \file
+ * Tests for counting the words of the stripped text. */
+#include <stdlib.h>
+#include <string.h>
+
+#include "domaincloud.h"
+#include "cminitests.h"
+
+/** Count the words of the \a len chars of \a text passed in parts of
+ *  \a part_len chars to \ref count_words. */
+struct word_counts *
+count_text (const char *text, size_t len, size_t part_len)
+{
+    struct word_counts *counts = word_counts_new ();
+    struct word_tokenizer tokenizer;
+    word_tokenizer_init (&tokenizer, counts);
+
+    for (size_t pos = 0; pos < len; pos += part_len)
+        count_words (
+            text + pos, len - pos < part_len ? len - pos : part_len,
+            &tokenizer);
+    word_tokenizer_end (&tokenizer);
+
+    return counts;
+}
+
+/** The output of \ref word_counts_print for \a counts.  Has to be freed. */
+char *
+print_counts (const struct word_counts *counts, size_t max_words)
+{
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *os = open_memstream (&output, &output_len);
+
+    word_counts_print (counts, max_words, os);
+    fclose (os);
+
+    return output;
+}
+
+char *
+Words_are_counted_by_frequency (void)
+{
+    const char text[] = "int foo (int bar) { return bar + foo_bar (bar); }";
+    const char *expected = "bar\t3\nint\t2\nfoo\t1\nfoo_bar\t1\nreturn\t1\n";
+
+    struct word_counts *counts = count_text (text, sizeof (text) - 1, 64);
+    char *output = print_counts (counts, 0);
+
+    require (word_counts_size (counts) == 5,)
+    require_streq (expected, output,)
+
+    free (output);
+    word_counts_free (counts);
+
+    return NULL;
+}
+
+char *
+Numbers_and_single_chars_are_no_words (void)
+{
+    const char text[] = "x = 0x42 + 7u + y2 + _ + __ ";
+    const char *expected = "__\t1\ny2\t1\n";
+
+    struct word_counts *counts = count_text (text, sizeof (text) - 1, 64);
+    char *output = print_counts (counts, 0);
+
+    require_streq (expected, output,)
+
+    free (output);
+    word_counts_free (counts);
+
+    return NULL;
+}
+
+char *
+Words_may_be_split_between_texts (void)
+{
+    const char text[] = "alpha beta_gamma 12delta alpha";
+    const char *expected = "alpha\t2\nbeta_gamma\t1\n";
+
+    for (size_t part_len = 1; part_len < sizeof (text); ++part_len)
+    {
+        struct word_counts *counts =
+            count_text (text, sizeof (text) - 1, part_len);
+        char *output = print_counts (counts, 0);
+
+        require_streq (expected, output,)
+
+        free (output);
+        word_counts_free (counts);
+    }
+
+    return NULL;
+}
+
+char *
+Identifiers_are_split_into_parts (void)
+{
+    const char text[] =
+        "parse_cli_options skipWhiteSpace HTTPServer utf8Decode __init__ "
+        "MAX_LEN x2y Parse";
+    const char *expected =
+        "parse\t2\ncli\t1\ndecode\t1\nhttp\t1\ninit\t1\nlen\t1\nmax\t1\n"
+        "options\t1\nserver\t1\nskip\t1\nspace\t1\nutf\t1\nwhite\t1\n";
+
+    for (size_t part_len = 1; part_len < sizeof (text); ++part_len)
+    {
+        struct word_counts *counts = word_counts_new ();
+        struct word_tokenizer tokenizer;
+        word_tokenizer_init (&tokenizer, counts);
+        word_tokenizer_set_split (&tokenizer, true);
+
+        size_t len = sizeof (text) - 1;
+        for (size_t pos = 0; pos < len; pos += part_len)
+            count_words (
+                text + pos, len - pos < part_len ? len - pos : part_len,
+                &tokenizer);
+        word_tokenizer_end (&tokenizer);
+        char *output = print_counts (counts, 0);
+
+        require_streq (expected, output,)
+
+        free (output);
+        word_counts_free (counts);
+    }
+
+    return NULL;
+}
+
+/** The output of \ref word_counts_print for the words of the \a len
+ *  chars of \a text passed to \ref count_words in two parts split at
+ *  \a split_at.  Identifiers are split into parts if \a split.  Has to
+ *  be freed. */
+char *
+print_split_text (const char *text, size_t len, size_t split_at, bool split)
+{
+    struct word_counts *counts = word_counts_new ();
+    struct word_tokenizer tokenizer;
+    word_tokenizer_init (&tokenizer, counts);
+    word_tokenizer_set_split (&tokenizer, split);
+
+    count_words (text, split_at, &tokenizer);
+    count_words (text + split_at, len - split_at, &tokenizer);
+    word_tokenizer_end (&tokenizer);
+    char *output = print_counts (counts, 0);
+
+    word_counts_free (counts);
+    return output;
+}
+
+char *
+Long_words_are_cut_wherever_they_are_split (void)
+{
+    char text[WORD_MAX_LEN + 64];
+    size_t len = 0;
+    text[len++] = ' ';
+    while (len < WORD_MAX_LEN - 8)
+        text[len++] = 'a';
+    while (len < WORD_MAX_LEN + 48)
+    {
+        memcpy (text + len, "PartX", 5);
+        len += 5;
+    }
+    memcpy (text + len, " end", 4);
+    len += 4;
+
+    for (int split = 0; split < 2; ++split)
+    {
+        char *whole = print_split_text (text, len, len, split);
+
+        for (size_t split_at = 0; split_at < len; ++split_at)
+        {
+            char *output = print_split_text (text, len, split_at, split);
+            require_streq (whole, output,)
+            free (output);
+        }
+        free (whole);
+    }
+
+    return NULL;
+}
+
+/** Whether the approximate counts of \a approx include the true counts
+ *  in \a exact, each within its error. */
+bool
+counts_are_within_errors (
+    const struct word_counts *approx, const struct word_counts *exact)
+{
+    struct word_count *approx_words = word_counts_sorted (approx);
+    struct word_count *exact_words = word_counts_sorted (exact);
+    bool within = approx_words && exact_words;
+
+    for (size_t i = 0; within && i < word_counts_size (approx); ++i)
+    {
+        unsigned long true_count = 0;
+        for (size_t j = 0; j < word_counts_size (exact); ++j)
+            if (!strcmp (approx_words[i].word, exact_words[j].word))
+                true_count = exact_words[j].count;
+        within = approx_words[i].count >= true_count
+            && approx_words[i].count - approx_words[i].error <= true_count;
+    }
+
+    free (approx_words);
+    free (exact_words);
+    return within;
+}
+
+char *
+Bounded_tables_keep_the_frequent_words (void)
+{
+    struct word_counts *approx[2] = {
+        word_counts_new_bounded (200), word_counts_new_bounded (200)};
+    struct word_counts *exact = word_counts_new ();
+    require (approx[0] && approx[1] && exact,)
+
+    /* Word i of 20 occurs 200 - 10 * i times between 5000 rare words. */
+    char word[16];
+    unsigned seed = 2017;
+    for (int round = 0; round < 200; ++round)
+        for (int i = 0; i < 45; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            if (i < 20 && round < 200 - 10 * i)
+                snprintf (word, sizeof (word), "hot%d", i);
+            else
+                snprintf (word, sizeof (word), "rare%u", seed % 5000);
+            struct word_counts *table = approx[(round + i) % 2];
+            require (word_counts_add (table, word, strlen (word), 1) == 0,)
+            require (word_counts_add (exact, word, strlen (word), 1) == 0,)
+        }
+
+    require (word_counts_is_bounded (approx[0]) && !word_counts_is_bounded (exact),)
+    require (word_counts_size (approx[0]) == 200,)
+    require (word_counts_error_bound (approx[0]) > 0,)
+
+    require (word_counts_merge (approx[0], approx[1]) == 0,)
+    require (word_counts_size (approx[0]) == 200,)
+    require (counts_are_within_errors (approx[0], exact),)
+
+    /* The errors are too small to mix up frequent and rare words. */
+    struct word_count *top = word_counts_sorted (approx[0]);
+    require (top,)
+    for (int i = 0; i < 10; ++i)
+        require (!strncmp (top[i].word, "hot", 3), "%s", top[i].word)
+    free (top);
+
+    word_counts_free (approx[0]);
+    word_counts_free (approx[1]);
+    word_counts_free (exact);
+    return NULL;
+}
+
+char *
+Memory_limits_bound_the_number_of_words (void)
+{
+    require (word_counts_max_words (0) == 0,)
+    require (!word_counts_new_bounded (0),)
+    size_t max_words = word_counts_max_words (1024 * 1024);
+    require (max_words > 1000 && max_words < 1024 * 1024 / WORD_MAX_LEN,)
+    require (word_counts_max_words (2 * 1024 * 1024) >= 2 * max_words,)
+
+    return NULL;
+}
+
+char *
+Tables_grow_and_merge (void)
+{
+    struct word_counts *counts = word_counts_new ();
+    struct word_counts *other = word_counts_new ();
+    char word[16];
+
+    for (int num = 0; num < 10000; ++num)
+    {
+        int len = sprintf (word, "w%d", num);
+        require (word_counts_add (counts, word, (size_t) len, 1) == 0,)
+        require (word_counts_add (other, word, (size_t) len, (unsigned long) num) == 0,)
+    }
+    require (word_counts_merge (counts, other) == 0,)
+    char *output = print_counts (counts, 2);
+
+    require (word_counts_size (counts) == 10000,)
+    require_streq ("w9999\t10000\nw9998\t9999\n", output,)
+
+    free (output);
+    word_counts_free (other);
+    word_counts_free (counts);
+
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Words_are_counted_by_frequency,)
+    CMT_TEST_CASE (Numbers_and_single_chars_are_no_words,)
+    CMT_TEST_CASE (Words_may_be_split_between_texts,)
+    CMT_TEST_CASE (Identifiers_are_split_into_parts,)
+    CMT_TEST_CASE (Long_words_are_cut_wherever_they_are_split,)
+    CMT_TEST_CASE (Bounded_tables_keep_the_frequent_words,)
+    CMT_TEST_CASE (Memory_limits_bound_the_number_of_words,)
+    CMT_TEST_CASE (Tables_grow_and_merge,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
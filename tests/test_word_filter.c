@@ -0,0 +1,178 @@
+/** \file
+ * Tests for the perfect hash sets of words. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "domaincloud.h"
+#include "lang.h"
+#include "word_filter.h"
+#include "cminitests.h"
+
+/** Whether the zero terminated \a word is in \a filter. */
+bool
+has (const struct word_filter *filter, const char *word)
+{
+    return word_filter_contains (filter, word, strlen (word));
+}
+
+char *
+Many_words_get_distinct_slots (void)
+{
+    enum { num_words = 5000 };
+    static char texts[num_words][8];
+    static const char *words[num_words];
+    for (int i = 0; i < num_words; ++i)
+    {
+        snprintf (texts[i], sizeof (texts[i]), "w%d", i);
+        words[i] = texts[i];
+    }
+
+    struct word_filter *filter = word_filter_new (words, num_words);
+    require (filter,)
+    require (filter->num_words == num_words,)
+
+    for (int i = 0; i < num_words; ++i)
+        require (has (filter, words[i]), "%s is missing", words[i])
+    require (!has (filter, "w5000"),)
+    require (!has (filter, "w-1"),)
+    require (!has (filter, "w1 "),)
+    require (!has (filter, ""),)
+
+    word_filter_free (filter);
+    return NULL;
+}
+
+char *
+Repeated_words_are_kept_once (void)
+{
+    const char *words[] = {"self", "this", "self", "it", "this"};
+    struct word_filter *filter = word_filter_new (words, 5);
+    require (filter,)
+    require (filter->num_words == 3,)
+    require (has (filter, "self") && has (filter, "this") && has (filter, "it"),)
+    require (!has (filter, "thi") && !has (filter, "selfs"),)
+    word_filter_free (filter);
+
+    filter = word_filter_new (NULL, 0);
+    require (filter,)
+    require (!has (filter, "self"),)
+    word_filter_free (filter);
+
+    require (!has (NULL, "self"),)
+    return NULL;
+}
+
+char *
+Words_are_read_from_files (void)
+{
+    char file_name[] = "/tmp/test_word_filterXXXXXX";
+    int fd = mkstemp (file_name);
+    require (fd >= 0,)
+    FILE *ostr = fdopen (fd, "w");
+    fputs ("# common words\nfoo bar\t baz # not: qux\n\n  tmp\n", ostr);
+    fclose (ostr);
+
+    struct word_filter *filter = NULL;
+    require (word_filter_read (file_name, &filter) == 0,)
+    unlink (file_name);
+
+    require (filter && filter->num_words == 4,)
+    require (has (filter, "foo") && has (filter, "baz") && has (filter, "tmp"),)
+    require (!has (filter, "qux") && !has (filter, "#") && !has (filter, "words"),)
+    word_filter_free (filter);
+
+    require (word_filter_read (file_name, &filter) == ENOENT,)
+    return NULL;
+}
+
+char *
+Languages_have_their_keywords (void)
+{
+    require (has (clutter_lang_keywords (clutter_lang_find ("python")), "def"),)
+    require (!has (clutter_lang_keywords (clutter_lang_find ("python")), "struct"),)
+    require (has (clutter_lang_keywords (clutter_lang_find ("cpp")), "struct"),)
+    require (has (clutter_lang_keywords (clutter_lang_find ("cpp")), "template"),)
+    require (!has (clutter_lang_keywords (NULL), "template"),)
+    require (has (clutter_lang_keywords (NULL), "ifndef"),)
+
+    for (int i = 0; i < num_clutter_langs; ++i)
+    {
+        const struct word_filter *keywords = clutter_langs[i].keywords;
+        require (keywords && keywords->num_words,)
+        for (uint32_t slot = 0; slot < keywords->num_words; ++slot)
+            require (word_filter_contains (
+                         keywords, keywords->words[slot], keywords->lens[slot]),
+                     "%s: %.*s is missing", clutter_langs[i].name,
+                     (int) keywords->lens[slot], keywords->words[slot])
+        require (!has (keywords, "domain"),)
+    }
+
+    return NULL;
+}
+
+/** A \ref clutter_sink which appends each word and a space to the memory
+ *  stream \a ostr. */
+int
+collect_word (const char *word, size_t len, void *ostr)
+{
+    fwrite (word, 1, len, ostr);
+    fputc (' ', ostr);
+    return 0;
+}
+
+char *
+Filtered_words_are_not_passed_on (void)
+{
+    const char *words[] = {"tmp", "foo"};
+    struct word_filter *stopwords = word_filter_new (words, 2);
+    require (stopwords,)
+
+    char *output = NULL;
+    size_t output_len = 0;
+    FILE *ostr = open_memstream (&output, &output_len);
+    struct word_tokenizer tokenizer;
+    word_tokenizer_init_sink (&tokenizer, collect_word, ostr);
+    word_tokenizer_set_filters (
+        &tokenizer, clutter_lang_keywords (NULL), stopwords);
+
+    const char text[] = "static int foo_count (int tmp) { return tmp2 + fo";
+    require (count_words (text, sizeof (text) - 1, &tokenizer) == 0,)
+    require (count_words ("o", 1, &tokenizer) == 0,)
+    require (word_tokenizer_end (&tokenizer) == 0,)
+    fclose (ostr);
+
+    require_streq ("foo_count tmp2 ", output,)
+    free (output);
+    word_filter_free (stopwords);
+    return NULL;
+}
+
+void
+all_tests (void)
+{
+    CMT_TEST_CASE (Many_words_get_distinct_slots,)
+    CMT_TEST_CASE (Repeated_words_are_kept_once,)
+    CMT_TEST_CASE (Words_are_read_from_files,)
+    CMT_TEST_CASE (Languages_have_their_keywords,)
+    CMT_TEST_CASE (Filtered_words_are_not_passed_on,)
+}
+
+CMT_RUN_TESTS (all_tests)
+
+/* Copyright 2017 A. Johannes RICHTER <albrechtjohannes.richter@gmail.com>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/